@@ -102,18 +102,47 @@ struct FMeshGroup {
 		Material = NULL;
 	}
 
-	inline void BuildVertex(
-		const FMeshTriangleVertex & vertex,
-		const FVector & tangentX,
-		const FVector & tangentY,
-		const FVector & tangentZ
-	) {
-		FDynamicMeshVertex dmVert;
-		dmVert.Position = vertex.Position;
-		dmVert.Color = vertex.VertexColor;
-		dmVert.SetTangents(tangentX, tangentY, tangentZ);
-		int32 vindex = VertexBuffer.Vertices.Add(dmVert);
-		IndexBuffer.Indices.Add(vindex);
+	/**
+	 * Copies the shared vertices and the indices of a section into the buffers.
+	 *
+	 * The layers of a blended section are passed to the material through the vertices. The
+	 * vertex colour holds the weights of the 4 layers in RGBA, and the texture coordinate
+	 * holds the layers themselves, packed as (layer0 * 256 + layer1, layer2 * 256 + layer3).
+	 * Unblended sections are white, with layer 0 in full.
+	 */
+	void BuildSection(const utils::MeshSection & section) {
+		uint32 layers[utils::MeshSection::MAX_LAYERS] = { 0, 0, 0, 0 };
+		for (uint32 i = 0; i < section.Layers.size(); i++) {
+			// Larger layers would spill into the neighbouring layer of the pair
+			check(section.Layers[i] <= utils::MeshSection::MAX_LAYER_ID);
+			layers[i] = section.Layers[i];
+		}
+		const FVector2D packedLayers(
+			(float) (layers[0] * 256 + layers[1]), (float) (layers[2] * 256 + layers[3]));
+
+		VertexBuffer.Vertices.Reserve(section.GetVertexCount());
+		for (uint64 i = 0; i < section.GetVertexCount(); i++) {
+			FVector tangentX, unused;
+			const FVector tangentZ = utils::ToFVector(section.Normals[i]);
+			tangentZ.FindBestAxisVectors(tangentX, unused);
+			const FVector tangentY = (tangentX ^ tangentZ).SafeNormal();
+
+			FDynamicMeshVertex dmVert;
+			dmVert.Position = utils::ToFVector(section.Positions[i]);
+			if (section.IsBlended()) {
+				const auto & weights = section.LayerWeights[i];
+				dmVert.Color = FLinearColor(weights.X, weights.Y, weights.Z, weights.W).ToFColor(false);
+			} else {
+				dmVert.Color = FColor(255, 255, 255);
+			}
+			dmVert.TextureCoordinate = packedLayers;
+			dmVert.SetTangents(tangentX, tangentY, tangentZ);
+			VertexBuffer.Vertices.Add(dmVert);
+		}
+
+		IndexBuffer.Indices.Reserve(section.Indices.size());
+		for (const auto index : section.Indices)
+			IndexBuffer.Indices.Add((int32) index);
 	}
 };
 
@@ -130,30 +159,20 @@ public:
 		: FPrimitiveSceneProxy(Component),
 		MaterialRelevance(Component->GetMaterialRelevance())
 	{
-		for (auto it : Component->MeshTriangles) {
+		for (const auto & section : Component->MeshBuffer->Sections) {
+			if (section.Indices.empty())
+				continue;
+
 			// Make sure VertexFactory -> FMeshGroup never goes out of scope after
 			// calling the FVertexFactory.Init method, otherwise an out-of-scope
 			// exception occurs because ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER
 			// makes a callback at a later time.
 			FMeshGroup * meshGroup = new FMeshGroup();
-			MeshGroups.Add(it.Key, meshGroup);
-			for (auto it2 = it.Value.CreateConstIterator(); it2; ++it2) {
-				const FMeshTriangle & Tri = *it2;
-
-				const FVector Edge01 = (Tri.Vertex1.Position - Tri.Vertex0.Position);
-				const FVector Edge02 = (Tri.Vertex2.Position - Tri.Vertex0.Position);
-
-				const FVector tangentX = Edge01.SafeNormal();
-				const FVector tangentZ = (Edge02 ^ Edge01).SafeNormal();
-				const FVector tangentY = (tangentX ^ tangentZ).SafeNormal();
+			MeshGroups.Add(section.MaterialId, meshGroup);
+			meshGroup->BuildSection(section);
 
-				meshGroup->BuildVertex(Tri.Vertex0, tangentX, tangentY, tangentZ);
-				meshGroup->BuildVertex(Tri.Vertex1, tangentX, tangentY, tangentZ);
-				meshGroup->BuildVertex(Tri.Vertex2, tangentX, tangentY, tangentZ);
-			}
-
-			if (it.Key < (uint32) Component->GetNumMaterials())
-				meshGroup->Material = Component->GetMaterial(it.Key);
+			if (section.MaterialId < (uint32) Component->GetNumMaterials())
+				meshGroup->Material = Component->GetMaterial(section.MaterialId);
 			else
 				meshGroup->Material = NULL;
 			meshGroup->InitializeResources();
@@ -247,82 +266,152 @@ public:
 
 UGeneratedMeshComponent::UGeneratedMeshComponent(
 	const FPostConstructInitializeProperties & PCIP
-	) : Super(PCIP), MeshTriangleCount(0) {
+	) : Super(PCIP), bDeferCollisionCooking(false), bCollisionDirty(false) {
 	PrimaryComponentTick.bCanEverTick = false;
 }
 
 bool UGeneratedMeshComponent::SetGeneratedMeshTriangles(
 	const TArray<FMeshTriangle> & triangles
 ) {
-	MeshTriangleCount = triangles.Num();
+	// Triangles are kept unshared and flat shaded, this path is meant for debug geometry
+	const utils::MeshBufferPtr buffer(new utils::MeshBuffer());
 
-	MeshTriangles.Empty();
+	TArray<UMaterialInterface *> materials;
 
 	for (auto it = triangles.CreateConstIterator(); it; ++it) {
-		UMaterialInterface * mat = NULL;
-		// If all three materials are the same, no blending needs to be done
-		if (it->Vertex0.Material == it->Vertex1.Material &&
-			it->Vertex0.Material == it->Vertex2.Material) {
-
-			mat = it->Vertex0.Material;
-		} else {
-			// TODO(tlei): implement blending
-		}
-
+		// Triangles whose vertices differ use the material of their first vertex, terrain
+		// blending goes through the material layers of a mesh buffer instead
+		UMaterialInterface * mat = it->Vertex0.Material;
 		if (mat == NULL)
 			mat = UMaterial::GetDefaultMaterial(MD_Surface);
 
 		// Search for index of material
-		int32 index = Materials.IndexOfByKey(mat);
-		if (index == INDEX_NONE) {
-			index = Materials.Num();
-			SetMaterial(index, mat);
-		}
+		int32 index = materials.IndexOfByKey(mat);
+		if (index == INDEX_NONE)
+			index = materials.Add(mat);
+
+		buffer->AddTriangle(utils::Triangle3D<float>(
+			utils::ToVector3DF(it->Vertex0.Position),
+			utils::ToVector3DF(it->Vertex1.Position),
+			utils::ToVector3DF(it->Vertex2.Position)), (uint32) index);
+	}
 
-		FMeshTriangle tri(*it);
+	SetGeneratedMeshBuffer(buffer, materials);
 
-		// Get array of triangles from map
-		if (!MeshTriangles.Contains(index))
-			MeshTriangles.Add(index, TArray<FMeshTriangle>());
+	return true;
+}
 
-		MeshTriangles.Find(index)->Add(tri);
-	}
+bool UGeneratedMeshComponent::SetGeneratedMeshSections(
+	const TArray<FGeneratedMeshSection> & sections
+) {
+	const utils::MeshBufferPtr buffer(new utils::MeshBuffer());
+	TArray<UMaterialInterface *> materials;
+
+	for (auto it = sections.CreateConstIterator(); it; ++it) {
+		const int32 vertexCount = it->Positions.Num();
+		if (it->Indices.Num() % 3 != 0)
+			return false;
+		for (const auto index : it->Indices) {
+			if (index < 0 || index >= vertexCount)
+				return false;
+		}
 
-#if WITH_EDITOR
-	// This is required for the first time after creation
-	if (ModelBodySetup)
-		ModelBodySetup->InvalidatePhysicsData();
-#endif
+		UMaterialInterface * mat = it->Material;
+		if (mat == NULL)
+			mat = UMaterial::GetDefaultMaterial(MD_Surface);
 
-	UpdateCollision();
+		int32 materialId = materials.IndexOfByKey(mat);
+		if (materialId == INDEX_NONE)
+			materialId = materials.Add(mat);
+
+		auto & section = buffer->GetSection((uint32) materialId);
+		const uint32 offset = (uint32) section.GetVertexCount();
+		const bool bHasNormals = it->Normals.Num() == vertexCount;
+
+		for (int32 i = 0; i < vertexCount; i++) {
+			const auto position = utils::ToVector3DF(it->Positions[i]);
+			buffer->ExtendBounds(position);
+			section.Positions.push_back(position);
+			section.Normals.push_back(bHasNormals
+				? utils::ToVector3DF(it->Normals[i].SafeNormal())
+				: utils::Vector3D<float>());
+		}
 
-	// Need to recreate scene proxy to send it over
-	MarkRenderStateDirty();
+		for (int32 i = 0; i < it->Indices.Num(); i += 3) {
+			const uint32 i0 = offset + (uint32) it->Indices[i];
+			const uint32 i1 = offset + (uint32) it->Indices[i + 1];
+			const uint32 i2 = offset + (uint32) it->Indices[i + 2];
+			section.Indices.push_back(i0);
+			section.Indices.push_back(i1);
+			section.Indices.push_back(i2);
+
+			// Without normals, accumulate the area weighted face normals of the triangles
+			if (!bHasNormals) {
+				const FVector & p0 = it->Positions[it->Indices[i]];
+				const auto normal = utils::ToVector3DF(
+					(it->Positions[it->Indices[i + 2]] - p0) ^ (it->Positions[it->Indices[i + 1]] - p0));
+				section.Normals[i0] = section.Normals[i0] + normal;
+				section.Normals[i1] = section.Normals[i1] + normal;
+				section.Normals[i2] = section.Normals[i2] + normal;
+			}
+		}
+
+		if (!bHasNormals) {
+			for (uint32 i = offset; i < section.GetVertexCount(); i++) {
+				const FVector normal = utils::ToFVector(section.Normals[i]);
+				section.Normals[i] = utils::ToVector3DF(normal.SafeNormal());
+			}
+		}
+	}
+
+	SetGeneratedMeshBuffer(buffer, materials);
 
 	return true;
 }
 
 void UGeneratedMeshComponent::ClearMeshTriangles() {
-	MeshTriangles.Empty();
+	MeshBuffer.reset();
+	CollisionBuffer.reset();
 	Materials.Empty();
-	MeshTriangleCount = 0;
+	UpdateMesh(true);
+}
 
-#if WITH_EDITOR
-	// This is required for the first time after creation
-	if (ModelBodySetup)
-		ModelBodySetup->InvalidatePhysicsData();
-#endif
+void UGeneratedMeshComponent::SetGeneratedMeshBuffer(
+	const utils::MeshBufferConstPtr & buffer,
+	const TArray<UMaterialInterface *> & materials,
+	const utils::MeshBufferConstPtr & collisionBuffer
+) {
+	// Buffers are never modified once set, so an unchanged pointer means unchanged collision.
+	// The previous buffers are released here, the scene proxy copies what it needs.
+	const auto & collisionMesh = collisionBuffer ? collisionBuffer : buffer;
+	const bool bCollisionChanged = collisionMesh != GetCollisionMesh();
+	MeshBuffer = buffer;
+	CollisionBuffer = collisionBuffer;
 
-	UpdateCollision();
+	Materials.Empty();
+	for (int32 i = 0; i < materials.Num(); i++)
+		SetMaterial(i, materials[i]);
 
-	// Need to recreate scene proxy to send it over
+	UpdateMesh(bCollisionChanged);
+}
+
+void UGeneratedMeshComponent::UpdateMesh(const bool bCollisionChanged) {
+	if (bCollisionChanged) {
+		if (bDeferCollisionCooking)
+			bCollisionDirty = true;
+		else
+			UpdateCollision();
+	}
+
+	// Need to recreate scene proxy to send it over, with bounds that fit the new mesh
+	UpdateBounds();
 	MarkRenderStateDirty();
 }
 
 
 FPrimitiveSceneProxy* UGeneratedMeshComponent::CreateSceneProxy() {
 	FPrimitiveSceneProxy* Proxy = NULL;
-	if (MeshTriangleCount > 0)
+	if (MeshBuffer && !MeshBuffer->IsEmpty())
 		Proxy = new FGeneratedMeshSceneProxy(this);
 	return Proxy;
 }
@@ -337,11 +426,14 @@ UMaterialInterface * UGeneratedMeshComponent::GetMaterial(int32 ElementIndex) co
 
 
 FBoxSphereBounds UGeneratedMeshComponent::CalcBounds(const FTransform & LocalToWorld) const {
-	FBoxSphereBounds NewBounds;
-	NewBounds.Origin = FVector::ZeroVector;
-	NewBounds.BoxExtent = FVector(HALF_WORLD_MAX, HALF_WORLD_MAX, HALF_WORLD_MAX);
-	NewBounds.SphereRadius = FMath::Sqrt(3.0f * FMath::Square(HALF_WORLD_MAX));
-	return NewBounds;
+	// An empty component still needs bounds at its location, so that culling discards it
+	if (!MeshBuffer || MeshBuffer->IsEmpty())
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0);
+
+	const FBox localBox(
+		utils::ToFVector(MeshBuffer->BoundsMin),
+		utils::ToFVector(MeshBuffer->BoundsMax));
+	return FBoxSphereBounds(localBox.TransformBy(LocalToWorld));
 }
 
 
@@ -349,17 +441,26 @@ bool UGeneratedMeshComponent::GetPhysicsTriMeshData(
 	struct FTriMeshCollisionData* CollisionData,
 	bool InUseAllTriData
 ) {
+	const auto & mesh = GetCollisionMesh();
+	if (!mesh)
+		return false;
+
 	FTriIndices Triangle;
 
-	for (auto it : MeshTriangles) {
-		uint32 i = 0;
-		for (auto it2 = it.Value.CreateConstIterator(); it2; ++it2, ++i) {
-			Triangle.v0 = CollisionData->Vertices.Add(it2->Vertex0.Position);
-			Triangle.v1 = CollisionData->Vertices.Add(it2->Vertex1.Position);
-			Triangle.v2 = CollisionData->Vertices.Add(it2->Vertex2.Position);
+	// Vertices are shared within a section, as welded by the mesher
+	for (const auto & section : mesh->Sections) {
+		const int32 offset = CollisionData->Vertices.Num();
+		CollisionData->Vertices.Reserve(offset + section.GetVertexCount());
+		for (const auto & position : section.Positions)
+			CollisionData->Vertices.Add(utils::ToFVector(position));
+
+		for (uint64 tri = 0; tri < section.GetTriangleCount(); tri++) {
+			Triangle.v0 = offset + section.Indices[tri * 3];
+			Triangle.v1 = offset + section.Indices[tri * 3 + 1];
+			Triangle.v2 = offset + section.Indices[tri * 3 + 2];
 
 			CollisionData->Indices.Add(Triangle);
-			CollisionData->MaterialIndices.Add(i);
+			CollisionData->MaterialIndices.Add(section.MaterialId);
 		}
 	}
 
@@ -369,7 +470,8 @@ bool UGeneratedMeshComponent::GetPhysicsTriMeshData(
 }
 
 bool UGeneratedMeshComponent::ContainsPhysicsTriMeshData(bool InUseAllTriData) const {
-	return MeshTriangleCount > 0;
+	const auto & mesh = GetCollisionMesh();
+	return mesh && !mesh->IsEmpty();
 }
 
 void UGeneratedMeshComponent::UpdateBodySetup() {
@@ -381,6 +483,14 @@ void UGeneratedMeshComponent::UpdateBodySetup() {
 }
 
 void UGeneratedMeshComponent::UpdateCollision() {
+	bCollisionDirty = false;
+
+#if WITH_EDITOR
+	// This is required for the first time after creation
+	if (ModelBodySetup)
+		ModelBodySetup->InvalidatePhysicsData();
+#endif
+
 	if (bPhysicsStateCreated) {
 		DestroyPhysicsState();
 		UpdateBodySetup();
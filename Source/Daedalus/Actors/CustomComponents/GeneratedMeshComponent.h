@@ -4,6 +4,7 @@
 
 #include <Utilities/UnrealBridge.h>
 #include <Utilities/Algebra/Algebra3D.h>
+#include <Utilities/Mesh/MeshBuffer.h>
 #include "GeneratedMeshComponent.generated.h"
 
 /**
@@ -32,6 +33,11 @@ public:
 		UMaterialInterface * const material = NULL
 	) : FMeshTriangleVertex(utils::ToFVector(position), material) {}
 
+	FMeshTriangleVertex(
+		const utils::Vector3D<float> & position,
+		UMaterialInterface * const material = NULL
+	) : FMeshTriangleVertex(utils::ToFVector(position), material) {}
+
 	FMeshTriangleVertex(
 		const FVector & position,
 		UMaterialInterface * const material
@@ -64,13 +70,35 @@ public:
 		const FMeshTriangleVertex & vertex1,
 		const FMeshTriangleVertex & vertex2
 	) : Vertex0(vertex0), Vertex1(vertex1), Vertex2(vertex2) {}
-	FMeshTriangle(const utils::Triangle3D & tri, UMaterialInterface * const material) :
+	FMeshTriangle(const utils::Triangle3D<> & tri, UMaterialInterface * const material) :
+		FMeshTriangle(
+			FMeshTriangleVertex(tri.Point1, material),
+			FMeshTriangleVertex(tri.Point2, material),
+			FMeshTriangleVertex(tri.Point3, material)) {}
+	FMeshTriangle(const utils::Triangle3D<float> & tri, UMaterialInterface * const material) :
 		FMeshTriangle(
 			FMeshTriangleVertex(tri.Point1, material),
 			FMeshTriangleVertex(tri.Point2, material),
 			FMeshTriangleVertex(tri.Point3, material)) {}
 };
 
+/**
+ * An indexed group of triangles sharing one material. Normals are optional, when their count
+ * does not match the positions they are computed from the triangles.
+ */
+USTRUCT(BlueprintType)
+struct FGeneratedMeshSection {
+	GENERATED_USTRUCT_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = Section) TArray<FVector> Positions;
+	UPROPERTY(EditAnywhere, Category = Section) TArray<FVector> Normals;
+	UPROPERTY(EditAnywhere, Category = Section) TArray<int32> Indices;
+	UPROPERTY(EditAnywhere, Category = Section) UMaterialInterface * Material;
+
+	FGeneratedMeshSection() : Material(NULL) {}
+};
+
 /** Component that allows you to specify custom triangle mesh geometry */
 UCLASS(editinlinenew, meta = (BlueprintSpawnableComponent), ClassGroup = Rendering)
 class UGeneratedMeshComponent :
@@ -83,14 +111,42 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Components|GeneratedMesh")
 		bool SetGeneratedMeshTriangles(const TArray<FMeshTriangle> & Triangles);
 
+	/**
+	 * Set the geometry from indexed sections, which share vertices between triangles.
+	 * @return False if any section has indices out of range or not a multiple of 3.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Components|GeneratedMesh")
+		bool SetGeneratedMeshSections(const TArray<FGeneratedMeshSection> & Sections);
+
 	/** Set the geometry to use on this triangle mesh */
 	UFUNCTION(BlueprintCallable, Category = "Components|GeneratedMesh")
 		void ClearMeshTriangles();
 
+	/**
+	 * Swaps in a mesh that was built elsewhere, possibly on another thread. The buffers must
+	 * not be modified afterwards, the component keeps a reference to them until the next
+	 * buffers are set. Collision is only cooked again if its buffer changed.
+	 * @param materials Materials indexed by the material IDs of the buffer.
+	 * @param collisionBuffer Simplified mesh to collide with, or NULL to use the render mesh.
+	 */
+	void SetGeneratedMeshBuffer(
+		const utils::MeshBufferConstPtr & buffer,
+		const TArray<UMaterialInterface *> & materials,
+		const utils::MeshBufferConstPtr & collisionBuffer = NULL);
+
 	/** Description of collision */
 	UPROPERTY(BlueprintReadOnly, Category = "Collision")
 	class UBodySetup* ModelBodySetup;
 
+	/**
+	 * When set, mesh changes only mark the collision as dirty, and the owner cooks it later
+	 * with UpdateCollision. This lets the owner spread the cooking cost over several frames.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Collision")
+	bool bDeferCollisionCooking;
+
+	inline bool IsCollisionDirty() const { return bCollisionDirty; }
+
 	// Begin UMeshComponent interface.
 	virtual int32 GetNumMaterials() const OVERRIDE;
 	virtual UMaterialInterface * GetMaterial(int32 ElementIndex) const OVERRIDE;
@@ -108,6 +164,9 @@ public:
 	// End UPrimitiveComponent interface.
 
 	void UpdateBodySetup();
+	/**
+	 * Cooks the collision of the current mesh, clearing the dirty flag.
+	 */
 	void UpdateCollision();
 
 private:
@@ -115,13 +174,21 @@ private:
 	virtual FBoxSphereBounds CalcBounds(const FTransform & LocalToWorld) const OVERRIDE;
 	// Begin USceneComponent interface.
 
-	// Mesh triangles mapped by material IDs, since only 1 material can be applied to
-	// each mesh group, we need to create a mesh group for every material present in
-	// the entire mesh.
-	TMap<uint32, TArray<FMeshTriangle> > MeshTriangles;
-
-	// Cache count of the contents of MeshTriangles
-	uint64 MeshTriangleCount;
+	// Current geometry, with material IDs indexing into the materials of the component.
+	// Only 1 material can be applied to each mesh group, so the scene proxy creates a mesh
+	// group for every material present in the buffer.
+	utils::MeshBufferConstPtr MeshBuffer;
+	utils::MeshBufferConstPtr CollisionBuffer;       // NULL to collide with MeshBuffer
+	bool bCollisionDirty;                            // Collision is waiting to be cooked
+
+	inline const utils::MeshBufferConstPtr & GetCollisionMesh() const {
+		return CollisionBuffer ? CollisionBuffer : MeshBuffer;
+	}
+
+	/**
+	 * Commits MeshBuffer, updating the render state and the collision if it changed.
+	 */
+	void UpdateMesh(const bool bCollisionChanged);
 
 	friend class FGeneratedMeshSceneProxy;
 };
\ No newline at end of file
@@ -61,7 +61,7 @@ void ABiomeRegion::GenerateBiomeRegionMesh() {
 		RegionData->GetBiomeRegionOffset().X, RegionData->GetBiomeRegionOffset().Y, 0);
 	
 	// Draw grid lines
-	std::vector<Triangle3D> gridTries;
+	std::vector<Triangle3D<>> gridTries;
 	Point3D tempVector31, tempVector32, tempVector33;
 	// Y lines
 	for (auto y = 0u; y < size; y++) {
@@ -83,7 +83,7 @@ void ABiomeRegion::GenerateBiomeRegionMesh() {
 	auto & graph = RegionData->DelaunayGraph;
 
 	// Draw points at every Delaunay point
-	std::vector<Triangle3D> pointTries;
+	std::vector<Triangle3D<>> pointTries;
 	auto verts = graph.GetVertices();
 	for (auto v : verts) {
 		if (v->IsForeign())
@@ -95,7 +95,7 @@ void ABiomeRegion::GenerateBiomeRegionMesh() {
 	for (auto it : pointTries) triangles.Add(FMeshTriangle(it, vertexColor));
 
 	//// Draw convex hull
-	//std::vector<Triangle3D> edgeTries;
+	//std::vector<Triangle3D<>> edgeTries;
 	//auto hull = graph.ConvexHull;
 	//for (uint64 i = 0, j = 1; i < hull.size(); i++, j++) {
 	//	if (j == hull.size())
@@ -108,7 +108,7 @@ void ABiomeRegion::GenerateBiomeRegionMesh() {
 	//for (auto it : edgeTries) triangles.Add(FMeshTriangle(it, edgeColor));
 
 	// Draw lines at every Delaunay edge
-	std::vector<Triangle3D> edgeTries;
+	std::vector<Triangle3D<>> edgeTries;
 	auto edges = graph.GetUniqueEdges();
 	for (auto e : edges) {
 		if (e.Start->IsForeign() || e.End->IsForeign())
@@ -122,7 +122,7 @@ void ABiomeRegion::GenerateBiomeRegionMesh() {
 	for (auto it : edgeTries) triangles.Add(FMeshTriangle(it, edgeColor));
 
 	// Draw each Delaunay triangle
-	std::vector<Triangle3D> faceTries;
+	std::vector<Triangle3D<>> faceTries;
 	auto faces = graph.GetFaces();
 	for (auto f : faces) {
 		if (!f->IsDegenerate()) {
@@ -135,7 +135,7 @@ void ABiomeRegion::GenerateBiomeRegionMesh() {
 			tempVector31.Reset(verts[0]->GetPoint() * scale, biome1->GetElevation() * heightMultiplier);
 			tempVector32.Reset(verts[1]->GetPoint() * scale, biome2->GetElevation() * heightMultiplier);
 			tempVector33.Reset(verts[2]->GetPoint() * scale, biome3->GetElevation() * heightMultiplier);
-			faceTries.push_back(Triangle3D(tempVector31, tempVector32, tempVector33));
+			faceTries.push_back(Triangle3D<>(tempVector31, tempVector32, tempVector33));
 		}
 	}
 	for (auto it : faceTries) triangles.Add(FMeshTriangle(it, faceColor));
@@ -2,39 +2,31 @@
 #include "Chunk.h"
 
 #include <Utilities/UnrealBridge.h>
-#include <Utilities/Mesh/MarchingCubes.h>
 #include <Utilities/Mesh/DebugMeshHelpers.h>
 
+#include <algorithm>
 #include <cmath>
 
 using namespace utils;
 using namespace terrain;
 using namespace items;
 
-namespace terrain {
-	Option<TerrainRaytraceResult> TerrainResult(const ChunkPositionVector & entry) {
-		return Some(TerrainRaytraceResult(E_Terrain, entry, None<ItemDataId>()));
-	}
-
-	Option<TerrainRaytraceResult> ItemResult(
-		const ItemDataId & id, const ChunkPositionVector & pos
-	) {
-		return Some(TerrainRaytraceResult(E_PlacedItem, pos, Some(id)));
-	}
-
-	utils::Option<TerrainRaytraceResult> NoResult() {
-		return None<TerrainRaytraceResult>();
-	}
-}
-
 using ChunkDataSet = AChunk::ChunkDataSet;
 
 AChunk::AChunk(const FPostConstructInitializeProperties & PCIP)
-	: Super(PCIP), ChunkNeighbourData(NULL), ItemIdCounter(0)
+	: Super(PCIP), ChunkNeighbourData(NULL), Kernels(NULL), ItemIdCounter(0), MeshVersion(0),
+	CollisionLod(0), ChunkMaterial(NULL)
 {
+	// The asset lookup only runs for the first chunk constructed
+	struct FConstructorStatics {
+		ConstructorHelpers::FObjectFinder<UMaterial> TestMaterial;
+		FConstructorStatics() : TestMaterial(TEXT("Material'/Game/TestMaterial.TestMaterial'")) {}
+	};
+	static FConstructorStatics ConstructorStatics;
+
 	Mesh = PCIP.CreateDefaultSubobject<UGeneratedMeshComponent>(this, TEXT("GeneratedMesh"));
-	TestMaterial = ConstructorHelpers::FObjectFinder<UMaterial>(
-		TEXT("Material'/Game/TestMaterial.TestMaterial'")).Object;
+	Mesh->bDeferCollisionCooking = true;
+	TestMaterial = ConstructorStatics.TestMaterial.Object;
 	this->RootComponent = Mesh;
 }
 
@@ -62,43 +54,154 @@ AItem * AChunk::SpawnItem(const ItemDataPtr & itemData) {
 }
 
 ItemDataPtr AChunk::RemoveItem(const ItemDataPtr & itemData) {
-	Uint32 index = 0;
 	ItemDataPtr removed = NULL;
 
-	for (const auto & it : PlacedItems) {
+	for (Int32 index = 0; index < PlacedItems.Num(); index++) {
+		const auto & it = PlacedItems[index];
 		if (it.ItemId == itemData->ItemId) {
+			removed = it.ItemActor->GetItemData();
 			it.ItemActor->Destroy();
 			PlacedItems.RemoveAt(index);
-			removed = it.ItemActor->GetItemData();
 			break;
 		}
-		++index;
+	}
+
+	if (removed) {
+		auto & items = CurrentChunkData->PlacedItems;
+		items.erase(std::remove(items.begin(), items.end(), removed), items.end());
+		UpdateItemIndex(removed, false);
 	}
 
 	return removed;
 }
 
+void AChunk::UpdateItemIndex(const ItemDataPtr & itemData, const bool bInsert) {
+	// Items are registered in every chunk they touch, with their bounds offset into the
+	// space of each chunk
+	const auto nsize = ChunkNeighbourData.Size();
+	const double gcc = (double) TerrainGenParams->GridCellCount;
+	Point3D offsetVector;
+
+	for (Uint8 x = 0; x < nsize.X; x++) {
+		for (Uint8 y = 0; y < nsize.Y; y++) {
+			for (Uint8 z = 0; z < nsize.Z; z++) {
+				auto & index = ChunkNeighbourData.Get(x, y, z)->ItemIndex;
+				if (bInsert) {
+					offsetVector.X = ((double) CurrentChunkIndex.X - x) * gcc;
+					offsetVector.Y = ((double) CurrentChunkIndex.Y - y) * gcc;
+					offsetVector.Z = ((double) CurrentChunkIndex.Z - z) * gcc;
+					index.Insert(itemData, offsetVector);
+				} else {
+					index.Remove(itemData);
+				}
+			}
+		}
+	}
+}
+
 void AChunk::ReceiveDestroyed() {
 	for (const auto & it : PlacedItems)
 		it.ItemActor->Destroy();
 	Super::ReceiveDestroyed();
 }
 
-void AChunk::InitializeChunk(const TerrainGeneratorParameters * params) {
-	SolidTerrain.Reset(params->GridCellCount, params->GridCellCount, params->GridCellCount, false);
+void AChunk::InitializeChunk(
+	const TerrainGeneratorParameters * params,
+	UMaterialInterface * material
+) {
+	SolidTerrain.Reset(params->GridCellCount);
 	TerrainGenParams = params;
+	Kernels = &GetChunkKernels();
+	ChunkMaterial = material;
+}
+
+void AChunk::ResetChunk() {
+	for (const auto & it : PlacedItems)
+		it.ItemActor->Destroy();
+	PlacedItems.Empty();
+
+	ChunkNeighbourData = ChunkDataSet(NULL);
+	CurrentChunkData.reset();
+	Apron.reset();
+	SolidTerrain.Clear();
+	Connectivity = ChunkConnectivity();
+	ItemIdCounter = 0;
+
+	// The mesh version is kept, so results for the previous position stay stale
+	RenderMesh.reset();
+	SlabTriangles.clear();
+	DirtyCells = ChunkCellRange();
+	NewDirtyCells = ChunkCellRange();
+	Mesh->ClearMeshTriangles();
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
 }
 
 void AChunk::SetChunkData(const ChunkDataSet & chunkData) {
 	ChunkNeighbourData = chunkData;
 	CurrentChunkIndex = chunkData.Size() / Uint32(2);
 	CurrentChunkData = chunkData.Get(CurrentChunkIndex);
-	// Make sure the item ID counter is at least 1 larger than the current largest ID
+	// Make sure the item ID counter is at least 1 larger than the current largest ID. The
+	// loader has already registered the items in the indexes of the neighbours.
 	for (const auto & itemData : CurrentChunkData->PlacedItems) {
 		if (itemData->ItemId >= ItemIdCounter)
 			ItemIdCounter = itemData->ItemId + 1;
 	}
-	GenerateChunkMesh();
+	UpdateApron();
+}
+
+bool AChunk::UpdateApron() {
+	const Uint32 cellCount = TerrainGenParams->GridCellCount;
+	const auto updated = UpdateChunkApron(Apron, ChunkNeighbourData, *Kernels, cellCount);
+	if (updated == Apron)
+		return false;
+
+	Apron = updated;
+	Kernels->FillSolid(*Apron, SolidTerrain, cellCount);
+	Connectivity = ChunkConnectivity::FromOccupancy(SolidTerrain);
+	return true;
+}
+
+ChunkMeshRequest AChunk::CreateMeshRequest(const Uint64 version, const Uint32 collisionLod) {
+	const Uint32 cellCount = TerrainGenParams->GridCellCount;
+	MeshVersion = version;
+	CollisionLod = collisionLod;
+	UpdateApron();
+
+	ChunkMeshRequest request;
+	request.ChunkOffset = CurrentChunkData->ChunkOffset;
+	request.Version = version;
+	request.Apron = Apron;
+	request.Kernels = Kernels;
+	request.Scale = (float) (TerrainGenParams->ChunkScale / cellCount);
+	request.CellCount = cellCount;
+	request.MaterialId = 0;
+	request.CollisionLod = collisionLod;
+	request.PreviousMesh = RenderMesh;
+	request.PreviousSlabTriangles = SlabTriangles;
+	request.Dirty = DirtyCells;
+	NewDirtyCells = ChunkCellRange();
+	return request;
+}
+
+void AChunk::MarkDirty(const ChunkCellRange & cells) {
+	DirtyCells.Include(cells);
+	NewDirtyCells.Include(cells);
+}
+
+bool AChunk::CommitMesh(const ChunkMeshResult & result) {
+	if (result.Version != MeshVersion)
+		return false;
+
+	// Only edits made after this request are still missing from the mesh
+	RenderMesh = result.Mesh;
+	SlabTriangles = result.SlabTriangles;
+	DirtyCells = NewDirtyCells;
+
+	TArray<UMaterialInterface *> materials;
+	materials.Add(ChunkMaterial);
+	Mesh->SetGeneratedMeshBuffer(result.Mesh, materials, result.CollisionMesh);
+	return true;
 }
 
 bool AChunk::IsSolidTerrainAt(const Point3D & point) const {
@@ -123,44 +226,25 @@ bool AChunk::IsSolidTerrainAt(const Point3D & point) const {
 	// Check for solidness of coordinate, depending on the algorithm used, we will probably need
 	// to change this section.
 	// TODO: change this to suit terrain mesh generation algorithm
-	const auto startIndex = EFloor(point);
-	const auto nsize = ChunkNeighbourData.Size().Cast<Int64>();
-	const auto curIndex = CurrentChunkIndex.Cast<Int64>();
-	double sum = 0;
-
-	for (Int64 x = startIndex.X; x <= startIndex.X + 1; x++) {
-		for (Int64 y = startIndex.Y; y <= startIndex.Y + 1; y++) {
-			for (Int64 z = startIndex.Z; z <= startIndex.Z + 1; z++) {
-				// If this incoming point is outside the current chunk, we should check the
-				// neighbours to check for collisions.
-				const auto startingPos = ChunkPositionVector(curIndex, Point3D(x, y, z));
-				const auto offsetPos = TerrainGenParams->Normalize(startingPos);
-
-				if (offsetPos.ChunkOffset.IsBoundedBy(Vector3D<Int64>(0), nsize)) {
-					ChunkDataPtr cdata = ChunkNeighbourData.Get(
-						offsetPos.ChunkOffset.X, offsetPos.ChunkOffset.Y, offsetPos.ChunkOffset.Z);
-
-					sum += cdata->DensityData.Get(
-						offsetPos.InnerOffset.X, offsetPos.InnerOffset.Y, offsetPos.InnerOffset.Z);
-				} else {
-					// If this point doesn't fall within the current chunk, nor within its
-					// immediate neighbours, then we return true as a conservative estimate.
-					return true;
-				}
-			}
-		}
-	}
-	return EGT(sum, 0);
+	return Kernels->IsSolidAt(*Apron, EFloor(point), TerrainGenParams->GridCellCount);
 }
 
 bool AChunk::IsSolidTerrainAt(const AxisAlignedBoundingBox3D & bound) const {
 	const auto lower = EFloor(bound.MinPoint);
 	const auto upper = ECeil(bound.MaxPoint);
+	const Int64 cellCount = (Int64) TerrainGenParams->GridCellCount;
 	for (Int64 x = lower.X; x < upper.X; x++) {
 		for (Int64 y = lower.Y; y < upper.Y; y++) {
 			for (Int64 z = lower.Z; z < upper.Z; z++) {
-				if (IsSolidTerrainAt(Point3D(x, y, z)))
+				// Cells within the chunk are answered by the occupancy cache, only the cells
+				// that spill over into the neighbours need to sample the density data.
+				if (x >= 0 && y >= 0 && z >= 0 &&
+						x < cellCount && y < cellCount && z < cellCount) {
+					if (SolidTerrain.Get((Uint32) x, (Uint32) y, (Uint32) z))
+						return true;
+				} else if (IsSolidTerrainAt(Point3D(x, y, z))) {
 					return true;
+				}
 			}
 		}
 	}
@@ -168,17 +252,8 @@ bool AChunk::IsSolidTerrainAt(const AxisAlignedBoundingBox3D & bound) const {
 }
 
 Option<ItemDataId> AChunk::FindItemCollision(const AxisAlignedBoundingBox3D & bound) const {
-	// Check items to make sure nothing occupies this location. Perhaps using an octree
-	// might be wise here.
-	for (const auto & item : PlacedItems) {
-		const auto & itemData = item.ItemActor->GetItemData();
-		if (bound.BoundingBoxIntersection(itemData->GetBoundingBox(), false))
-			return Some(ItemDataId(item.ItemId, CurrentChunkData->ChunkOffset));
-	}
-
-	// Check against items in neighbouring chunks since some items may span multiple grid
-	// cells. This section will likely need to be optimized, since it could become very
-	// costly with large numbers of items.
+	// Every item touching a chunk is registered in that chunk's index, so only the chunks
+	// overlapped by the bounding box need to be searched. This is usually just this chunk.
 	const auto nsize = ChunkNeighbourData.Size();
 	const auto curIndex = nsize / Uint32(2);
 
@@ -190,20 +265,19 @@ Option<ItemDataId> AChunk::FindItemCollision(const AxisAlignedBoundingBox3D & bo
 	for (Uint8 x = 0; x < nsize.X; x++) {
 		for (Uint8 y = 0; y < nsize.Y; y++) {
 			for (Uint8 z = 0; z < nsize.Z; z++) {
-				if (x != curIndex.X || y != curIndex.Y || z != curIndex.Z) {
-					offsetVector.X = ((double) x - curIndex.X) * gcc;
-					offsetVector.Y = ((double) y - curIndex.Y) * gcc;
-					offsetVector.Z = ((double) z - curIndex.Z) * gcc;
-
-					offsetBox.MinPoint = bound.MinPoint - offsetVector;
-					offsetBox.MaxPoint = bound.MaxPoint - offsetVector;
-
-					const auto & chunkData = ChunkNeighbourData.Get(x, y, z);
-					for (const auto & item : chunkData->PlacedItems) {
-						if (offsetBox.BoundingBoxIntersection(item->GetBoundingBox(), false))
-							return Some(ItemDataId(item->ItemId, CurrentChunkData->ChunkOffset));
-					}
-				}
+				offsetVector.X = ((double) x - curIndex.X) * gcc;
+				offsetVector.Y = ((double) y - curIndex.Y) * gcc;
+				offsetVector.Z = ((double) z - curIndex.Z) * gcc;
+
+				offsetBox.MinPoint = bound.MinPoint - offsetVector;
+				offsetBox.MaxPoint = bound.MaxPoint - offsetVector;
+				if (offsetBox.MaxPoint.X < 0 || offsetBox.MaxPoint.Y < 0 || offsetBox.MaxPoint.Z < 0 ||
+						offsetBox.MinPoint.X > gcc || offsetBox.MinPoint.Y > gcc || offsetBox.MinPoint.Z > gcc)
+					continue;
+
+				const auto found = ChunkNeighbourData.Get(x, y, z)->ItemIndex.FindCollision(offsetBox);
+				if (found.IsValid())
+					return Some(ItemDataId((*found)->ItemId, (*found)->Position.ChunkOffset));
 			}
 		}
 	}
@@ -222,109 +296,48 @@ AItem * AChunk::CreateItem(const items::ItemDataPtr & itemData, const bool prese
 			itemData->ItemId = ItemIdCounter++;
 		itemData->bIsPlaced = true;
 		CurrentChunkData->PlacedItems.push_back(itemData);
+		UpdateItemIndex(itemData, true);
 		return SpawnItem(itemData);
 	}
 	return NULL;
 }
 
-void AChunk::GenerateChunkMesh() {
-	auto material = UMaterialInstanceDynamic::Create((UMaterial *) TestMaterial, this);
-
-	Uint32 cellCount = TerrainGenParams->GridCellCount;
-
-	double scale = TerrainGenParams->ChunkScale / cellCount;
-
-	std::vector<Triangle3D> tempTris;
-	Vector3D<double> displacementVector;
-
-	GridCell gridCell;
-	Tensor3D<float> densityDataPoints(cellCount + 1);
-	
-	// Populate the density data
-	for (Uint32 x = 0; x < cellCount + 1; x++) {
-		for (Uint32 y = 0; y < cellCount + 1; y++) {
-			for (Uint32 z = 0; z < cellCount + 1; z++) {
-				ChunkDataPtr mainData =
-					ChunkNeighbourData.Get(x / cellCount + 1, y / cellCount + 1, z / cellCount + 1);
-				densityDataPoints.Set(
-					x, y, z, mainData->DensityData.Get(
-						x % cellCount, y % cellCount, z % cellCount));
-			}
-		}
-	}
-
-	std::vector<Triangle3D> triangles;
-
-	// Build the mesh
-	for (Uint32 x = 0; x < cellCount; x++) {
-		for (Uint32 y = 0; y < cellCount; y++) {
-			for (Uint32 z = 0; z < cellCount; z++) {
-				gridCell.Initialize(
-					densityDataPoints.Get(x, y, z),
-					densityDataPoints.Get(x, y, z + 1),
-					densityDataPoints.Get(x, y + 1, z),
-					densityDataPoints.Get(x, y + 1, z + 1),
-					densityDataPoints.Get(x + 1, y, z),
-					densityDataPoints.Get(x + 1, y, z + 1),
-					densityDataPoints.Get(x + 1, y + 1, z),
-					densityDataPoints.Get(x + 1, y + 1, z + 1));
-
-				// Set the solid terrain cache if this grid cell is filled
-				if (gridCell.Sum() > FLOAT_ERROR)
-					SolidTerrain.Set(x, y, z, true);
-
-				tempTris.clear();
-				MarchingCube(tempTris, 0, gridCell);
-
-				displacementVector.Reset((double) x, (double) y, (double) z);
-
-				for (auto & trit : tempTris) {
-					Triangle3D tri(
-						(trit.Point1 + displacementVector) * scale,
-						(trit.Point2 + displacementVector) * scale,
-						(trit.Point3 + displacementVector) * scale);
-					triangles.push_back(tri);
-				}
-			}
-		}
-	}
-
-	if (triangles.size() > 0) {
-		TArray<FMeshTriangle> meshTriangles;
-		for (auto it : triangles)
-			meshTriangles.Add(FMeshTriangle(it, material));
-		Mesh->SetGeneratedMeshTriangles(meshTriangles);
-	}
-}
-
 Option<TerrainRaytraceResult> AChunk::Raytrace(const Ray3D & ray, const double maxDistance) {
+	// Items spilling over from the neighbouring chunks are registered in this chunk's index
+	const auto & itemIndex = CurrentChunkData->ItemIndex;
+	if (SolidTerrain.IsEmpty() && itemIndex.IsEmpty())
+		return NoResult();
+
 	FastVoxelTraversalIterator fvt(
 		Vector3D<>(1.0), Vector3D<Int64>(0), Vector3D<Int64>(TerrainGenParams->GridCellCount),
 		ray, maxDistance / TerrainGenParams->ChunkGridUnitSize);
 
-	for (Uint16 i = 0; fvt.IsValid(); i++) {
+	while (fvt.IsValid()) {
 		const auto & current = fvt.GetCurrentCell();
 		if (current.IsBoundedBy(0, TerrainGenParams->GridCellCount)) {
-			// TODO: make this work as single ray cast instead
-			const double inset = 0.01; // Accounts for rounding errors
-			const AxisAlignedBoundingBox3D bb(
-				Point3D(current.X + inset, current.Y + inset, current.Z + inset),
-				Point3D(current.X + 1 - inset, current.Y + 1 - inset, current.Z + 1 - inset));
+			const Uint32 x = (Uint32) current.X;
+			const Uint32 y = (Uint32) current.Y;
+			const Uint32 z = (Uint32) current.Z;
+
+			if (SolidTerrain.IsBrickEmptyAt(x, y, z) && itemIndex.IsBucketEmptyAt(x, y, z)) {
+				fvt.SkipBlock(OccupancyGrid3D::BRICK_SIZE);
+				continue;
+			}
+
 			const auto & precollisionIndex = fvt.GetPreviousCell();
 			const ChunkPositionVector prevPos(
 				CurrentChunkData->ChunkOffset, precollisionIndex.Cast<double>());
-			if (IsSolidTerrainAt(bb)) {
+			if (SolidTerrain.Get(x, y, z)) {
 				return TerrainResult(prevPos);
-			} else {
-				const auto item = FindItemCollision(bb);
+			} else if (!itemIndex.IsBucketEmptyAt(x, y, z)) {
+				const double inset = 0.01; // Accounts for rounding errors
+				const AxisAlignedBoundingBox3D bb(
+					Point3D(current.X + inset, current.Y + inset, current.Z + inset),
+					Point3D(current.X + 1 - inset, current.Y + 1 - inset, current.Z + 1 - inset));
+				const auto item = itemIndex.FindCollision(bb);
 				if (item.IsValid())
-					return ItemResult(*item, prevPos);
+					return ItemResult(ItemDataId((*item)->ItemId, (*item)->Position.ChunkOffset), prevPos);
 			}
-				/*const auto & collisionIndex = fvt.GetCurrentCell();
-				const auto & precollisionIndex = fvt.GetPreviousCell();
-				return TerrainRaytraceResult(
-					found.Type, found.Result,
-					ChunkPositionVector(CurrentChunkData->ChunkOffset, precollisionIndex.Cast<double>()));*/
 		}
 
 		fvt.Next();
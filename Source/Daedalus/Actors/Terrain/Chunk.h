@@ -6,10 +6,15 @@
 #include <Actors/Items/Item.h>
 #include <Controllers/DDGameState.h>
 #include <Models/Terrain/ChunkData.h>
+#include <Models/Terrain/ChunkKernels.h>
+#include <Models/Terrain/ChunkMesher.h>
+#include <Models/Terrain/ChunkVisibility.h>
 #include <Models/Terrain/TerrainDataStructures.h>
+#include <Models/Terrain/TerrainRaytrace.h>
 #include <Utilities/DataStructures.h>
 #include <Utilities/Algebra/Algebra3D.h>
 #include <Utilities/FastVoxelTraversal.h>
+#include <Utilities/OccupancyGrid.h>
 
 #include <utility>
 
@@ -17,32 +22,6 @@
 
 class AChunk;
 
-namespace terrain {
-	enum TerrainRaytraceResultType {
-		E_Character,
-		E_Terrain,
-		E_PlacedItem
-	};
-
-	struct TerrainRaytraceResult {
-		const TerrainRaytraceResultType Type;
-		utils::Option<items::ItemDataId> ItemId;
-		const ChunkPositionVector EntryPosition;
-
-		TerrainRaytraceResult(
-			const TerrainRaytraceResultType type,
-			const ChunkPositionVector & pos,
-			const utils::Option<items::ItemDataId> itemId
-		) : Type(type), ItemId(itemId), EntryPosition(pos)
-		{}
-	};
-
-	utils::Option<TerrainRaytraceResult> TerrainResult(const ChunkPositionVector & entry);
-	utils::Option<TerrainRaytraceResult> ItemResult(
-		const items::ItemDataId & id, const ChunkPositionVector & pos);
-	utils::Option<TerrainRaytraceResult> NoResult();
-}
-
 USTRUCT()
 struct FItemPtrPair {
 	GENERATED_USTRUCT_BODY()
@@ -60,7 +39,7 @@ class AChunk : public AActor {
 	GENERATED_UCLASS_BODY()
 public:
 	// (1, 1) is the root chunk data for this actor, the others are neighbours for tiling
-	using ChunkDataSet = utils::TensorFixed3D<terrain::ChunkDataPtr, 3>;
+	using ChunkDataSet = terrain::ChunkDataSet;
 
 private:
 	// Convenience vector that stores the position of the current chunk within the neighbour data
@@ -69,18 +48,34 @@ private:
 	terrain::ChunkDataPtr CurrentChunkData;
 
 	const terrain::TerrainGeneratorParameters * TerrainGenParams;
-	utils::TensorResizable3D<bool> SolidTerrain;
+	const terrain::ChunkKernels * Kernels;
+	terrain::ChunkApronPtr Apron;                    // Samples of the chunk and its borders
+	utils::OccupancyGrid3D SolidTerrain;             // Solidity of each grid cell in this chunk
+	terrain::ChunkConnectivity Connectivity;         // Faces joined through empty cells
 	Uint64 ItemIdCounter;                            // Used to store the minimum unique ID
+	Uint64 MeshVersion;                              // Latest mesh request, older ones are stale
+	Uint32 CollisionLod;                             // Collision detail of the latest request
+
+	utils::MeshBufferConstPtr RenderMesh;            // The committed render mesh
+	std::vector<Uint32> SlabTriangles;               // Triangles in each slab of RenderMesh
+	terrain::ChunkCellRange DirtyCells;              // Changed since RenderMesh was requested
+	terrain::ChunkCellRange NewDirtyCells;           // Changed since the latest request
 
 
 
 	/**
-	 * @param boundingBox Bounding box to search for intersections, the values should be in
-	 *                    grid coordinate space.
+	 * Rebuilds the apron if the chunk or any of its neighbours changed since it was built,
+	 * along with the solid terrain and connectivity derived from it.
+	 * @return True if the apron was rebuilt.
 	 */
-	void GenerateChunkMesh();
+	bool UpdateApron();
+
 	AItem * SpawnItem(const items::ItemDataPtr & itemData);
 	items::ItemDataPtr RemoveItem(const items::ItemDataPtr & itemData);
+	/**
+	 * Adds or removes the item from the spatial index of every chunk it touches.
+	 */
+	void UpdateItemIndex(const items::ItemDataPtr & itemData, const bool bInsert);
 
 	bool IsSolidTerrainAt(const utils::Point3D & point) const;
 	bool IsSolidTerrainAt(const utils::AxisAlignedBoundingBox3D & bound) const;
@@ -100,11 +95,58 @@ public:
 		TSubobjectPtr<UGeneratedMeshComponent> Mesh;
 	UPROPERTY()
 		UMaterial * TestMaterial;
+	UPROPERTY()
+		UMaterialInterface * ChunkMaterial;      // Shared by every chunk
 	UPROPERTY(Category = Items, VisibleAnywhere)
 		TArray<FItemPtrPair> PlacedItems;
 
-	void InitializeChunk(const terrain::TerrainGeneratorParameters * params);
+	/**
+	 * Called once after the actor is spawned. Pooled chunks keep these across positions.
+	 * @param material Material instance shared by the chunks, owned by the caller.
+	 */
+	void InitializeChunk(
+		const terrain::TerrainGeneratorParameters * params,
+		UMaterialInterface * material);
+	/**
+	 * Clears the data, items and mesh of the chunk so that the actor can be pooled and later
+	 * reused for another position with SetChunkData. The chunk is hidden and doesn't collide
+	 * until it is reused.
+	 */
+	void ResetChunk();
+	/**
+	 * Sets the chunk data and updates the solid terrain and connectivity. The mesh is not
+	 * generated here, it has to be requested with CreateMeshRequest.
+	 */
 	void SetChunkData(const ChunkDataSet & chunkData);
+
+	/**
+	 * @return Which faces of the chunk can see each other through the empty cells.
+	 */
+	inline const terrain::ChunkConnectivity & GetConnectivity() const { return Connectivity; }
+
+	/**
+	 * Creates a request to mesh the current chunk data off the game thread. Any request made
+	 * before this one becomes stale.
+	 * @param version Identifies the request, it must be unique across all chunks so that
+	 *                results for a previous chunk at the same position are never committed.
+	 * @param collisionLod Level of detail of the collision mesh, 0 to collide with the
+	 *                     render mesh.
+	 */
+	terrain::ChunkMeshRequest CreateMeshRequest(const Uint64 version, const Uint32 collisionLod);
+	inline Uint32 GetCollisionLod() const { return CollisionLod; }
+
+	/**
+	 * Records cells whose mesh is out of date after a terrain edit. The next mesh request
+	 * only rebuilds the slabs of cells that changed since the committed mesh was requested.
+	 */
+	void MarkDirty(const terrain::ChunkCellRange & cells);
+
+	/**
+	 * Swaps a finished mesh into the mesh component on the game thread. The collision is
+	 * left dirty in the mesh component, to be cooked by the owner.
+	 * @return False if the result is stale and was discarded.
+	 */
+	bool CommitMesh(const terrain::ChunkMeshResult & result);
 	AItem * CreateItem(const items::ItemDataPtr & itemData, const bool preserveId = false);
 	
 	/**
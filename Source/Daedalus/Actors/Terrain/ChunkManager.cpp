@@ -2,27 +2,40 @@
 #include "ChunkManager.h"
 
 #include <Models/Terrain/ChunkLoader.h>
-#include <Utilities/FastVoxelTraversal.h>
+#include <Models/Terrain/TerrainRaytrace.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
 
 using namespace utils;
 using namespace events;
 using namespace terrain;
 using namespace items;
 
+namespace {
+	inline Int64 ChunkDistance(const ChunkOffsetVector & a, const ChunkOffsetVector & b) {
+		return std::max(std::abs(a.X - b.X), std::max(std::abs(a.Y - b.Y), std::abs(a.Z - b.Z)));
+	}
+}
+
 // TODO: pull out the item factory and data factory into a more global class
 AChunkManager::AChunkManager(const class FPostConstructInitializeProperties & PCIP) :
-	Super(PCIP), RenderDistance(1)
-{}
+	Super(PCIP), ChunkMaterial(NULL), RenderDistance(1), CollisionLodDistance(1), CollisionCookBudget(2),
+	MeshResults(new ChunkMeshResultQueue()), MeshVersionCounter(0), PlayerChunk(0, 0, 0),
+	ViewChunk(0, 0, 0), bVisibilityDirty(false), PlayerObserver(0), NextObserverId(1),
+	ChunkLoadBudget(4), PrefetchBudget(1), PrefetchMeshLimit(2),
+	MeshesInFlight(0), AutosaveInterval(60), AutosaveTimer(0)
+{
+	PrimaryActorTick.bCanEverTick = true;
+}
 
 void AChunkManager::UpdateChunksAt(const utils::Vector3D<> & playerPosition) {
 	ChunkOffsetVector offset;
-	FRotator defaultRotation(0, 0, 0);
-	
-	FActorSpawnParameters defaultParameters;
-	defaultParameters.Owner = this;
 
 	// Get player's current chunk location
 	auto playerChunkPos = GenParams->ToGridCoordSpace(playerPosition);
+	PlayerChunk = playerChunkPos.ChunkOffset;
 
 	Int64 fromX = playerChunkPos.ChunkOffset.X - RenderDistance;
 	Int64 fromY = playerChunkPos.ChunkOffset.Y - RenderDistance;
@@ -32,93 +45,267 @@ void AChunkManager::UpdateChunksAt(const utils::Vector3D<> & playerPosition) {
 	Int64 toY = playerChunkPos.ChunkOffset.Y + RenderDistance;
 	Int64 toZ = playerChunkPos.ChunkOffset.Z + RenderDistance;
 
-	// Once the player leaves an area, the chunks are cleared
+	// Once the player leaves an area, the chunks are cleared, unless the player is headed there
 	for (auto chunkKey = LocalCache.begin(); chunkKey != LocalCache.end(); ) {
-		if (chunkKey->first.X > toX || chunkKey->first.Y > toY ||
+		if ((chunkKey->first.X > toX || chunkKey->first.Y > toY ||
 				chunkKey->first.Z > toZ || chunkKey->first.X < fromX ||
-				chunkKey->first.Y < fromY || chunkKey->first.Z < fromZ) {
-			chunkKey->second->Destroy();
+				chunkKey->first.Y < fromY || chunkKey->first.Z < fromZ) &&
+				!(Prefetcher && Prefetcher->IsPrefetched(chunkKey->first))) {
+			ReleaseChunk(chunkKey->second);
 			chunkKey = LocalCache.erase(chunkKey);
+			bVisibilityDirty = true;
 		} else {
+			// Remesh chunks that moved in or out of the detailed collision range
+			if (chunkKey->second->GetCollisionLod() != GetCollisionLodAt(chunkKey->first))
+				RequestChunkMesh(chunkKey->second, chunkKey->first);
 			++chunkKey;
 		}
 	}
+	for (auto skipped = SkippedChunks.begin(); skipped != SkippedChunks.end(); ) {
+		if (ChunkDistance(skipped->first, PlayerChunk) > (Int64) RenderDistance)
+			skipped = SkippedChunks.erase(skipped);
+		else
+			++skipped;
+	}
 
 	// Begin preloading chunks for the area the player is near
 	for (Int64 x = fromX; x <= toX; x++) {
 		for (Int64 y = fromY; y <= toY; y++) {
 			for (Int64 z = fromZ; z <= toZ; z++) {
 				offset.Reset(x, y, z);
-				GetChunkAt(offset);
+				if (LocalCache.count(offset) > 0 || SkippedChunks.count(offset) > 0)
+					continue;
+				// The column summary rules out the sky and the deep ground without generating
+				const auto band = ChunkLoaderRef->ClassifyChunk(offset);
+				if (band == E_Surface) {
+					GetChunkAt(offset);
+				} else {
+					SkippedChunks.insert({ offset, band });
+					bVisibilityDirty = true;
+				}
 			}
 		}
 	}
 }
 
-AChunk * AChunkManager::GetChunkAt(const ChunkOffsetVector & point) {
-	FRotator defaultRotation(0, 0, 0);
+AChunk * AChunkManager::AcquireChunk(const FVector & position) {
+	if (!ChunkPool.empty()) {
+		AChunk * chunk = ChunkPool.back();
+		ChunkPool.pop_back();
+		chunk->SetActorLocation(position);
+		chunk->SetActorEnableCollision(true);
+		return chunk;
+	}
+
 	FActorSpawnParameters defaultParameters;
 	defaultParameters.Owner = this;
+	AChunk * chunk = GetWorld()->SpawnActor<AChunk>(
+		AChunk::StaticClass(), position, FRotator(0, 0, 0), defaultParameters);
+	chunk->InitializeChunk(GenParams, ChunkMaterial);
+	chunk->AttachRootComponentToActor(this);
+	return chunk;
+}
 
+void AChunkManager::ReleaseChunk(AChunk * chunk) {
+	chunk->ResetChunk();
+	ChunkPool.push_back(chunk);
+}
+
+AChunk * AChunkManager::GetChunkAt(const ChunkOffsetVector & point, const JobPriority priority) {
 	// Chunk is cached already
 	if (LocalCache.count(point) > 0) {
 		return LocalCache.at(point);
 	} else {
-		auto data = AChunk::ChunkDataSet();
-		Uint8 w = data.GetWidth(), d = data.GetDepth(), h = data.GetHeight();
-		for (Uint8 x = 0; x < w; x++) {
-			for (Uint8 y = 0; y < d; y++) {
-				for (Uint8 z = 0; z < h; z++) {
-					data.Set(x, y, z, ChunkLoaderRef->GetChunkAt({
-						point.X + x - w / 2, point.Y + y - d / 2, point.Z + z - h / 2
-					}));
-				}
-			}
-		}
+		const auto & data = ChunkLoaderRef->GetChunkSetAt(point);
 		auto position = ToFVector(GenParams->ToRealCoordSpace(point));
 
 		//UE_LOG(LogTemp, Error, TEXT("Placing chunk at %f %f %f"), position.X, position.Y, position.Z)
-		AChunk * newChunk = GetWorld()->SpawnActor<AChunk>(
-			AChunk::StaticClass(), position, defaultRotation, defaultParameters);
-		newChunk->InitializeChunk(GenParams);
+		AChunk * newChunk = AcquireChunk(position);
 		newChunk->SetChunkData(data);
-		newChunk->AttachRootComponentToActor(this);
 		LocalCache.insert({ point, newChunk });
+		RequestChunkMesh(newChunk, point, priority);
+		bVisibilityDirty = true;
 		return newChunk;
 	}
 }
 
-Option<TerrainRaytraceResult> AChunkManager::Raytrace(
-	const utils::Ray3D & viewpoint,
-	const double maxDist
+Uint32 AChunkManager::GetCollisionLodAt(const ChunkOffsetVector & offset) const {
+	return ChunkDistance(offset, PlayerChunk) > (Int64) CollisionLodDistance ? 1 : 0;
+}
+
+void AChunkManager::RequestChunkMesh(
+	AChunk * chunk,
+	const ChunkOffsetVector & offset,
+	const JobPriority priority
 ) {
-	FastVoxelTraversalIterator fvt(Point3D(GenParams->ChunkScale), viewpoint, maxDist);
+	const auto request = chunk->CreateMeshRequest(++MeshVersionCounter, GetCollisionLodAt(offset));
+	const auto results = MeshResults;
+	GetJobSystem().Submit([request, results] {
+		results->Push(BuildChunkMesh(request));
+	}, priority);
+	MeshesInFlight++;
+}
+
+void AChunkManager::CommitChunkMeshes() {
+	std::vector<ChunkMeshResult> results;
+	MeshResults->TakeAll(results);
+	MeshesInFlight -= std::min(MeshesInFlight, (Uint32) results.size());
+
+	for (const auto & result : results) {
+		const auto found = LocalCache.find(result.ChunkOffset);
+		if (found == LocalCache.end() || !found->second->CommitMesh(result))
+			continue;
+
+		const bool bQueued = std::find(PendingCollision.begin(), PendingCollision.end(),
+			result.ChunkOffset) != PendingCollision.end();
+		if (!bQueued && found->second->Mesh->IsCollisionDirty())
+			PendingCollision.push_back(result.ChunkOffset);
+	}
+}
+
+void AChunkManager::CookChunkCollisions() {
+	if (PendingCollision.empty())
+		return;
+
+	// Sorted furthest first, so the nearest chunks can be popped off the back
+	const auto & player = PlayerChunk;
+	std::sort(PendingCollision.begin(), PendingCollision.end(),
+		[&player] (const ChunkOffsetVector & a, const ChunkOffsetVector & b) {
+			return ChunkDistance(a, player) > ChunkDistance(b, player);
+		});
+
+	Uint32 cooked = 0;
+	while (cooked < CollisionCookBudget && !PendingCollision.empty()) {
+		const auto found = LocalCache.find(PendingCollision.back());
+		PendingCollision.pop_back();
+
+		// Skip chunks that have been unloaded since
+		if (found != LocalCache.end() && found->second->Mesh->IsCollisionDirty()) {
+			found->second->Mesh->UpdateCollision();
+			cooked++;
+		}
+	}
+}
+
+void AChunkManager::UpdateChunkVisibility() {
+	bVisibilityDirty = false;
+
+	static const ChunkConnectivity SkyConnectivity = ChunkConnectivity::All();
+	std::unordered_set<ChunkOffsetVector> visible;
+	FindVisibleChunks(ViewChunk, (Int64) RenderDistance,
+		[this] (const ChunkOffsetVector & offset) -> const ChunkConnectivity * {
+			const auto found = LocalCache.find(offset);
+			if (found != LocalCache.end())
+				return &found->second->GetConnectivity();
+			// The view carries on through skipped sky chunks, and ends at buried ones
+			const auto skipped = SkippedChunks.find(offset);
+			return skipped != SkippedChunks.end() && skipped->second == E_Sky ?
+				&SkyConnectivity : NULL;
+		},
+		visible);
+
+	for (const auto & entry : LocalCache) {
+		const bool bHidden = visible.count(entry.first) == 0;
+		if (entry.second->bHidden != bHidden)
+			entry.second->SetActorHiddenInGame(bHidden);
+	}
+}
 
-	bool foundIntersect = false;
-	Vector3D<Int64> chunkPosition = fvt.GetCurrentCell();
+void AChunkManager::PrefetchChunks() {
+	// Chunks that would be skipped cost nothing to stream in later
+	const auto shouldLoad = [this] (const ChunkOffsetVector & offset) {
+		return LocalCache.count(offset) == 0 &&
+			ChunkLoaderRef->ClassifyChunk(offset) == E_Surface;
+	};
 
-	// Search through adjacent chunks
-	while (fvt.IsValid()) {
-		// Get current chunk location
-		const auto chunkPos = GenParams->ToGridCoordSpace(viewpoint.Origin, chunkPosition);
-		auto chunk = GetChunkAt(chunkPos.ChunkOffset);
-		const auto result =
-			chunk->Raytrace(Ray3D(chunkPos.InnerOffset, viewpoint.Direction), maxDist);
+	ChunkOffsetVector offset;
+	Uint32 prefetched = 0;
+	while (prefetched < PrefetchBudget && MeshesInFlight < PrefetchMeshLimit) {
+		if (!Prefetcher->NextPrefetch(offset, shouldLoad))
+			break;
+		prefetched++;
+
+		// The visibility cull keeps the chunk hidden until the player is in range
+		const ObserverId id = NextObserverId++;
+		Interest.AddObserver(id, offset, 1, 0);
+		PrefetchObservers.insert({ offset, id });
+		GetChunkAt(offset, J_Low);
+	}
+}
 
-		if (result.IsValid())
-			return result;
+void AChunkManager::UpdateInterest(const ChunkOffsetVector & playerChunk) {
+	InterestChanges changes;
+	if (Interest.HasObserver(PlayerObserver))
+		Interest.MoveObserver(PlayerObserver, playerChunk, changes);
+	else
+		Interest.AddObserver(PlayerObserver, playerChunk, (Int64) RenderDistance + 1, 1);
 
-		// If no intersections are found, we need to search adjacent chunks.
-		fvt.Next();
-		chunkPosition = fvt.GetCurrentCell();
+	for (auto entry = PrefetchObservers.begin(); entry != PrefetchObservers.end(); ) {
+		if (Prefetcher->IsPrefetched(entry->first)) {
+			++entry;
+		} else {
+			Interest.RemoveObserver(entry->second, changes);
+			entry = PrefetchObservers.erase(entry);
+		}
 	}
 
-	return NoResult();
+	// Chunks still shown keep their data, whatever the observers say
+	for (const auto & offset : changes.Unloaded) {
+		if (LocalCache.count(offset) == 0)
+			ChunkLoaderRef->UnloadChunk(offset);
+	}
+}
+
+void AChunkManager::LoadResidentChunks() {
+	std::vector<ChunkOffsetVector> loads;
+	Interest.TakeLoads(ChunkLoadBudget, loads);
+	for (const auto & offset : loads)
+		ChunkLoaderRef->GetChunkAt(offset);
+}
+
+Option<TerrainRaytraceResult> AChunkManager::Raytrace(
+	const utils::Ray3D & viewpoint,
+	const double maxDist
+) const {
+	return Raytrace(std::vector<Ray3D>(1, viewpoint), std::vector<double>(1, maxDist))[0];
+}
+
+TerrainRaytraceResults AChunkManager::Raytrace(
+	const std::vector<Ray3D> & viewpoints,
+	const std::vector<double> & maxDists
+) const {
+	const ChunkLoader & loader = *ChunkLoaderRef;
+	const TerrainRaytracer raytracer(loader.GetGeneratorParameters(),
+		[&loader] (const ChunkOffsetVector & offset) { return loader.FindLoadedChunk(offset); });
+	return raytracer.Raytrace(viewpoints, maxDists);
 }
 
 AItem * AChunkManager::PlaceItem(const items::ItemDataPtr & data) {
-	auto chunk = GetChunkAt(data->Position.ChunkOffset);
-	return chunk->CreateItem(data);
+	const auto found = LocalCache.find(data->Position.ChunkOffset);
+	if (found == LocalCache.end())
+		return NULL;
+	return found->second->CreateItem(data);
+}
+
+void AChunkManager::EditTerrain(const TerrainEdit & edit) {
+	DirtyChunkMap dirty;
+	ChunkLoaderRef->ApplyEdit(edit, dirty);
+
+	for (const auto & entry : dirty) {
+		const auto found = LocalCache.find(entry.first);
+		if (found == LocalCache.end()) {
+			// The edit broke the uniformity of a skipped chunk, so it is meshed from scratch
+			if (SkippedChunks.erase(entry.first) > 0)
+				GetChunkAt(entry.first, J_High);
+			continue;
+		}
+		found->second->MarkDirty(entry.second);
+		// The player is looking right at the edit
+		RequestChunkMesh(found->second, entry.first, J_High);
+	}
+
+	// Digging can open up paths between chunks, and filling can close them
+	bVisibilityDirty = true;
 }
 
 void AChunkManager::BeginPlay() {
@@ -127,17 +314,78 @@ void AChunkManager::BeginPlay() {
 	ChunkLoaderRef = GetGameState()->ChunkLoader;
 	GenParams = &ChunkLoaderRef->GetGeneratorParameters();
 	EventBusRef = GetGameState()->EventBus;
+	ChunkMaterial = UMaterialInstanceDynamic::Create(GetDefault<AChunk>()->TestMaterial, this);
+
+	// Edits from the last session are applied as the chunks are generated
+	const std::string savePath = TCHAR_TO_UTF8(*(FPaths::GameSavedDir() + TEXT("World.sav")));
+	std::ifstream saved(savePath, std::ios::binary);
+	if (saved) {
+		try {
+			ChunkLoaderRef->LoadChunkDeltas(saved);
+		} catch (const StringException & e) {
+			UE_LOG(LogTemp, Error, TEXT("Failed to load the world: %s"), UTF8_TO_TCHAR(e.what()));
+		}
+	}
+	WorldWriter.reset(new WorldSnapshotWriter(savePath));
+	Prefetcher.reset(new ChunkPrefetcher(GenParams, (Int64) RenderDistance, 2.0));
 
 	EventBusRef->AddListener(E_PlayerPosition, this);
 	EventBusRef->AddListener(E_ViewPosition, this);
 }
 
+void AChunkManager::Tick(float DeltaSeconds) {
+	Super::Tick(DeltaSeconds);
+	CommitChunkMeshes();
+	CookChunkCollisions();
+	LoadResidentChunks();
+	PrefetchChunks();
+	if (bVisibilityDirty)
+		UpdateChunkVisibility();
+
+	AutosaveTimer += DeltaSeconds;
+	if (AutosaveTimer >= AutosaveInterval)
+		Autosave();
+}
+
+void AChunkManager::BeginDestroy() {
+	// The class default object never began play, so it has no writer
+	if (WorldWriter) {
+		Autosave();
+		WorldWriter->Flush();
+		WorldWriter.reset();
+	}
+	Super::BeginDestroy();
+}
+
+void AChunkManager::Autosave() {
+	AutosaveTimer = 0;
+	if (WorldWriter)
+		WorldWriter->Submit(ChunkLoaderRef->CreateSnapshot());
+}
+
 void AChunkManager::HandleEvent(const EventDataPtr & data) {
 	switch (data->Type) {
 	case E_PlayerPosition: {
 		auto castedData = std::static_pointer_cast<EPlayerPosition>(data);
 		//UE_LOG(LogTemp, Warning, TEXT("Player position: %f %f %f"), position.X, position.Y, position.Z);
+		Prefetcher->AddPosition(castedData->Position, GetWorld()->GetTimeSeconds());
+		Prefetcher->Predict([this] (const ChunkOffsetVector & offset) {
+			return LocalCache.count(offset) > 0;
+		});
+		const auto playerChunk = GenParams->ToGridCoordSpace(castedData->Position).ChunkOffset;
+		Prefetcher->UpdateStreamedArea(playerChunk);
 		UpdateChunksAt(castedData->Position);
+		UpdateInterest(playerChunk);
+		break;
+	}
+	case E_ViewPosition: {
+		auto castedData = std::static_pointer_cast<EViewPosition>(data);
+		const auto viewChunk = GenParams->ToGridCoordSpace(castedData->ViewRay.Origin).ChunkOffset;
+		Prefetcher->SetViewDirection(castedData->ViewRay.Direction);
+		if (!(viewChunk == ViewChunk)) {
+			ViewChunk = viewChunk;
+			bVisibilityDirty = true;
+		}
 		break;
 	}
 	}
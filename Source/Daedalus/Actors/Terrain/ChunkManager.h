@@ -4,10 +4,18 @@
 #include <Controllers/DDGameState.h>
 #include <Controllers/EventBus/EventBus.h>
 #include <Models/Items/ItemDataFactory.h>
+#include <Models/Terrain/ChunkMesher.h>
+#include <Models/Terrain/ChunkPrefetcher.h>
+#include <Models/Terrain/ChunkVisibility.h>
+#include <Models/Terrain/InterestManager.h>
+#include <Models/Terrain/TerrainEditing.h>
 #include <Models/Terrain/TerrainDataStructures.h>
+#include <Models/Terrain/WorldSnapshot.h>
+#include <Utilities/JobSystem.h>
 
 #include <unordered_map>
 #include <memory>
+#include <vector>
 
 #include "ChunkManager.generated.h"
 
@@ -26,28 +34,146 @@ private:
 	using ChunkCache = std::unordered_map<terrain::ChunkOffsetVector, AChunk *>;
 
 	ChunkCache LocalCache;
+	// Chunks in range that are uniform along with their neighbours, so they get no actor
+	std::unordered_map<terrain::ChunkOffsetVector, terrain::ChunkBand> SkippedChunks;
+	std::vector<AChunk *> ChunkPool;                  // Unloaded chunk actors, ready for reuse
+
+	UPROPERTY()
+		UMaterialInstanceDynamic * ChunkMaterial;     // Shared by every chunk
 
 	const Uint64 RenderDistance;                      // Specified in number of chunks
+	const Uint64 CollisionLodDistance;                // Chunks further away collide coarsely
+	const Uint32 CollisionCookBudget;                 // Chunk collisions cooked per tick
 
 	const terrain::TerrainGeneratorParameters * GenParams;
 	events::EventBusPtr EventBusRef;
 	terrain::ChunkLoaderPtr ChunkLoaderRef;
 
-	
+	terrain::ChunkMeshResultQueuePtr MeshResults;     // Filled by the mesh worker tasks
+	Uint64 MeshVersionCounter;                        // Last version handed to a mesh request
+	terrain::ChunkOffsetVector PlayerChunk;           // Chunk the player was last seen in
+	std::vector<terrain::ChunkOffsetVector> PendingCollision;
+	terrain::ChunkOffsetVector ViewChunk;             // Chunk the camera was last seen in
+	bool bVisibilityDirty;                            // Chunks or the view changed since the cull
+
+	terrain::InterestManager Interest;                // Decides which chunk data stays loaded
+	const terrain::ObserverId PlayerObserver;
+	terrain::ObserverId NextObserverId;               // Handed to the prefetched chunks
+	std::unordered_map<terrain::ChunkOffsetVector, terrain::ObserverId> PrefetchObservers;
+	const Uint32 ChunkLoadBudget;                     // Resident chunks generated per tick
+
+	std::unique_ptr<terrain::ChunkPrefetcher> Prefetcher;
+	const Uint32 PrefetchBudget;                      // Chunks prefetched per tick
+	const Uint32 PrefetchMeshLimit;                   // No prefetching above this many meshes
+	Uint32 MeshesInFlight;                            // Mesh requests not yet committed
+
+	std::unique_ptr<terrain::WorldSnapshotWriter> WorldWriter;
+	const float AutosaveInterval;                     // Seconds between autosaves
+	float AutosaveTimer;                              // Seconds since the last autosave
+
+	/**
+	 * Starts meshing the chunk as a job. The chunk keeps its current mesh until the result is
+	 * committed in Tick.
+	 */
+	void RequestChunkMesh(
+		AChunk * chunk,
+		const terrain::ChunkOffsetVector & offset,
+		const utils::JobPriority priority = utils::J_Normal);
+	/**
+	 * Swaps every finished mesh into its chunk, discarding results for chunks that have been
+	 * unloaded or re-requested since.
+	 */
+	void CommitChunkMeshes();
+	/**
+	 * Cooks the dirty collision of at most CollisionCookBudget chunks, nearest to the player
+	 * first, so that a burst of new meshes doesn't stall a single frame.
+	 */
+	void CookChunkCollisions();
+	/**
+	 * @return The collision level of detail for a chunk, based on its distance to the player.
+	 */
+	Uint32 GetCollisionLodAt(const terrain::ChunkOffsetVector & offset) const;
+	/**
+	 * Hides the chunks that can't be seen from the view chunk, walking out from it through
+	 * the faces each chunk connects with empty space. Caves and the inside of mountains are
+	 * never rendered from above ground, and vice versa.
+	 */
+	void UpdateChunkVisibility();
+	/**
+	 * Loads the chunks the player is predicted to reach next. Prefetching yields to the
+	 * chunks in range, so it only runs while few meshes are being built, loads at most
+	 * PrefetchBudget chunks per tick, and meshes them as low priority jobs.
+	 */
+	void PrefetchChunks();
+	/**
+	 * Moves the player's observer and drops the observers of chunks that are no longer
+	 * prefetched, then unloads the chunk data that no observer needs any more.
+	 */
+	void UpdateInterest(const terrain::ChunkOffsetVector & playerChunk);
+	/**
+	 * Generates at most ChunkLoadBudget of the resident chunks that haven't been loaded yet,
+	 * the chunks nearest to the player first.
+	 */
+	void LoadResidentChunks();
+	/**
+	 * Snapshots the edited chunks and hands the snapshot to the writer thread, so that the
+	 * frame only pays for pinning the chunks.
+	 */
+	void Autosave();
+
+	/**
+	 * Takes a chunk actor from the pool and moves it to the given position, spawning a new one
+	 * only if the pool is empty.
+	 */
+	AChunk * AcquireChunk(const FVector & position);
+	/**
+	 * Clears the chunk and returns it to the pool.
+	 */
+	void ReleaseChunk(AChunk * chunk);
 
 	inline ADDGameState * GetGameState() { return GetWorld()->GetGameState<ADDGameState>(); }
-	AChunk * GetChunkAt(const terrain::ChunkOffsetVector & point);
+	AChunk * GetChunkAt(
+		const terrain::ChunkOffsetVector & point,
+		const utils::JobPriority priority = utils::J_Normal);
 	void UpdateChunksAt(const utils::Vector3D<> & playerPosition);
 
 public:
 	virtual void HandleEvent(const events::EventDataPtr & data) override;
 	virtual void BeginPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
+	/**
+	 * Saves the world one last time and waits for the save to be written, so that the edits
+	 * made since the last autosave aren't lost when play ends.
+	 */
+	virtual void BeginDestroy() override;
 
+	/**
+	 * Traces a ray against the loaded chunk data, see the batch version.
+	 */
 	utils::Option<terrain::TerrainRaytraceResult> Raytrace(
-		const utils::Ray3D & viewpoint, const double maxDist);
+		const utils::Ray3D & viewpoint, const double maxDist) const;
+	/**
+	 * Traces a batch of rays against the loaded chunk data. This never spawns chunks or
+	 * generates terrain, and unloaded chunks are treated as empty.
+	 * @param viewpoints Rays in real world coordinates, the directions should be normal.
+	 * @param maxDists Maximum distance of each ray in real world units.
+	 */
+	terrain::TerrainRaytraceResults Raytrace(
+		const std::vector<utils::Ray3D> & viewpoints,
+		const std::vector<double> & maxDists) const;
 	/**
 	 * Creates a new item actor from the given item data. The item data is not duplicated, so
 	 * be sure to clone the item data before passing it in if spawning a brand new item.
+	 * @return Null if the item's chunk isn't shown, in which case nothing is placed.
 	 */
 	AItem * PlaceItem(const items::ItemDataPtr & data);
+	/**
+	 * Digs, fills or paints the terrain within a brush. Every loaded chunk whose mesh depends
+	 * on the changed samples is remeshed, rebuilding only the slabs of cells that changed.
+	 */
+	void EditTerrain(const terrain::TerrainEdit & edit);
+
+	inline terrain::ChunkPrefetchCounters GetPrefetchCounters() const {
+		return Prefetcher ? Prefetcher->GetCounters() : terrain::ChunkPrefetchCounters();
+	}
 };
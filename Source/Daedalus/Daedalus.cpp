@@ -1,5 +1,21 @@
 #include "Daedalus.h"
 
+#include <Utilities/JobSystem.h>
+
 #include "Daedalus.generated.inl"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Daedalus, "Daedalus" );
+/**
+ * Owns the state shared by the whole game for as long as the module is loaded.
+ */
+class FDaedalusModule : public FDefaultGameModuleImpl {
+public:
+	virtual void StartupModule() override {
+		utils::StartJobSystem();
+	}
+
+	virtual void ShutdownModule() override {
+		utils::StopJobSystem();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FDaedalusModule, Daedalus, "Daedalus" );
@@ -4,6 +4,7 @@
 #include <Utilities/Algebra/Algebra3D.h>
 
 #include <memory>
+#include <vector>
 
 namespace items {
 	enum ItemType {
@@ -24,6 +25,10 @@ namespace items {
 			Yaw += rotation.Yaw;
 			Pitch += rotation.Pitch;
 		}
+
+		bool operator == (const ItemRotation & other) const {
+			return Yaw == other.Yaw && Pitch == other.Pitch;
+		}
 	};
 
 	/**
@@ -32,6 +37,11 @@ namespace items {
 	 * designing the modding system.
 	 */
 	struct ItemDataTemplate {
+	private:
+		// Rotation about the pivot for every discrete orientation, see GetRotationIndex
+		std::vector<utils::Matrix4D<>> RotationTable;
+
+	public:
 		ItemType Type;
 		utils::Vector3D<> Size;  // Size in grid cells
 		utils::Point3D Pivot;    // Position of pivot in grid cells
@@ -49,7 +59,28 @@ namespace items {
 			Pivot(pivot),
 			Size(size),
 			MeshName(meshName)
-		{}
+		{
+			for (Uint8 yaw = 0; yaw < RotationInterval.Yaw; yaw++) {
+				for (Uint8 pitch = 0; pitch < RotationInterval.Pitch; pitch++) {
+					const double yawV = 360 * (double) yaw / RotationInterval.Yaw;
+					const double pitchV = 360 * (double) pitch / RotationInterval.Pitch;
+					RotationTable.push_back(
+						utils::CreateTranslation(Pivot) *
+						utils::CreateRotation(yawV, utils::AXIS_Z) *
+						utils::CreateRotation(pitchV, utils::AXIS_X) *
+						utils::CreateTranslation(-Pivot));
+				}
+			}
+		}
+
+		inline Uint16 GetRotationIndex(const ItemRotation & rotation) const {
+			return (rotation.Yaw % RotationInterval.Yaw) * RotationInterval.Pitch +
+				rotation.Pitch % RotationInterval.Pitch;
+		}
+
+		inline const utils::Matrix4D<> & GetRotationMatrix(const ItemRotation & rotation) const {
+			return RotationTable[GetRotationIndex(rotation)];
+		}
 	};
 
 	struct ItemDataId {
@@ -74,6 +105,12 @@ namespace items {
 		ItemRotation Rotation;
 		utils::AxisAlignedBoundingBox3D OriginBounds;
 
+		// The bounding box is cached along with the position and rotation it was built from
+		mutable utils::OrientedBoundingBox3D CachedBounds;
+		mutable utils::Point3D CachedPosition;
+		mutable ItemRotation CachedRotation;
+		mutable bool bIsBoundsCached;
+
 	public:
 		Uint64 ItemId;
 		terrain::ChunkPositionVector Position;
@@ -94,7 +131,10 @@ namespace items {
 			bIsPlaced(isPlaced),
 			Size(tmp.Size),
 			Template(tmp),
-			OriginBounds(utils::Point3D(0), tmp.Size)
+			OriginBounds(utils::Point3D(0), tmp.Size),
+			CachedPosition(0),
+			CachedRotation(rotation),
+			bIsBoundsCached(false)
 		{}
 
 		ItemData(const ItemDataTemplate & tmp) :
@@ -113,23 +153,25 @@ namespace items {
 			this->Rotation.Bound(Template.RotationInterval);
 		}
 		
-		utils::Matrix4D<> GetRotationMatrix() const {
-			const double yawV = 360 * (double) Rotation.Yaw / Template.RotationInterval.Yaw;
-			const double pitchV = 360 * (double) Rotation.Pitch / Template.RotationInterval.Pitch;
-
-			return
-				utils::CreateTranslation(Template.Pivot) *
-				utils::CreateRotation(yawV, utils::AXIS_Z) *
-				utils::CreateRotation(pitchV, utils::AXIS_X) *
-				utils::CreateTranslation(-Template.Pivot);
+		const utils::Matrix4D<> & GetRotationMatrix() const {
+			return Template.GetRotationMatrix(Rotation);
 		}
 
 		utils::Matrix4D<> GetPositionMatrix() const {
 			return utils::CreateTranslation(Position.InnerOffset) * GetRotationMatrix();
 		}
 
-		utils::OrientedBoundingBox3D GetBoundingBox() const {
-			return utils::OrientedBoundingBox3D(utils::Point3D(0, 0, 0), Size, GetPositionMatrix());
+		const utils::OrientedBoundingBox3D & GetBoundingBox() const {
+			if (!bIsBoundsCached ||
+					!(CachedPosition == Position.InnerOffset) ||
+					!(CachedRotation == Rotation)) {
+				CachedBounds = utils::OrientedBoundingBox3D(
+					utils::Point3D(0, 0, 0), Size, GetPositionMatrix());
+				CachedPosition = Position.InnerOffset;
+				CachedRotation = Rotation;
+				bIsBoundsCached = true;
+			}
+			return CachedBounds;
 		}
 	};
 
@@ -18,7 +18,7 @@ namespace items {
 		ItemTemplates.insert(std::make_pair(
 			I_Sofa,
 			ItemDataTemplateUPtr(new ItemDataTemplate(
-				I_Chest, ItemRotation(4, 1),
+				I_Sofa, ItemRotation(4, 1),
 				Vector3D<>(2.0, 1.0, 1.0), Point3D(0.5, 0.5, 0.5), "Sofa.Sofa"))));
 	}
 
@@ -0,0 +1,125 @@
+#include <Daedalus.h>
+#include "ItemSpatialIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace items {
+	using namespace utils;
+
+	ItemSpatialIndex::ItemSpatialIndex(const Uint32 chunkSize) :
+		ChunkSize(chunkSize),
+		BucketCount((chunkSize + BUCKET_SIZE - 1) / BUCKET_SIZE),
+		Buckets(BucketCount * BucketCount * BucketCount),
+		BucketBounds(Buckets.size())
+	{}
+
+	Uint32 ItemSpatialIndex::ToBucket(const double value) const {
+		const double bucket = std::floor(value / BUCKET_SIZE);
+		if (bucket < 0)
+			return 0;
+		return std::min((Uint32) bucket, BucketCount - 1);
+	}
+
+	bool ItemSpatialIndex::Insert(const ItemDataPtr & item, const Point3D & offset) {
+		Remove(item);
+
+		auto bounds = item->GetBoundingBox();
+		auto enclosing = bounds.GetEnclosingBoundingBox();
+		enclosing.MinPoint += offset;
+		enclosing.MaxPoint += offset;
+
+		// Only keep items that touch this chunk
+		for (Uint8 i = 0; i < 3; i++) {
+			if (enclosing.MaxPoint[i] < 0 || enclosing.MinPoint[i] > ChunkSize)
+				return false;
+		}
+
+		Uint32 index;
+		if (FreeEntries.empty()) {
+			index = (Uint32) Entries.size();
+			Entries.push_back(Entry());
+		} else {
+			index = FreeEntries.back();
+			FreeEntries.pop_back();
+		}
+
+		auto & entry = Entries[index];
+		entry.Item = item;
+		entry.Offset = offset;
+		entry.Bounds = bounds;
+		entry.Enclosing = enclosing;
+		entry.MinBucket.Reset(
+			ToBucket(enclosing.MinPoint.X), ToBucket(enclosing.MinPoint.Y), ToBucket(enclosing.MinPoint.Z));
+		entry.MaxBucket.Reset(
+			ToBucket(enclosing.MaxPoint.X), ToBucket(enclosing.MaxPoint.Y), ToBucket(enclosing.MaxPoint.Z));
+
+		for (Uint32 x = entry.MinBucket.X; x <= entry.MaxBucket.X; x++) {
+			for (Uint32 y = entry.MinBucket.Y; y <= entry.MaxBucket.Y; y++) {
+				for (Uint32 z = entry.MinBucket.Z; z <= entry.MaxBucket.Z; z++) {
+					const auto bucketIndex = BucketIndex(x, y, z);
+					Buckets[bucketIndex].push_back(index);
+					BucketBounds[bucketIndex].Add(bounds, offset);
+				}
+			}
+		}
+
+		EntryLookup.insert({ item.get(), index });
+		return true;
+	}
+
+	bool ItemSpatialIndex::Remove(const ItemDataPtr & item) {
+		const auto found = EntryLookup.find(item.get());
+		if (found == EntryLookup.end())
+			return false;
+
+		const Uint32 index = found->second;
+		auto & entry = Entries[index];
+		for (Uint32 x = entry.MinBucket.X; x <= entry.MaxBucket.X; x++) {
+			for (Uint32 y = entry.MinBucket.Y; y <= entry.MaxBucket.Y; y++) {
+				for (Uint32 z = entry.MinBucket.Z; z <= entry.MaxBucket.Z; z++) {
+					const auto bucketIndex = BucketIndex(x, y, z);
+					auto & bucket = Buckets[bucketIndex];
+					auto it = std::find(bucket.begin(), bucket.end(), index);
+					BucketBounds[bucketIndex].RemoveSwap(it - bucket.begin());
+					*it = bucket.back();
+					bucket.pop_back();
+				}
+			}
+		}
+
+		entry.Item = NULL;
+		FreeEntries.push_back(index);
+		EntryLookup.erase(found);
+		return true;
+	}
+
+	Option<ItemDataPtr> ItemSpatialIndex::FindCollision(
+		const AxisAlignedBoundingBox3D & bound
+	) const {
+		if (IsEmpty())
+			return None<ItemDataPtr>();
+
+		const Vector3D<Uint32> minBucket(
+			ToBucket(bound.MinPoint.X), ToBucket(bound.MinPoint.Y), ToBucket(bound.MinPoint.Z));
+		const Vector3D<Uint32> maxBucket(
+			ToBucket(bound.MaxPoint.X), ToBucket(bound.MaxPoint.Y), ToBucket(bound.MaxPoint.Z));
+
+		for (Uint32 x = minBucket.X; x <= maxBucket.X; x++) {
+			for (Uint32 y = minBucket.Y; y <= maxBucket.Y; y++) {
+				for (Uint32 z = minBucket.Z; z <= maxBucket.Z; z++) {
+					const auto bucketIndex = BucketIndex(x, y, z);
+					const auto found = BucketBounds[bucketIndex].FindFirstIntersection(bound, false);
+					if (found.IsValid())
+						return Some(Entries[Buckets[bucketIndex][*found]].Item);
+				}
+			}
+		}
+
+		return None<ItemDataPtr>();
+	}
+
+	bool ItemSpatialIndex::IsBucketEmptyAt(const Uint32 x, const Uint32 y, const Uint32 z) const {
+		return Buckets[BucketIndex(x / BUCKET_SIZE, y / BUCKET_SIZE, z / BUCKET_SIZE)].empty();
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Models/Items/ItemData.h>
+#include <Utilities/DataStructures.h>
+#include <Utilities/Algebra/Algebra3D.h>
+#include <Utilities/Algebra/BoundingBoxBatch3D.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace items {
+	/**
+	 * Uniform grid of the items touching a single chunk. The chunk is divided into buckets of
+	 * 4x4x4 grid cells, matching the bricks of the terrain occupancy grid. Items that span
+	 * chunk borders are expected to be registered in every chunk they touch, so a query that
+	 * stays within the chunk never has to look at the neighbours. All coordinates are in the
+	 * grid space of the chunk that owns the index.
+	 */
+	class ItemSpatialIndex {
+	public:
+		static const Uint32 BUCKET_SIZE = 4;
+
+		struct Entry {
+			ItemDataPtr Item;
+			// Offset of the item's own chunk from this chunk, in grid cells
+			utils::Point3D Offset;
+			// Exact bounds of the item in its own chunk's space
+			utils::OrientedBoundingBox3D Bounds;
+			// Enclosing bounds of the item in this chunk's space
+			utils::AxisAlignedBoundingBox3D Enclosing;
+			utils::Vector3D<Uint32> MinBucket;
+			utils::Vector3D<Uint32> MaxBucket;
+		};
+
+	private:
+		Uint32 ChunkSize;
+		Uint32 BucketCount;                                 // Number of buckets along an edge
+		std::vector<Entry> Entries;
+		std::vector<Uint32> FreeEntries;
+		std::vector<std::vector<Uint32>> Buckets;           // Indices into Entries
+		// Bounds of the entries in each bucket in this chunk's space, in the same order
+		std::vector<utils::OrientedBoundingBoxBatch3D> BucketBounds;
+		std::unordered_map<const ItemData *, Uint32> EntryLookup;
+
+		inline Uint64 BucketIndex(const Uint32 bx, const Uint32 by, const Uint32 bz) const {
+			return (bx * BucketCount + by) * BucketCount + bz;
+		}
+
+		Uint32 ToBucket(const double value) const;
+
+	public:
+		ItemSpatialIndex(const Uint32 chunkSize);
+
+		/**
+		 * Adds the item to the index, or refreshes its cached bounds if it is already indexed.
+		 * @param offset Offset of the item's chunk from this chunk, in grid cells.
+		 * @return False if the item doesn't touch this chunk, in which case it isn't indexed.
+		 */
+		bool Insert(const ItemDataPtr & item, const utils::Point3D & offset);
+
+		/**
+		 * @return True if the item was found and removed.
+		 */
+		bool Remove(const ItemDataPtr & item);
+
+		/**
+		 * Finds the first item whose bounds intersect the given bounding box.
+		 */
+		utils::Option<ItemDataPtr> FindCollision(const utils::AxisAlignedBoundingBox3D & bound) const;
+
+		/**
+		 * Checks if there are any items touching the bucket that contains the given cell.
+		 */
+		bool IsBucketEmptyAt(const Uint32 x, const Uint32 y, const Uint32 z) const;
+
+		inline bool IsEmpty() const { return EntryLookup.empty(); }
+		inline Uint64 Size() const { return EntryLookup.size(); }
+	};
+}
@@ -0,0 +1,34 @@
+#include <Daedalus.h>
+#include "ChunkApron.h"
+
+#include <Models/Terrain/ChunkKernels.h>
+
+namespace terrain {
+	bool ChunkApron::IsCurrent(const ChunkDataSet & chunks) const {
+		for (Uint32 x = 0; x < 3; x++) {
+			for (Uint32 y = 0; y < 3; y++) {
+				for (Uint32 z = 0; z < 3; z++) {
+					const auto & chunk = chunks.Get(x, y, z);
+					const Uint64 version = Versions[(x * 3 + y) * 3 + z];
+					if (chunk != Chunks.Get(x, y, z) || chunk->Version != version)
+						return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	ChunkApronPtr UpdateChunkApron(
+		const ChunkApronPtr & apron,
+		const ChunkDataSet & chunks,
+		const ChunkKernels & kernels,
+		const Uint32 cellCount
+	) {
+		if (apron && apron->CellCount == cellCount && apron->IsCurrent(chunks))
+			return apron;
+
+		std::shared_ptr<ChunkApron> updated(new ChunkApron());
+		kernels.FillApron(chunks, *updated, cellCount);
+		return updated;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Models/Terrain/ChunkData.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace terrain {
+	struct ChunkKernels;
+
+	/**
+	 * The samples of a chunk together with the border planes copied in from its neighbours,
+	 * laid out linearly so that meshing and solidity queries never have to find the chunk a
+	 * sample belongs to. The apron is immutable once built, so it can be shared with mesh
+	 * requests on other threads. It is rebuilt when the data of the chunk or of one of its
+	 * neighbours changes, which IsCurrent detects through the chunk versions.
+	 */
+	struct ChunkApron {
+		ChunkDataSet Chunks;                 // The neighbourhood the apron was copied from
+		std::array<Uint64, 27> Versions;     // Version of each chunk when it was copied
+		Uint32 CellCount;
+
+		/*
+		 Density samples with one extra sample before and two after the chunk along each
+		 axis, (n + 3)^3 in total. Sample (x, y, z) of the chunk is at (x + 1, y + 1, z + 1).
+		 The extra sample on each side allows central differences at every sample of the
+		 chunk, including the far face shared with the next chunk.
+		 */
+		std::vector<float> Density;
+		// Material at each of the (n + 1)^3 samples of the chunk and its far faces
+		std::vector<Uint32> Materials;
+
+		inline Uint32 GetPaddedSize() const { return CellCount + 3; }
+
+		/**
+		 * @return True if the apron was built from exactly these chunks, at their current
+		 *         versions.
+		 */
+		bool IsCurrent(const ChunkDataSet & chunks) const;
+	};
+
+	using ChunkApronPtr = std::shared_ptr<const ChunkApron>;
+
+	/**
+	 * Builds a new apron for the chunks if the given one is missing or out of date, otherwise
+	 * returns the given one.
+	 */
+	ChunkApronPtr UpdateChunkApron(
+		const ChunkApronPtr & apron,
+		const ChunkDataSet & chunks,
+		const ChunkKernels & kernels,
+		const Uint32 cellCount);
+}
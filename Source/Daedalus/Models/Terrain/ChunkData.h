@@ -3,10 +3,13 @@
 #pragma once
 
 #include <Models/Items/ItemData.h>
+#include <Models/Items/ItemSpatialIndex.h>
 #include <Models/Terrain/TerrainDataStructures.h>
+#include <Utilities/DataStructures.h>
 #include <Utilities/Algebra/Algebra3D.h>
 
 #include <memory>
+#include <vector>
 
 namespace terrain {
 	/**
@@ -15,6 +18,10 @@ namespace terrain {
 	 * are set up as follows: X -> width, Y -> depth, Z -> height.
 	 */
 	struct ChunkData {
+		// The density data is bricked, since it is mostly read a cell neighbourhood at a time
+		using DensityField = utils::Tensor3D<float, utils::BrickedLayout>;
+		using MaterialField = utils::Tensor3D<Uint64>;
+
 		/*
 		 The chunk grid measurement counts cubic volumes in the cubic chunk. The density data
 		 and material data on the other hand, are denoted at each vertex in the cubic chunk. To
@@ -26,29 +33,58 @@ namespace terrain {
 		 approach because it seems conceptually simpler, at the potential cost of performance.
 
 		 The density and material data field is the dual of the ingame grid.
+
+		 The data is only changed on the game thread, by terrain edits, which increment the
+		 version. Work off the game thread reads copies of it, such as the chunk aprons, or
+		 versions shared through the copy on write fields, such as world snapshots.
 		 */
-		utils::Tensor3D<float> DensityData;
-		utils::Tensor3D<Uint64> MaterialData;
+		utils::CopyOnWrite<DensityField> DensityData;
+		utils::CopyOnWrite<MaterialField> MaterialData;
 
-		// TODO: might need to change this to octree depending on performance
 		std::vector<items::ItemDataPtr> PlacedItems;
+		// Every item touching this chunk, including the ones placed in neighbouring chunks
+		items::ItemSpatialIndex ItemIndex;
 
 		Uint32 ChunkGridSize;           // Size of the chunk in grid cells
 		Uint32 ChunkFieldSize;          // Size of the chunk scalar field
 		ChunkOffsetVector ChunkOffset;
+		// Incremented whenever the density or material data changes, so that copies of the
+		// data, such as the aprons of neighbouring chunks, can tell that they are stale
+		Uint64 Version;
 
 		ChunkData(
 			const Uint32 chunkSize,
 			const ChunkOffsetVector & chunkOffset
 		) : ChunkGridSize(chunkSize),
 			ChunkFieldSize(chunkSize),
-			DensityData(chunkSize, chunkSize, chunkSize, 0),
-			MaterialData(chunkSize, chunkSize, chunkSize, 0),
-			ChunkOffset(chunkOffset)
+			DensityData(std::make_shared<DensityField>(chunkSize, chunkSize, chunkSize, 0)),
+			MaterialData(std::make_shared<MaterialField>(chunkSize, chunkSize, chunkSize, 0)),
+			ItemIndex(chunkSize),
+			ChunkOffset(chunkOffset),
+			Version(0)
+		{}
+
+		/**
+		 * Creates a chunk sharing the given fields, which are only copied once it is edited.
+		 */
+		ChunkData(
+			const Uint32 chunkSize,
+			const ChunkOffsetVector & chunkOffset,
+			const std::shared_ptr<DensityField> & density,
+			const std::shared_ptr<MaterialField> & materials
+		) : ChunkGridSize(chunkSize),
+			ChunkFieldSize(chunkSize),
+			DensityData(density),
+			MaterialData(materials),
+			ItemIndex(chunkSize),
+			ChunkOffset(chunkOffset),
+			Version(0)
 		{}
 		
 		~ChunkData() {}
 	};
 
 	using ChunkDataPtr = std::shared_ptr<ChunkData>;
+	// A chunk and its neighbours, the chunk itself is at (1, 1, 1)
+	using ChunkDataSet = utils::TensorFixed3D<ChunkDataPtr, 3>;
 }
@@ -0,0 +1,204 @@
+#include <Daedalus.h>
+#include "ChunkDelta.h"
+
+#include <cstring>
+
+namespace terrain {
+	using namespace utils;
+
+	namespace {
+		const Uint32 DeltaMagic = 0x44434444;     // "DDCD"
+		const Uint32 DeltaFormatVersion = 1;
+
+		template <typename T>
+		void WriteUnsigned(std::ostream & output, const T value) {
+			char bytes[sizeof(T)];
+			for (Uint32 i = 0; i < sizeof(T); i++)
+				bytes[i] = (char) ((value >> (8 * i)) & 0xff);
+			output.write(bytes, sizeof(T));
+		}
+
+		template <typename T>
+		T ReadUnsigned(std::istream & input) {
+			unsigned char bytes[sizeof(T)];
+			input.read((char *) bytes, sizeof(T));
+			if (!input)
+				throw StringException("ReadChunkDeltas: Unexpected end of input");
+			T value = 0;
+			for (Uint32 i = 0; i < sizeof(T); i++)
+				value |= (T) bytes[i] << (8 * i);
+			return value;
+		}
+
+		void WriteDouble(std::ostream & output, const double value) {
+			Uint64 bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			WriteUnsigned(output, bits);
+		}
+
+		double ReadDouble(std::istream & input) {
+			const Uint64 bits = ReadUnsigned<Uint64>(input);
+			double value;
+			std::memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		void WriteFloat(std::ostream & output, const float value) {
+			Uint32 bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			WriteUnsigned(output, bits);
+		}
+
+		float ReadFloat(std::istream & input) {
+			const Uint32 bits = ReadUnsigned<Uint32>(input);
+			float value;
+			std::memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+	}
+
+	ChunkDelta CreateChunkDelta(const ChunkData & base, const ChunkData & chunk) {
+		ChunkDelta delta(chunk.ChunkOffset);
+		DiffChunkSamples(
+			*base.DensityData, *base.MaterialData, *chunk.DensityData, *chunk.MaterialData, delta);
+		RecordPlacedItems(chunk.PlacedItems, delta.Items);
+		return delta;
+	}
+
+	void DiffChunkSamples(
+		const ChunkData::DensityField & baseDensity,
+		const ChunkData::MaterialField & baseMaterials,
+		const ChunkData::DensityField & density,
+		const ChunkData::MaterialField & materials,
+		ChunkDelta & delta
+	) {
+		// Fields that are still shared with the base are unchanged
+		if (&baseDensity == &density && &baseMaterials == &materials)
+			return;
+
+		const Uint32 n = density.GetWidth();
+		for (Uint32 x = 0; x < n; x++) {
+			for (Uint32 y = 0; y < n; y++) {
+				for (Uint32 z = 0; z < n; z++) {
+					const float value = density.Get(x, y, z);
+					const Uint64 material = materials.Get(x, y, z);
+					if (value == baseDensity.Get(x, y, z) && material == baseMaterials.Get(x, y, z))
+						continue;
+					const ChunkDelta::Sample sample = { (x * n + y) * n + z, value, material };
+					delta.Samples.push_back(sample);
+				}
+			}
+		}
+	}
+
+	void RecordPlacedItems(
+		const std::vector<items::ItemDataPtr> & placed,
+		std::vector<ChunkDelta::PlacedItem> & items
+	) {
+		// The generator doesn't place any items, so every item is a player's
+		for (const auto & item : placed) {
+			const auto & rotation = item->GetRotation();
+			const ChunkDelta::PlacedItem placed = {
+				item->ItemId, item->Template.Type, item->Position.InnerOffset,
+				rotation.Yaw, rotation.Pitch
+			};
+			items.push_back(placed);
+		}
+	}
+
+	void ApplyChunkDelta(
+		const ChunkDelta & delta,
+		const items::ItemDataFactory & factory,
+		ChunkData & data
+	) {
+		const Uint32 n = data.ChunkFieldSize;
+		for (const auto & sample : delta.Samples) {
+			if (sample.Index >= n * n * n)
+				throw StringException("ApplyChunkDelta: Sample lies outside of the chunk");
+			const Uint32 z = sample.Index % n;
+			const Uint32 y = sample.Index / n % n;
+			const Uint32 x = sample.Index / (n * n);
+			data.DensityData.Mutable().Set(x, y, z, sample.Density);
+			data.MaterialData.Mutable().Set(x, y, z, sample.Material);
+		}
+
+		for (const auto & placed : delta.Items) {
+			const auto item = factory.BuildItemData(placed.Type);
+			if (!item)
+				continue;
+			item->ItemId = placed.ItemId;
+			item->Position = ChunkPositionVector(data.ChunkOffset, placed.Position);
+			item->SetRotation(items::ItemRotation(placed.Yaw, placed.Pitch));
+			item->bIsPlaced = true;
+			data.PlacedItems.push_back(item);
+		}
+	}
+
+	void WriteChunkDeltas(std::ostream & output, const ChunkDeltaMap & deltas) {
+		WriteUnsigned(output, DeltaMagic);
+		WriteUnsigned(output, DeltaFormatVersion);
+		WriteUnsigned(output, (Uint32) deltas.size());
+
+		for (const auto & entry : deltas) {
+			const auto & delta = *entry.second;
+			for (Uint8 i = 0; i < 3; i++)
+				WriteUnsigned(output, (Uint64) delta.ChunkOffset[i]);
+
+			WriteUnsigned(output, (Uint32) delta.Samples.size());
+			for (const auto & sample : delta.Samples) {
+				WriteUnsigned(output, sample.Index);
+				WriteFloat(output, sample.Density);
+				WriteUnsigned(output, sample.Material);
+			}
+
+			WriteUnsigned(output, (Uint32) delta.Items.size());
+			for (const auto & item : delta.Items) {
+				WriteUnsigned(output, item.ItemId);
+				WriteUnsigned(output, (Uint32) item.Type);
+				for (Uint8 i = 0; i < 3; i++)
+					WriteDouble(output, item.Position[i]);
+				WriteUnsigned(output, item.Yaw);
+				WriteUnsigned(output, item.Pitch);
+			}
+		}
+	}
+
+	void ReadChunkDeltas(std::istream & input, ChunkDeltaMap & deltas) {
+		if (ReadUnsigned<Uint32>(input) != DeltaMagic)
+			throw StringException("ReadChunkDeltas: Input is not a set of chunk deltas");
+		if (ReadUnsigned<Uint32>(input) != DeltaFormatVersion)
+			throw StringException("ReadChunkDeltas: Unsupported chunk delta format version");
+
+		const Uint32 count = ReadUnsigned<Uint32>(input);
+		for (Uint32 c = 0; c < count; c++) {
+			std::shared_ptr<ChunkDelta> read(new ChunkDelta());
+			auto & delta = *read;
+			for (Uint8 i = 0; i < 3; i++)
+				delta.ChunkOffset[i] = (Int64) ReadUnsigned<Uint64>(input);
+
+			// Counts are not trusted for reservations, a corrupt count fails on the reads
+			const Uint32 sampleCount = ReadUnsigned<Uint32>(input);
+			for (Uint32 s = 0; s < sampleCount; s++) {
+				ChunkDelta::Sample sample;
+				sample.Index = ReadUnsigned<Uint32>(input);
+				sample.Density = ReadFloat(input);
+				sample.Material = ReadUnsigned<Uint64>(input);
+				delta.Samples.push_back(sample);
+			}
+
+			const Uint32 itemCount = ReadUnsigned<Uint32>(input);
+			for (Uint32 t = 0; t < itemCount; t++) {
+				ChunkDelta::PlacedItem item;
+				item.ItemId = ReadUnsigned<Uint64>(input);
+				item.Type = (items::ItemType) ReadUnsigned<Uint32>(input);
+				for (Uint8 i = 0; i < 3; i++)
+					item.Position[i] = ReadDouble(input);
+				item.Yaw = ReadUnsigned<Uint8>(input);
+				item.Pitch = ReadUnsigned<Uint8>(input);
+				delta.Items.push_back(item);
+			}
+
+			deltas[delta.ChunkOffset] = read;
+		}
+	}
+}
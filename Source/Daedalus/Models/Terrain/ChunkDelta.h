@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Models/Items/ItemDataFactory.h>
+#include <Models/Terrain/ChunkData.h>
+#include <Models/Terrain/TerrainDataStructures.h>
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+namespace terrain {
+	/**
+	 * The difference between a chunk and the chunk the terrain generator builds at the same
+	 * offset. Since the generator is deterministic for a given seed, only the samples that
+	 * players changed and the items they placed have to be kept to restore the chunk.
+	 */
+	struct ChunkDelta {
+		struct Sample {
+			Uint32 Index;           // Sample (x, y, z) is at (x * n + y) * n + z
+			float Density;
+			Uint64 Material;
+		};
+
+		struct PlacedItem {
+			Uint64 ItemId;
+			items::ItemType Type;
+			utils::Point3D Position;    // Inner offset within the chunk
+			Uint8 Yaw, Pitch;
+		};
+
+		ChunkOffsetVector ChunkOffset;
+		std::vector<Sample> Samples;            // Sorted by index
+		std::vector<PlacedItem> Items;
+
+		ChunkDelta() : ChunkOffset(0) {}
+		ChunkDelta(const ChunkOffsetVector & offset) : ChunkOffset(offset) {}
+
+		inline bool IsEmpty() const { return Samples.empty() && Items.empty(); }
+	};
+
+	// Deltas are immutable once built, so that snapshots can share them
+	using ChunkDeltaPtr = std::shared_ptr<const ChunkDelta>;
+	using ChunkDeltaMap = std::unordered_map<ChunkOffsetVector, ChunkDeltaPtr>;
+
+	/**
+	 * @param base The chunk as built by the generator.
+	 * @param chunk The same chunk with the edits of players applied.
+	 */
+	ChunkDelta CreateChunkDelta(const ChunkData & base, const ChunkData & chunk);
+
+	/**
+	 * Adds every sample whose density or material differs from the base to the delta.
+	 */
+	void DiffChunkSamples(
+		const ChunkData::DensityField & baseDensity,
+		const ChunkData::MaterialField & baseMaterials,
+		const ChunkData::DensityField & density,
+		const ChunkData::MaterialField & materials,
+		ChunkDelta & delta);
+
+	void RecordPlacedItems(
+		const std::vector<items::ItemDataPtr> & placed,
+		std::vector<ChunkDelta::PlacedItem> & items);
+
+	/**
+	 * Applies the delta on top of the chunk freshly built by the generator.
+	 * @param factory Rebuilds the placed items, items of unknown types are dropped.
+	 */
+	void ApplyChunkDelta(
+		const ChunkDelta & delta,
+		const items::ItemDataFactory & factory,
+		ChunkData & data);
+
+	/**
+	 * Writes the deltas in a compact little endian binary format.
+	 */
+	void WriteChunkDeltas(std::ostream & output, const ChunkDeltaMap & deltas);
+
+	/**
+	 * Reads deltas written by WriteChunkDeltas, adding them to the map. Throws a
+	 * StringException if the input is truncated or isn't a set of chunk deltas.
+	 */
+	void ReadChunkDeltas(std::istream & input, ChunkDeltaMap & deltas);
+}
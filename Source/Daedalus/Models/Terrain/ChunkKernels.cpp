@@ -0,0 +1,282 @@
+#include <Daedalus.h>
+#include "ChunkKernels.h"
+
+#include <Utilities/Mesh/MarchingCubes.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+
+namespace terrain {
+	using namespace utils;
+
+	namespace {
+		inline float DensityAt(
+			const ChunkData & data,
+			const Uint32 x, const Uint32 y, const Uint32 z,
+			const Uint32 n
+		) {
+			using Layout = ChunkData::DensityField::LayoutType;
+			return data.DensityData->GetData()[Layout::Index(x, y, z, n, n, n)];
+		}
+
+		/*
+		 Outward surface normals at every sample of a chunk, (n + 1)^3 of them, stored per
+		 axis so that they can be computed a row of samples at a time.
+		 */
+		struct NormalField {
+			std::vector<float> X, Y, Z;
+		};
+
+		/*
+		 Index into the padded density of an apron, which is laid out with z contiguous.
+		 */
+		inline Uint32 ApronIndex(const Uint32 x, const Uint32 y, const Uint32 z, const Uint32 m) {
+			return (x * m + y) * m + z;
+		}
+
+		void FillDensity(ChunkData & data, const double localHeight, const Uint32 cellCount) {
+			using Layout = ChunkData::DensityField::LayoutType;
+			const Uint32 n = cellCount;
+			const Uint32 top = localHeight <= 0 ? 0 : (Uint32) std::min((double) n, std::ceil(localHeight));
+			float * density = data.DensityData.Mutable().GetData();
+
+			for (Uint32 x = 0; x < n; x++) {
+				for (Uint32 y = 0; y < n; y++) {
+					for (Uint32 z = 0; z < top; z++)
+						density[Layout::Index(x, y, z, n, n, n)] = 1;
+				}
+			}
+		}
+
+		void FillApron(const ChunkDataSet & chunks, ChunkApron & apron, const Uint32 cellCount) {
+			const Uint32 n = cellCount;
+			const Uint32 m = n + 3;
+			const Uint32 s = n + 1;
+
+			apron.Chunks = chunks;
+			for (Uint32 i = 0; i < 27; i++)
+				apron.Versions[i] = chunks.Get(i / 9, i / 3 % 3, i % 3)->Version;
+			apron.CellCount = n;
+			apron.Density.resize(m * m * m);
+			apron.Materials.resize(s * s * s);
+
+			// The chunk and local sample along an axis for each padded sample, so that the
+			// copy doesn't divide per sample
+			std::vector<Uint8> chunkOf(m);
+			std::vector<Uint32> localOf(m);
+			for (Uint32 i = 0; i < m; i++) {
+				const Uint32 shifted = i + n - 1;   // Relative to the first chunk of the set
+				chunkOf[i] = (Uint8) (shifted < n ? 0 : shifted < 2 * n ? 1 : 2);
+				localOf[i] = shifted - chunkOf[i] * n;
+			}
+
+			float * density = apron.Density.data();
+			for (Uint32 x = 0; x < m; x++) {
+				for (Uint32 y = 0; y < m; y++) {
+					float * row = density + ApronIndex(x, y, 0, m);
+					const ChunkData * data[3];
+					for (Uint8 c = 0; c < 3; c++)
+						data[c] = chunks.Get(chunkOf[x], chunkOf[y], c).get();
+					for (Uint32 z = 0; z < m; z++)
+						row[z] = DensityAt(*data[chunkOf[z]], localOf[x], localOf[y], localOf[z], n);
+				}
+			}
+
+			// Material sample i is padded sample i + 1
+			Uint32 * materials = apron.Materials.data();
+			for (Uint32 x = 0; x < s; x++) {
+				for (Uint32 y = 0; y < s; y++) {
+					for (Uint32 z = 0; z < s; z++) {
+						const ChunkData & data =
+							*chunks.Get(chunkOf[x + 1], chunkOf[y + 1], chunkOf[z + 1]);
+						materials[(x * s + y) * s + z] = (Uint32) data.MaterialData->Get(
+							localOf[x + 1], localOf[y + 1], localOf[z + 1]);
+					}
+				}
+			}
+		}
+
+		/*
+		 The density increases into the terrain, so the outward normal is the negated
+		 gradient, taken here by central differences. The normals are left unnormalized
+		 until they have been interpolated onto the vertices.
+		 */
+		void FillNormals(
+			const ChunkApron & apron,
+			NormalField & normals,
+			const Uint32 fromX,
+			const Uint32 toX,
+			const Uint32 n
+		) {
+			const Uint32 m = n + 3;           // Samples along a padded edge
+			const Uint32 s = n + 1;           // Samples along a chunk edge
+			const Uint32 dx = m * m;
+			const Uint32 dy = m;
+			const Uint32 count = (toX - fromX + 1) * s * s;
+			const float * density = apron.Density.data();
+
+			normals.X.resize(count);
+			normals.Y.resize(count);
+			normals.Z.resize(count);
+			float * nx = normals.X.data();
+			float * ny = normals.Y.data();
+			float * nz = normals.Z.data();
+
+			for (Uint32 x = fromX; x <= toX; x++) {
+				for (Uint32 y = 0; y < s; y++) {
+					// Rows along z are contiguous in both fields, so this loop vectorizes
+					const float * row = density + ((x + 1) * m + y + 1) * m + 1;
+					const float * left = row - dx, * right = row + dx;
+					const float * front = row - dy, * back = row + dy;
+					const float * below = row - 1, * above = row + 1;
+					const Uint32 out = ((x - fromX) * s + y) * s;
+					for (Uint32 z = 0; z < s; z++) {
+						nx[out + z] = left[z] - right[z];
+						ny[out + z] = front[z] - back[z];
+						nz[out + z] = below[z] - above[z];
+					}
+				}
+			}
+		}
+
+		void GenerateMesh(
+			const ChunkApron & apron,
+			const float scale,
+			const Uint32 lod,
+			const Uint32 fromX,
+			const Uint32 toX,
+			std::vector<Triangle3D<float>> & triangles,
+			ChunkMeshAttributes * attributes,
+			const Uint32 cellCount
+		) {
+			const Uint32 n = cellCount;
+			const Uint32 m = n + 3;
+			const Uint32 s = n + 1;
+			const Uint32 step = 1u << lod;
+			const float * density = apron.Density.data();
+			if (fromX >= toX)
+				return;
+
+			// Normals are only needed at the samples of the meshed cells
+			NormalField normalField;
+			if (attributes)
+				FillNormals(apron, normalField, fromX, toX, n);
+
+			GridCell gridCell;
+			std::vector<Triangle3D<float>> cellTriangles;
+			Vector3D<float> displacement;
+			std::array<float, 8> corners;
+
+			for (Uint32 x = fromX; x < toX; x += step) {
+				for (Uint32 y = 0; y < n; y += step) {
+					for (Uint32 z = 0; z < n; z += step) {
+						for (Uint8 i = 0; i < 8; i++) {
+							corners[i] = density[ApronIndex(
+								x + 1 + (i >> 2) * step,
+								y + 1 + (i >> 1 & 1) * step,
+								z + 1 + (i & 1) * step, m)];
+						}
+						gridCell.Initialize(
+							corners[0], corners[1], corners[2], corners[3],
+							corners[4], corners[5], corners[6], corners[7]);
+
+						cellTriangles.clear();
+						if (attributes) {
+							for (Uint8 i = 0; i < 8; i++) {
+								const Uint32 cx = x + (i >> 2) * step;
+								const Uint32 cy = y + (i >> 1 & 1) * step;
+								const Uint32 cz = z + (i & 1) * step;
+								const Uint32 normal = ((cx - fromX) * s + cy) * s + cz;
+								const Uint8 point = GridCell::PointOfCorner(i);
+								gridCell.normals[point].Reset(
+									normalField.X[normal], normalField.Y[normal], normalField.Z[normal]);
+								gridCell.materials[point] = apron.Materials[(cx * s + cy) * s + cz];
+							}
+							MarchingCube(
+								cellTriangles, attributes->Normals, attributes->Materials, 0, gridCell);
+						} else {
+							MarchingCube(cellTriangles, 0, gridCell);
+						}
+
+						displacement.Reset((float) x, (float) y, (float) z);
+						for (const auto & tri : cellTriangles) {
+							triangles.push_back(Triangle3D<float>(
+								(tri.Point1 * (float) step + displacement) * scale,
+								(tri.Point2 * (float) step + displacement) * scale,
+								(tri.Point3 * (float) step + displacement) * scale));
+						}
+					}
+				}
+			}
+		}
+
+		/*
+		 The density test shared by FillSolid and IsSolidAt, over the 8 corners of the cell
+		 whose lowest corner is at padded sample (x, y, z).
+		 */
+		inline bool IsSolidCell(
+			const float * density,
+			const Uint32 x, const Uint32 y, const Uint32 z,
+			const Uint32 m
+		) {
+			double sum = 0;
+			for (Uint8 i = 0; i < 8; i++)
+				sum += density[ApronIndex(x + (i >> 2), y + (i >> 1 & 1), z + (i & 1), m)];
+			return EGT(sum, 0);
+		}
+
+		void FillSolid(const ChunkApron & apron, OccupancyGrid3D & solid, const Uint32 cellCount) {
+			const Uint32 n = cellCount;
+			const Uint32 m = n + 3;
+			const float * density = apron.Density.data();
+			solid.Clear();
+
+			for (Uint32 x = 0; x < n; x++) {
+				for (Uint32 y = 0; y < n; y++) {
+					for (Uint32 z = 0; z < n; z++) {
+						if (IsSolidCell(density, x + 1, y + 1, z + 1, m))
+							solid.Set(x, y, z, true);
+					}
+				}
+			}
+		}
+
+		bool IsSolidAt(const ChunkApron & apron, const Vector3D<Int64> & cell, const Uint32 cellCount) {
+			const Uint32 n = cellCount;
+			const Int64 extent = 3 * (Int64) n;
+
+			// Cells whose corners all lie within the apron, from -1 to n along every axis
+			if (cell.X >= -1 && cell.Y >= -1 && cell.Z >= -1 &&
+					cell.X <= n && cell.Y <= n && cell.Z <= n) {
+				return IsSolidCell(apron.Density.data(),
+					(Uint32) (cell.X + 1), (Uint32) (cell.Y + 1), (Uint32) (cell.Z + 1), n + 3);
+			}
+
+			double sum = 0;
+			for (Uint8 i = 0; i < 8; i++) {
+				// Shift the corner so that it is relative to the first chunk of the set
+				const Int64 x = cell.X + (i >> 2) + n;
+				const Int64 y = cell.Y + (i >> 1 & 1) + n;
+				const Int64 z = cell.Z + (i & 1) + n;
+
+				// Points outside of the set are conservatively treated as solid
+				if (x < 0 || y < 0 || z < 0 || x >= extent || y >= extent || z >= extent)
+					return true;
+
+				const Uint32 ux = (Uint32) x, uy = (Uint32) y, uz = (Uint32) z;
+				const ChunkData & data = *apron.Chunks.Get(ux / n, uy / n, uz / n);
+				sum += DensityAt(data, ux % n, uy % n, uz % n, n);
+			}
+			return EGT(sum, 0);
+		}
+
+		const ChunkKernels Kernels = {
+			&FillDensity, &FillApron, &GenerateMesh, &FillSolid, &IsSolidAt };
+	}
+
+	const ChunkKernels & GetChunkKernels() {
+		return Kernels;
+	}
+}
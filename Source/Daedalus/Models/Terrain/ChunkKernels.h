@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Models/Terrain/ChunkApron.h>
+#include <Models/Terrain/ChunkData.h>
+#include <Utilities/Algebra/Algebra3D.h>
+#include <Utilities/OccupancyGrid.h>
+
+#include <vector>
+
+namespace terrain {
+	/**
+	 * Vertex attributes of the triangles built by ChunkKernels::GenerateMesh, in the same
+	 * order as the triangles.
+	 */
+	struct ChunkMeshAttributes {
+		std::vector<utils::Triangle3D<float>> Normals;  // Outward, not normalized
+		std::vector<utils::MaterialBlend> Materials;    // Three per triangle
+	};
+
+	/**
+	 * The hot loops of chunk generation and meshing, shared by the loader, the chunk actors
+	 * and the meshing jobs.
+	 *
+	 * All kernels expect the density data of the chunks to be cellCount^3 in size. Apart from
+	 * FillApron, they read the chunk through its apron rather than the chunk data set.
+	 */
+	struct ChunkKernels {
+		/**
+		 * Sets the density of every cell below the given local height to 1.
+		 * @param localHeight Height in grid cells from the bottom of the chunk.
+		 */
+		void (*FillDensity)(ChunkData & data, const double localHeight, const Uint32 cellCount);
+
+		/**
+		 * Copies the samples of the centre chunk of the set and the border planes of its
+		 * neighbours into the apron, recording the chunks and their versions.
+		 */
+		void (*FillApron)(const ChunkDataSet & chunks, ChunkApron & apron, const Uint32 cellCount);
+
+		/**
+		 * Runs marching cubes over the chunk of the apron. Triangles are appended in chunk
+		 * space multiplied by scale. The mesh is built in single precision from the density
+		 * samples to the vertices, and only reads the apron, so it can run off the game thread.
+		 * @param lod Level of detail, each marching cube spans 2^lod grid cells along every
+		 *            axis. cellCount must be a multiple of 2^lod.
+		 * @param fromX First cell along x to mesh, a multiple of 2^lod.
+		 * @param toX One past the last cell along x to mesh, a multiple of 2^lod. Triangles
+		 *            are appended in order of x, so the cells can be meshed a slab at a time.
+		 * @param attributes If not NULL, the vertex attributes of each triangle are appended
+		 *                   here. Normals are taken from the gradient of the density field, and
+		 *                   materials are blended from the material data around the vertex.
+		 */
+		void (*GenerateMesh)(
+			const ChunkApron & apron,
+			const float scale,
+			const Uint32 lod,
+			const Uint32 fromX,
+			const Uint32 toX,
+			std::vector<utils::Triangle3D<float>> & triangles,
+			ChunkMeshAttributes * attributes,
+			const Uint32 cellCount);
+
+		/**
+		 * Marks the grid cells of the chunk with any density in solid, which is cleared first.
+		 * This follows the same density test as IsSolidAt.
+		 */
+		void (*FillSolid)(
+			const ChunkApron & apron,
+			utils::OccupancyGrid3D & solid,
+			const Uint32 cellCount);
+
+		/**
+		 * Checks the density around a grid cell of the chunk, which may lie in any of the
+		 * neighbours. Cells next to the chunk are read from the apron, cells further out from
+		 * the neighbouring chunk data. Cells outside the neighbourhood are reported as solid.
+		 */
+		bool (*IsSolidAt)(
+			const ChunkApron & apron,
+			const utils::Vector3D<Int64> & cell,
+			const Uint32 cellCount);
+	};
+
+	const ChunkKernels & GetChunkKernels();
+}
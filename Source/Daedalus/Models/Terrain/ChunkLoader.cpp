@@ -5,6 +5,29 @@ namespace terrain {
 	using namespace utils;
 	using ChunkCache = ChunkLoader::ChunkCache;
 
+	namespace {
+		/*
+		 Chunks still sharing the fields the generator built have never been edited.
+		 */
+		inline bool IsEdited(const ChunkLoader::LoadedChunk & loaded) {
+			const auto & data = *loaded.Data;
+			return data.DensityData.Share() != loaded.BaseDensity ||
+				data.MaterialData.Share() != loaded.BaseMaterials || !data.PlacedItems.empty();
+		}
+	}
+
+	ChunkLoader::ChunkLoader(
+		const TerrainGeneratorParameters & params,
+		const BiomeRegionLoaderPtr & brLoader
+	) : TerrainGenParams(params), BRLoader(brLoader),
+		Kernels(&GetChunkKernels())
+	{
+		const Uint32 size = params.GridCellCount;
+		EmptyDensity = std::make_shared<ChunkData::DensityField>(size, size, size, 0.0f);
+		SolidDensity = std::make_shared<ChunkData::DensityField>(size, size, size, 1.0f);
+		DefaultMaterials = std::make_shared<ChunkData::MaterialField>(size, size, size, 0);
+	}
+
 	ChunkLoader::~ChunkLoader() {
 		LoadedChunkCache.empty();
 	}
@@ -15,19 +38,116 @@ namespace terrain {
 	}
 
 	ChunkDataPtr ChunkLoader::GetGeneratedChunk(const ChunkOffsetVector & offset) {
-		auto found = LoadedChunkCache.find(offset);
-		if (found != LoadedChunkCache.end())
-			return found->second;
+		auto found = FindLoadedChunk(offset);
+		if (found)
+			return found;
 		else
 			return LoadChunkFromDisk(offset);
 	}
 
-	ChunkDataPtr ChunkLoader::LoadChunkFromDisk(const ChunkOffsetVector & offset) {
-		// implement disk loading
+	ChunkDataPtr ChunkLoader::FindLoadedChunk(const ChunkOffsetVector & offset) const {
+		auto found = LoadedChunkCache.find(offset);
+		if (found != LoadedChunkCache.end())
+			return found->second.Data;
 		return NULL;
 	}
 
+	void ChunkLoader::UnloadChunk(const ChunkOffsetVector & offset) {
+		const auto found = LoadedChunkCache.find(offset);
+		if (found == LoadedChunkCache.end())
+			return;
+
+		const auto & loaded = found->second;
+		const auto & data = *loaded.Data;
+		UnregisterPlacedItems(offset, data);
+		if (IsEdited(loaded)) {
+			std::shared_ptr<ChunkDelta> delta(new ChunkDelta(offset));
+			DiffChunkSamples(*loaded.BaseDensity, *loaded.BaseMaterials, *data.DensityData,
+				*data.MaterialData, *delta);
+			RecordPlacedItems(data.PlacedItems, delta->Items);
+			if (delta->IsEmpty())
+				Deltas.erase(offset);
+			else
+				Deltas[offset] = delta;
+		}
+		LoadedChunkCache.erase(found);
+
+		// The neighbours would otherwise keep linking to the chunk that was just dropped
+		for (Int64 x = -1; x <= 1; x++) {
+			for (Int64 y = -1; y <= 1; y++) {
+				for (Int64 z = -1; z <= 1; z++) {
+					const auto neighbour =
+						LoadedChunkCache.find(offset + ChunkOffsetVector(x, y, z));
+					if (neighbour != LoadedChunkCache.end())
+						neighbour->second.bNeighbourhoodResolved = false;
+				}
+			}
+		}
+	}
+
+	ChunkDataPtr ChunkLoader::LoadChunkFromDisk(const ChunkOffsetVector & offset) {
+		const auto found = Deltas.find(offset);
+		if (found == Deltas.end())
+			return NULL;
+
+		// The base is pinned before the delta is applied on top of it
+		auto data = GenerateBaseChunk(offset);
+		LoadedChunkCache.insert({ offset, LoadedChunk(data) });
+		ApplyChunkDelta(*found->second, ItemFactory, *data);
+		RegisterPlacedItems(offset, *data);
+		return data;
+	}
+
 	ChunkDataPtr ChunkLoader::GenerateMissingChunk(const ChunkOffsetVector & offset) {
+		auto data = GenerateBaseChunk(offset);
+		LoadedChunkCache.insert({ offset, LoadedChunk(data) });
+		// A new chunk has no items of its own, but its neighbours' items may reach into it
+		RegisterPlacedItems(offset, *data);
+		return data;
+	}
+
+	void ChunkLoader::RegisterPlacedItems(const ChunkOffsetVector & offset, ChunkData & data) {
+		const double gcc = (double) TerrainGenParams.GridCellCount;
+		for (Int64 x = -1; x <= 1; x++) {
+			for (Int64 y = -1; y <= 1; y++) {
+				for (Int64 z = -1; z <= 1; z++) {
+					const auto neighbour = FindLoadedChunk(offset + ChunkOffsetVector(x, y, z));
+					if (!neighbour)
+						continue;
+
+					// Offsets of the item's chunk from the indexing chunk in grid cells, as in
+					// AChunk::UpdateItemIndex. The indexes skip the items that don't reach them.
+					const Point3D toNeighbour(-x * gcc, -y * gcc, -z * gcc);
+					for (const auto & item : data.PlacedItems)
+						neighbour->ItemIndex.Insert(item, toNeighbour);
+					if (neighbour.get() == &data)
+						continue;
+					const Point3D fromNeighbour(x * gcc, y * gcc, z * gcc);
+					for (const auto & item : neighbour->PlacedItems)
+						data.ItemIndex.Insert(item, fromNeighbour);
+				}
+			}
+		}
+	}
+
+	void ChunkLoader::UnregisterPlacedItems(
+		const ChunkOffsetVector & offset,
+		const ChunkData & data
+	) {
+		for (Int64 x = -1; x <= 1; x++) {
+			for (Int64 y = -1; y <= 1; y++) {
+				for (Int64 z = -1; z <= 1; z++) {
+					const auto neighbour = FindLoadedChunk(offset + ChunkOffsetVector(x, y, z));
+					if (!neighbour || neighbour.get() == &data)
+						continue;
+					for (const auto & item : data.PlacedItems)
+						neighbour->ItemIndex.Remove(item);
+				}
+			}
+		}
+	}
+
+	Int32 ChunkLoader::ComputeSurfaceHeight(const ChunkOffsetVector & offset) const {
 		const auto & props = BRLoader->GetGeneratorParameters();
 		const auto point = TerrainGenParams.ToRealCoordSpace(offset).Truncate();
 		const auto biomeTri = BRLoader->FindContainingBiomeTriangle(point);
@@ -37,12 +157,66 @@ namespace terrain {
 			biomeTri[1]->GetElevation() * uvw.X +
 			biomeTri[2]->GetElevation() * uvw.Y +
 			biomeTri[0]->GetElevation() * uvw.Z) - 0.75) * 10000;
-		auto data = new ChunkData(TerrainGenParams.GridCellCount, offset);
-		SetDefaultHeight(*data, (Int32) height);
-		// TODO: implement disk saving
-		auto cd = ChunkDataPtr(data);
-		LoadedChunkCache.insert({ offset, cd });
-		return cd;
+		return (Int32) height;
+	}
+
+	ChunkDataPtr ChunkLoader::GenerateBaseChunk(const ChunkOffsetVector & offset) const {
+		const Int32 height = ComputeSurfaceHeight(offset);
+		const Uint32 size = TerrainGenParams.GridCellCount;
+		const auto chunkHeight = (Int64) TerrainGenParams.ChunkScale;
+		// Uniform chunks share their fields instead of allocating and filling them
+		if ((offset.Z + 1) * chunkHeight < height)
+			return ChunkDataPtr(new ChunkData(size, offset, SolidDensity, DefaultMaterials));
+		if (offset.Z * chunkHeight > height)
+			return ChunkDataPtr(new ChunkData(size, offset, EmptyDensity, DefaultMaterials));
+
+		auto data = ChunkDataPtr(new ChunkData(size, offset));
+		SetDefaultHeight(*data, height);
+		return data;
+	}
+
+	Int64 ChunkLoader::GetColumnHeight(const Int64 x, const Int64 y) {
+		const ChunkOffsetVector column(x, y, 0);
+		const auto found = ColumnHeights.find(column);
+		if (found != ColumnHeights.end())
+			return found->second;
+		const Int64 height = ComputeSurfaceHeight(column);
+		ColumnHeights.insert({ column, height });
+		return height;
+	}
+
+	ChunkColumnSummary ChunkLoader::GetColumnSummary(const ChunkOffsetVector & offset) {
+		ChunkColumnSummary summary(GetColumnHeight(offset.X, offset.Y));
+		for (Int64 x = -1; x <= 1; x++) {
+			for (Int64 y = -1; y <= 1; y++)
+				summary.Include(GetColumnHeight(offset.X + x, offset.Y + y));
+		}
+		return summary;
+	}
+
+	bool ChunkLoader::IsChunkEdited(const ChunkOffsetVector & offset) const {
+		const auto found = LoadedChunkCache.find(offset);
+		if (found != LoadedChunkCache.end())
+			return IsEdited(found->second);
+		return Deltas.find(offset) != Deltas.end();
+	}
+
+	ChunkBand ChunkLoader::ClassifyChunk(const ChunkOffsetVector & offset) {
+		const auto band = GetColumnSummary(offset).Classify(
+			offset.Z, (Int64) TerrainGenParams.ChunkScale);
+		if (band == E_Surface)
+			return band;
+
+		// Edits can cut into the sky or the ground
+		for (Int64 x = -1; x <= 1; x++) {
+			for (Int64 y = -1; y <= 1; y++) {
+				for (Int64 z = -1; z <= 1; z++) {
+					if (IsChunkEdited(offset + ChunkOffsetVector(x, y, z)))
+						return E_Surface;
+				}
+			}
+		}
+		return band;
 	}
 
 	ChunkDataPtr ChunkLoader::GetChunkAt(const ChunkOffsetVector & offset) {
@@ -56,28 +230,89 @@ namespace terrain {
 		return loaded;
 	}
 
+	const ChunkDataSet & ChunkLoader::GetChunkSetAt(const ChunkOffsetVector & offset) {
+		GetChunkAt(offset);
+		// Loading the neighbours may rehash the cache, but references to entries stay valid
+		LoadedChunk & loaded = LoadedChunkCache.find(offset)->second;
+		if (!loaded.bNeighbourhoodResolved) {
+			for (Uint8 x = 0; x < 3; x++) {
+				for (Uint8 y = 0; y < 3; y++) {
+					for (Uint8 z = 0; z < 3; z++) {
+						loaded.Neighbourhood.Set(x, y, z, GetChunkAt(
+							ChunkOffsetVector(offset.X + x - 1, offset.Y + y - 1, offset.Z + z - 1)));
+					}
+				}
+			}
+			loaded.bNeighbourhoodResolved = true;
+		}
+		return loaded.Neighbourhood;
+	}
+
+	void ChunkLoader::ApplyEdit(const TerrainEdit & edit, DirtyChunkMap & dirty) {
+		std::vector<ChunkOffsetVector> offsets;
+		FindEditedChunks(edit, TerrainGenParams.GridCellCount, offsets);
+		for (const auto & offset : offsets) {
+			const bool bWasLoaded = FindLoadedChunk(offset) != NULL;
+			ChunkCellRange changed;
+			if (ApplyTerrainEdit(edit, *GetChunkAt(offset), changed))
+				MarkDirtyCells(offset, changed, TerrainGenParams.GridCellCount, dirty);
+
+			// Nobody holds on to chunks loaded just for the edit, so they go back to being deltas
+			if (!bWasLoaded)
+				UnloadChunk(offset);
+		}
+	}
+
+	WorldSnapshotPtr ChunkLoader::CreateSnapshot() const {
+		std::shared_ptr<WorldSnapshot> snapshot(new WorldSnapshot());
+		for (const auto & entry : LoadedChunkCache) {
+			const auto & loaded = entry.second;
+			const auto & data = *loaded.Data;
+			if (!IsEdited(loaded))
+				continue;
+
+			ChunkSnapshot chunk;
+			chunk.Density = data.DensityData.Share();
+			chunk.Materials = data.MaterialData.Share();
+			chunk.ChunkOffset = entry.first;
+			chunk.BaseDensity = loaded.BaseDensity;
+			chunk.BaseMaterials = loaded.BaseMaterials;
+			RecordPlacedItems(data.PlacedItems, chunk.Items);
+			snapshot->Chunks.push_back(std::move(chunk));
+		}
+
+		for (const auto & entry : Deltas) {
+			if (LoadedChunkCache.find(entry.first) == LoadedChunkCache.end())
+				snapshot->Deltas.insert(entry);
+		}
+		return snapshot;
+	}
+
+	void ChunkLoader::SaveChunkDeltas(std::ostream & output) const {
+		WriteWorldSnapshot(output, *CreateSnapshot());
+	}
+
+	void ChunkLoader::LoadChunkDeltas(std::istream & input) {
+		ReadChunkDeltas(input, Deltas);
+	}
+
 	const TerrainGeneratorParameters & ChunkLoader::GetGeneratorParameters() const {
 		return TerrainGenParams;
 	}
 
-	void ChunkLoader::SetDefaultHeight(ChunkData & data, const Int32 height) {
+	void ChunkLoader::SetDefaultHeight(ChunkData & data, const Int32 height) const {
 		// TODO: if the chunk height ended on a chunk division line, no triangles are generated
 		auto chunkHeight = TerrainGenParams.ChunkScale;
 		if (((data.ChunkOffset.Z + 1) * (Int64) chunkHeight) < height) {
-			data.DensityData.Fill(1.0);			// Completely filled block
+			data.DensityData.Mutable().Fill(1.0);			// Completely filled block
 			//UE_LOG(LogTemp, Error, TEXT("Ground chunk"));
 		} else if ((data.ChunkOffset.Z * (Int64) chunkHeight) > height) {
-			data.DensityData.Fill(0.0);			// Completely empty block
+			data.DensityData.Mutable().Fill(0.0);			// Completely empty block
 			//UE_LOG(LogTemp, Error, TEXT("Air chunk"));
 		} else {
 			//UE_LOG(LogTemp, Error, TEXT("Mixed chunk"));
 			auto localHeight = TerrainGenParams.GridCellCount * (height / chunkHeight - data.ChunkOffset.Z);
-			for (Uint32 x = 0; x < data.ChunkFieldSize; x++) {
-				for (Uint32 y = 0; y < data.ChunkFieldSize; y++) {
-					for (Uint32 z = 0; z < data.ChunkFieldSize && z < localHeight; z++)
-						data.DensityData.Set(x, y, z, 1);
-				}
-			}
+			Kernels->FillDensity(data, localHeight, data.ChunkFieldSize);
 		}
 	}
 }
@@ -1,11 +1,18 @@
 #pragma once
 
+#include <Models/Items/ItemDataFactory.h>
 #include <Models/Terrain/ChunkData.h>
+#include <Models/Terrain/ChunkDelta.h>
+#include <Models/Terrain/ChunkKernels.h>
 #include <Models/Terrain/TerrainDataStructures.h>
 #include <Models/Terrain/BiomeRegionLoader.h>
+#include <Models/Terrain/TerrainEditing.h>
+#include <Models/Terrain/WorldSnapshot.h>
 #include <Utilities/Algebra/Algebra3D.h>
 
+#include <istream>
 #include <memory>
+#include <ostream>
 #include <unordered_map>
 
 namespace terrain {
@@ -18,15 +25,48 @@ namespace terrain {
 	 */
 	class ChunkLoader {
 	public:
-		using ChunkCache = std::unordered_map<ChunkOffsetVector, ChunkDataPtr>;
+		/**
+		 * A loaded chunk, linked to its neighbours the first time they are asked for. The
+		 * fields the generator built are kept for as long as the chunk is loaded, so that
+		 * saving can diff against them without running the generator again. Until the
+		 * chunk is edited they are shared with it and cost nothing.
+		 */
+		struct LoadedChunk {
+			ChunkDataPtr Data;
+			ChunkDataSet Neighbourhood;          // The chunk itself is at (1, 1, 1)
+			bool bNeighbourhoodResolved;
+			std::shared_ptr<const ChunkData::DensityField> BaseDensity;
+			std::shared_ptr<const ChunkData::MaterialField> BaseMaterials;
+
+			LoadedChunk(const ChunkDataPtr & data) :
+				Data(data), Neighbourhood(NULL), bNeighbourhoodResolved(false),
+				BaseDensity(data->DensityData.Share()), BaseMaterials(data->MaterialData.Share())
+			{}
+		};
+
+		using ChunkCache = std::unordered_map<ChunkOffsetVector, LoadedChunk>;
 
 	private:
 		ChunkCache LoadedChunkCache;
+		// Edits made by players, on top of what the generator builds for each chunk
+		ChunkDeltaMap Deltas;
+		items::ItemDataFactory ItemFactory;             // Rebuilds the items in the deltas
 
 		TerrainGeneratorParameters TerrainGenParams;
 		BiomeRegionLoaderPtr BRLoader;
+		const ChunkKernels * Kernels;
+
+		// Shared by every chunk entirely above or below the surface, until it is edited
+		std::shared_ptr<ChunkData::DensityField> EmptyDensity;
+		std::shared_ptr<ChunkData::DensityField> SolidDensity;
+		std::shared_ptr<ChunkData::MaterialField> DefaultMaterials;
+		// Surface height of each column of chunks, keyed by the offset with a zero Z
+		std::unordered_map<ChunkOffsetVector, Int64> ColumnHeights;
 
 		bool IsChunkGenerated(const ChunkOffsetVector & offset) const;
+		bool IsChunkEdited(const ChunkOffsetVector & offset) const;
+		Int64 GetColumnHeight(const Int64 x, const Int64 y);
+		Int32 ComputeSurfaceHeight(const ChunkOffsetVector & offset) const;
 		
 		/**
 		 * @return Null pointer if the chunk has not yet been generated, otherwise
@@ -37,19 +77,89 @@ namespace terrain {
 		ChunkDataPtr LoadChunkFromDisk(const ChunkOffsetVector & offset);
 		ChunkDataPtr GenerateMissingChunk(const ChunkOffsetVector & offset);
 
+		/**
+		 * Runs the generator for the chunk without caching it. The result only depends on
+		 * the seed and the offset, which is what the deltas rely on.
+		 */
+		ChunkDataPtr GenerateBaseChunk(const ChunkOffsetVector & offset) const;
+
+		/**
+		 * Adds the placed items of a chunk that was just loaded to the item indexes of its
+		 * loaded neighbours, and theirs to its own, since items reach across chunk borders.
+		 */
+		void RegisterPlacedItems(const ChunkOffsetVector & offset, ChunkData & data);
+		void UnregisterPlacedItems(const ChunkOffsetVector & offset, const ChunkData & data);
+
 		//void RunDiamondSquare(ChunkData & data);
-		void SetDefaultHeight(ChunkData & data, Int32 height);
+		void SetDefaultHeight(ChunkData & data, Int32 height) const;
 
 	public:
 		ChunkLoader(
 			const TerrainGeneratorParameters & params,
 			const BiomeRegionLoaderPtr & brLoader
-		) : TerrainGenParams(params), BRLoader(brLoader)
-		{}
+		);
 		~ChunkLoader();
 
 		const TerrainGeneratorParameters & GetGeneratorParameters() const;
 		ChunkDataPtr GetChunkAt(const ChunkOffsetVector & offset);
+
+		/**
+		 * Loads the chunk and its 26 neighbours. The neighbours are only looked up the first
+		 * time, after that the set is kept with the chunk.
+		 */
+		const ChunkDataSet & GetChunkSetAt(const ChunkOffsetVector & offset);
+
+		/**
+		 * Applies the edit to every chunk it touches. Chunks that weren't loaded are only
+		 * loaded for the edit, and are unloaded again right after with the edit as their delta.
+		 * @param dirty Receives the cells of each chunk that have to be remeshed.
+		 */
+		void ApplyEdit(const TerrainEdit & edit, DirtyChunkMap & dirty);
+
+		/**
+		 * @return Null pointer if the chunk isn't currently loaded. Unlike GetChunkAt, this
+		 *         never loads or generates chunks, so it is safe to use for read-only queries.
+		 */
+		ChunkDataPtr FindLoadedChunk(const ChunkOffsetVector & offset) const;
+
+		/**
+		 * @return The surface band around the chunk's column.
+		 */
+		ChunkColumnSummary GetColumnSummary(const ChunkOffsetVector & offset);
+
+		/**
+		 * Tells chunks that can be skipped entirely from the ones that have to be meshed,
+		 * without generating any of them. A chunk is only skipped if it and all of its
+		 * neighbours are uniform and unedited, since a mesh depends on the neighbours too.
+		 */
+		ChunkBand ClassifyChunk(const ChunkOffsetVector & offset);
+
+		/**
+		 * Drops the chunk from memory, keeping its edits as a delta so that they are applied
+		 * again when it is next loaded. Its items are removed from the item indexes of its
+		 * neighbours. Holders of the chunk data keep their copy, but it is no longer the one
+		 * edits are applied to.
+		 */
+		void UnloadChunk(const ChunkOffsetVector & offset);
+		inline Uint64 GetLoadedCount() const { return LoadedChunkCache.size(); }
+
+		/**
+		 * Pins the current version of every edited chunk. This only copies pointers and the
+		 * placed items, so it is cheap enough to take on the game thread, and the snapshot
+		 * can then be written on any thread while the game keeps editing the chunks.
+		 */
+		WorldSnapshotPtr CreateSnapshot() const;
+
+		/**
+		 * Writes the deltas of all edited chunks, loaded or not, on the calling thread.
+		 */
+		void SaveChunkDeltas(std::ostream & output) const;
+
+		/**
+		 * Reads deltas saved by SaveChunkDeltas. They are applied to the chunks as they are
+		 * generated, so this should happen before the chunks are first loaded.
+		 */
+		void LoadChunkDeltas(std::istream & input);
 	};
 
 	using ChunkLoaderPtr = std::shared_ptr<ChunkLoader>;
@@ -0,0 +1,165 @@
+#include <Daedalus.h>
+#include "ChunkMesher.h"
+
+#include <algorithm>
+
+namespace terrain {
+	using namespace utils;
+
+	namespace {
+		/*
+		 Adds the triangles of one slab of cells along x to the welder, which is whole cells
+		 wide at the level of detail.
+		 */
+		void AddSlab(
+			const ChunkMeshRequest & request,
+			const Uint32 lod,
+			const Uint32 fromX,
+			const Uint32 toX,
+			MeshWelder & welder
+		) {
+			// Collision meshes have no use for the vertex attributes
+			const bool bAttributes = lod == 0;
+			std::vector<Triangle3D<float>> triangles;
+			ChunkMeshAttributes attributes;
+			request.Kernels->GenerateMesh(
+				*request.Apron, request.Scale, lod, fromX, toX, triangles,
+				bAttributes ? &attributes : NULL, request.CellCount);
+
+			for (Uint64 i = 0; i < triangles.size(); i++) {
+				if (bAttributes) {
+					welder.AddTriangle(
+						triangles[i], attributes.Normals[i], &attributes.Materials[i * 3],
+						request.MaterialId);
+				} else {
+					welder.AddTriangle(triangles[i], request.MaterialId);
+				}
+			}
+		}
+
+		/*
+		 Copies triangles of the previous render mesh into the welder, with their vertex
+		 normals and material layers.
+		 */
+		void AddPreviousTriangles(
+			const MeshSection & section,
+			const Uint64 first,
+			const Uint64 count,
+			MeshWelder & welder
+		) {
+			MaterialBlend blends[3];
+			for (Uint64 t = first; t < first + count; t++) {
+				const Uint32 * indices = &section.Indices[t * 3];
+				for (Uint8 i = 0; section.IsBlended() && i < 3; i++) {
+					const auto & weights = section.LayerWeights[indices[i]];
+					const float layerWeights[] = { weights.X, weights.Y, weights.Z, weights.W };
+					blends[i] = MaterialBlend();
+					for (Uint64 layer = 0; layer < section.Layers.size(); layer++)
+						blends[i].Add(section.Layers[layer], layerWeights[layer]);
+				}
+				welder.AddTriangle(
+					Triangle3D<float>(
+						section.Positions[indices[0]],
+						section.Positions[indices[1]],
+						section.Positions[indices[2]]),
+					Triangle3D<float>(
+						section.Normals[indices[0]],
+						section.Normals[indices[1]],
+						section.Normals[indices[2]]),
+					section.IsBlended() ? blends : NULL,
+					section.MaterialId);
+			}
+		}
+
+		/*
+		 The previous mesh can be spliced if it was built slab by slab from the same material,
+		 which leaves it with at most one section.
+		 */
+		bool CanSplice(const ChunkMeshRequest & request) {
+			const auto & previous = request.PreviousMesh;
+			if (!previous || request.PreviousSlabTriangles.size() != request.CellCount)
+				return false;
+			if (previous->Sections.empty())
+				return true;
+			return previous->Sections.size() == 1 &&
+				previous->Sections[0].MaterialId == request.MaterialId;
+		}
+
+		MeshBufferConstPtr BuildRenderMesh(
+			const ChunkMeshRequest & request,
+			std::vector<Uint32> & slabTriangles
+		) {
+			const Uint32 n = request.CellCount;
+			Uint32 fromX = 0, toX = n;
+			const MeshSection * previous = NULL;
+
+			if (CanSplice(request)) {
+				if (request.Dirty.IsEmpty()) {
+					slabTriangles = request.PreviousSlabTriangles;
+					return request.PreviousMesh;
+				}
+				fromX = (Uint32) std::max((Int64) 0, request.Dirty.Min.X);
+				toX = (Uint32) std::min((Int64) n, request.Dirty.Max.X + 1);
+				if (!request.PreviousMesh->Sections.empty())
+					previous = &request.PreviousMesh->Sections[0];
+			}
+
+			const MeshBufferPtr mesh(new MeshBuffer());
+			MeshWelder welder(*mesh);
+			slabTriangles.assign(n, 0);
+			Uint64 copied = 0;
+
+			// Marching cubes emits every vertex once per triangle using it, a vertex is usually
+			// shared by about 6 triangles. The triangles stay in slab order, so later edits can
+			// be spliced in again.
+			for (Uint32 x = 0; x < n; x++) {
+				const Uint64 before = mesh->GetTriangleCount();
+				if (x >= fromX && x < toX) {
+					AddSlab(request, 0, x, x + 1, welder);
+				} else if (previous) {
+					AddPreviousTriangles(*previous, copied, request.PreviousSlabTriangles[x], welder);
+				}
+				if (previous)
+					copied += request.PreviousSlabTriangles[x];
+				slabTriangles[x] = (Uint32) (mesh->GetTriangleCount() - before);
+			}
+			welder.Finish();
+			return mesh;
+		}
+
+		MeshBufferConstPtr BuildCollisionMesh(const ChunkMeshRequest & request, const Uint32 lod) {
+			const MeshBufferPtr mesh(new MeshBuffer());
+			MeshWelder welder(*mesh);
+			AddSlab(request, lod, 0, request.CellCount, welder);
+			welder.Finish();
+			return mesh;
+		}
+	}
+
+	ChunkMeshResult BuildChunkMesh(const ChunkMeshRequest & request) {
+		ChunkMeshResult result;
+		result.ChunkOffset = request.ChunkOffset;
+		result.Version = request.Version;
+		result.Mesh = BuildRenderMesh(request, result.SlabTriangles);
+
+		Uint32 lod = request.CollisionLod;
+		while (lod > 0 && request.CellCount % (1u << lod) != 0)
+			lod--;
+		if (lod > 0)
+			result.CollisionMesh = BuildCollisionMesh(request, lod);
+
+		return result;
+	}
+
+	void ChunkMeshResultQueue::Push(ChunkMeshResult && result) {
+		std::lock_guard<std::mutex> guard(Lock);
+		Results.push_back(std::move(result));
+	}
+
+	void ChunkMeshResultQueue::TakeAll(std::vector<ChunkMeshResult> & output) {
+		std::lock_guard<std::mutex> guard(Lock);
+		for (auto & result : Results)
+			output.push_back(std::move(result));
+		Results.clear();
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Models/Terrain/ChunkApron.h>
+#include <Models/Terrain/ChunkKernels.h>
+#include <Models/Terrain/TerrainDataStructures.h>
+#include <Utilities/Mesh/MeshBuffer.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace terrain {
+	/**
+	 * Everything needed to mesh a chunk away from the game thread. The request holds on to
+	 * the apron of the chunk, so the data outlives the chunk being unloaded in the meantime.
+	 * Aprons are never modified once built, a chunk whose data changes builds a new one.
+	 */
+	struct ChunkMeshRequest {
+		ChunkOffsetVector ChunkOffset;
+		Uint64 Version;                      // Identifies the request when the result comes back
+		ChunkApronPtr Apron;
+		const ChunkKernels * Kernels;
+		float Scale;                         // Size of a grid cell in real world units
+		Uint32 CellCount;
+		Uint32 MaterialId;                   // Material blending the terrain material layers
+		Uint32 CollisionLod;                 // 0 to collide with the render mesh
+
+		/*
+		 An earlier render mesh of the chunk to update instead of meshing every cell. Only the
+		 slabs of cells along x that overlap the dirty cells are remeshed, the triangles of
+		 the other slabs are copied over from the earlier mesh.
+		 */
+		utils::MeshBufferConstPtr PreviousMesh;
+		std::vector<Uint32> PreviousSlabTriangles;
+		ChunkCellRange Dirty;                // Cells changed since the previous mesh was built
+	};
+
+	struct ChunkMeshResult {
+		ChunkOffsetVector ChunkOffset;
+		Uint64 Version;
+		utils::MeshBufferConstPtr Mesh;
+		utils::MeshBufferConstPtr CollisionMesh;  // NULL when the render mesh is used for collision
+		std::vector<Uint32> SlabTriangles;   // Triangles of the render mesh in each slab along x
+	};
+
+	/**
+	 * Pure CPU stage of chunk meshing, safe to run on any thread. The vertices of the mesh are
+	 * welded, with smooth normals from the gradient of the density field. The whole mesh is a
+	 * single section, blending the chunk's material data as layers of that section. With a
+	 * collision LOD, a coarser mesh is also built for collision, lowering the level of detail
+	 * as far as the chunk size allows. The collision mesh is always built from scratch.
+	 */
+	ChunkMeshResult BuildChunkMesh(const ChunkMeshRequest & request);
+
+	/**
+	 * Hands finished meshes from the worker threads back to the game thread. Workers push
+	 * results as they finish and the game thread takes them all at once.
+	 */
+	class ChunkMeshResultQueue {
+	private:
+		std::mutex Lock;
+		std::vector<ChunkMeshResult> Results;
+
+	public:
+		void Push(ChunkMeshResult && result);
+
+		/**
+		 * Moves every finished result into output, in the order they finished.
+		 */
+		void TakeAll(std::vector<ChunkMeshResult> & output);
+	};
+
+	// Shared with the worker tasks, so that it outlives the chunk manager
+	using ChunkMeshResultQueuePtr = std::shared_ptr<ChunkMeshResultQueue>;
+}
@@ -0,0 +1,138 @@
+#include <Daedalus.h>
+#include "ChunkPrefetcher.h"
+
+#include <cstdlib>
+
+namespace terrain {
+	using namespace utils;
+
+	namespace {
+		const Uint32 MaxHistory = 8;
+		const double HistoryWindow = 3.0;         // Seconds of positions to estimate from
+		const Uint32 MaxPathSteps = 64;
+	}
+
+	bool ChunkPrefetcher::IsInRange(
+		const ChunkOffsetVector & offset,
+		const ChunkOffsetVector & centre
+	) const {
+		return std::abs(offset.X - centre.X) <= Radius && std::abs(offset.Y - centre.Y) <= Radius &&
+			std::abs(offset.Z - centre.Z) <= Radius;
+	}
+
+	void ChunkPrefetcher::AddPosition(const Point3D & position, const double time) {
+		History.push_back({ position, time });
+		// Old positions no longer say much about where the player is heading
+		while (History.size() > MaxHistory ||
+				(History.size() > 2 && time - History.front().Time > HistoryWindow))
+			History.pop_front();
+		CurrentChunk = Params->ToGridCoordSpace(position).ChunkOffset;
+	}
+
+	void ChunkPrefetcher::SetViewDirection(const Vector3D<> & direction) {
+		ViewDirection = direction.Length2() > 0 ? direction.Normalize() : Vector3D<>(0);
+	}
+
+	Vector3D<> ChunkPrefetcher::EstimateVelocity() const {
+		if (History.size() < 2)
+			return Vector3D<>(0);
+
+		double meanTime = 0;
+		Vector3D<> meanPosition(0);
+		for (const auto & sample : History) {
+			meanTime += sample.Time;
+			meanPosition += sample.Position;
+		}
+		meanTime /= History.size();
+		meanPosition /= (double) History.size();
+
+		double timeVariance = 0;
+		Vector3D<> covariance(0);
+		for (const auto & sample : History) {
+			const double dt = sample.Time - meanTime;
+			timeVariance += dt * dt;
+			covariance += (sample.Position - meanPosition) * dt;
+		}
+		if (timeVariance <= 0)
+			return Vector3D<>(0);
+		return covariance * (1 / timeVariance);
+	}
+
+	void ChunkPrefetcher::Predict(
+		const std::function<bool (const ChunkOffsetVector &)> & isLoaded
+	) {
+		std::vector<ChunkOffsetVector> path;
+		std::unordered_set<ChunkOffsetVector> predicted;
+		const auto addAround = [&](const Point3D & point) {
+			const auto centre = Params->ToGridCoordSpace(point).ChunkOffset;
+			for (Int64 x = -Radius; x <= Radius; x++) {
+				for (Int64 y = -Radius; y <= Radius; y++) {
+					for (Int64 z = -Radius; z <= Radius; z++) {
+						const auto offset = centre + ChunkOffsetVector(x, y, z);
+						// The chunks in range are streamed in anyway
+						if (!IsInRange(offset, CurrentChunk) && predicted.insert(offset).second)
+							path.push_back(offset);
+					}
+				}
+			}
+		};
+
+		if (!History.empty()) {
+			const auto & position = History.back().Position;
+			const auto velocity = EstimateVelocity();
+			const double speed = velocity.Length();
+			if (speed > 0) {
+				// Half a chunk of travel per step, so that no chunk along the path is skipped
+				const double step =
+					std::max(Params->ChunkScale / 2 / speed, LookAhead / MaxPathSteps);
+				for (double t = step; t <= LookAhead; t += step)
+					addAround(position + velocity * t);
+			}
+			if (ViewDirection.Length2() > 0)
+				addAround(position + ViewDirection * Params->ChunkScale);
+		}
+
+		for (const auto & offset : Queue) {
+			if (predicted.count(offset) == 0)
+				Counters.Cancelled++;
+		}
+
+		// Reversed, so that the chunks the player reaches first come off the back
+		Queue.clear();
+		for (auto it = path.rbegin(); it != path.rend(); ++it) {
+			if (!IsPrefetched(*it) && !isLoaded(*it))
+				Queue.push_back(*it);
+		}
+		Predicted = std::move(predicted);
+	}
+
+	bool ChunkPrefetcher::NextPrefetch(
+		ChunkOffsetVector & offset,
+		const std::function<bool (const ChunkOffsetVector &)> & shouldLoad
+	) {
+		while (!Queue.empty()) {
+			offset = Queue.back();
+			Queue.pop_back();
+			if (!shouldLoad(offset))
+				continue;
+			Prefetched.insert(offset);
+			Counters.Issued++;
+			return true;
+		}
+		return false;
+	}
+
+	void ChunkPrefetcher::UpdateStreamedArea(const ChunkOffsetVector & centre) {
+		for (auto it = Prefetched.begin(); it != Prefetched.end(); ) {
+			if (IsInRange(*it, centre)) {
+				Counters.Hits++;
+				it = Prefetched.erase(it);
+			} else if (Predicted.count(*it) == 0) {
+				Counters.Wasted++;
+				it = Prefetched.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <Models/Terrain/TerrainDataStructures.h>
+#include <Utilities/Algebra/Algebra3D.h>
+
+#include <deque>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+namespace terrain {
+	struct ChunkPrefetchCounters {
+		Uint64 Issued;          // Chunks loaded ahead of the player
+		Uint64 Hits;            // Prefetched chunks that the player then came in range of
+		Uint64 Wasted;          // Prefetched chunks dropped without the player coming in range
+		Uint64 Cancelled;       // Predicted chunks dropped from the queue before being loaded
+
+		ChunkPrefetchCounters() : Issued(0), Hits(0), Wasted(0), Cancelled(0) {}
+
+		inline double GetHitRate() const {
+			return Hits + Wasted == 0 ? 0 : (double) Hits / (Hits + Wasted);
+		}
+	};
+
+	/**
+	 * Predicts the chunks the player will stream in next, so they can be loaded before the
+	 * player gets there. The velocity is estimated from the recent player positions and the
+	 * path is extrapolated from it, along with a step in the view direction, since players
+	 * tend to head where they look. The prefetcher only decides what to load. The caller
+	 * drains the queue at its own pace, and chunks still queued when the prediction changes
+	 * are cancelled.
+	 */
+	class ChunkPrefetcher {
+	private:
+		struct PositionSample {
+			utils::Point3D Position;
+			double Time;
+		};
+
+		const TerrainGeneratorParameters * Params;
+		const Int64 Radius;                              // Chunks streamed around the player
+		const double LookAhead;                          // Seconds of travel to predict
+
+		std::deque<PositionSample> History;
+		utils::Vector3D<> ViewDirection;
+		ChunkOffsetVector CurrentChunk;
+
+		std::vector<ChunkOffsetVector> Queue;            // Predicted chunks, nearest last
+		std::unordered_set<ChunkOffsetVector> Predicted;
+		std::unordered_set<ChunkOffsetVector> Prefetched;     // Loaded, not yet in range
+		ChunkPrefetchCounters Counters;
+
+		bool IsInRange(const ChunkOffsetVector & offset, const ChunkOffsetVector & centre) const;
+
+	public:
+		ChunkPrefetcher(
+			const TerrainGeneratorParameters * params,
+			const Int64 radius,
+			const double lookAhead
+		) : Params(params), Radius(radius), LookAhead(lookAhead), ViewDirection(0),
+			CurrentChunk(0)
+		{}
+
+		/**
+		 * @param time In seconds, increasing with every call.
+		 */
+		void AddPosition(const utils::Point3D & position, const double time);
+		void SetViewDirection(const utils::Vector3D<> & direction);
+
+		/**
+		 * @return Least squares estimate of the velocity over the recent positions, in real
+		 *         units per second.
+		 */
+		utils::Vector3D<> EstimateVelocity() const;
+
+		/**
+		 * Rebuilds the queue from the latest positions and view direction. Queued chunks that
+		 * are no longer predicted are cancelled.
+		 * @param isLoaded Chunks that are already loaded are left out of the queue.
+		 */
+		void Predict(const std::function<bool (const ChunkOffsetVector &)> & isLoaded);
+
+		/**
+		 * Takes the predicted chunk the player will reach first off the queue, and counts it
+		 * as prefetched.
+		 * @param shouldLoad Chunks it rejects are dropped from the queue without being counted.
+		 * @return False if the queue is empty.
+		 */
+		bool NextPrefetch(
+			ChunkOffsetVector & offset,
+			const std::function<bool (const ChunkOffsetVector &)> & shouldLoad);
+
+		/**
+		 * Settles the prefetched chunks once the streamed area has moved. Chunks that came in
+		 * range are hits, and chunks that are neither in range nor predicted any more are
+		 * wasted and may be unloaded.
+		 */
+		void UpdateStreamedArea(const ChunkOffsetVector & centre);
+
+		/**
+		 * @return True if the chunk was prefetched and should be kept loaded, even though it
+		 *         lies outside of the streamed area.
+		 */
+		inline bool IsPrefetched(const ChunkOffsetVector & offset) const {
+			return Prefetched.count(offset) > 0;
+		}
+
+		inline const ChunkPrefetchCounters & GetCounters() const { return Counters; }
+	};
+}
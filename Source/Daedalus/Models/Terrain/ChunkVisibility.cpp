@@ -0,0 +1,160 @@
+#include <Daedalus.h>
+#include "ChunkVisibility.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+namespace terrain {
+	using namespace utils;
+
+	ChunkOffsetVector FaceDirection(const ChunkFace face) {
+		const Int64 sign = (face & 1) ? 1 : -1;
+		switch (face >> 1) {
+		case 0: return ChunkOffsetVector(sign, 0, 0);
+		case 1: return ChunkOffsetVector(0, sign, 0);
+		default: return ChunkOffsetVector(0, 0, sign);
+		}
+	}
+
+	Uint8 ChunkConnectivity::PairIndex(const ChunkFace a, const ChunkFace b) {
+		const Uint8 lo = (Uint8) std::min(a, b);
+		const Uint8 hi = (Uint8) std::max(a, b);
+		// Pairs are numbered row by row through the upper triangle of the face matrix
+		return lo * (FACE_COUNT - 1) - lo * (lo - 1) / 2 + (hi - lo - 1);
+	}
+
+	ChunkConnectivity ChunkConnectivity::All() {
+		ChunkConnectivity connectivity;
+		connectivity.Pairs = (1 << 15) - 1;
+		return connectivity;
+	}
+
+	ChunkConnectivity ChunkConnectivity::FromOccupancy(const OccupancyGrid3D & solid) {
+		if (solid.IsEmpty())
+			return All();
+
+		ChunkConnectivity connectivity;
+		if (solid.IsFull())
+			return connectivity;
+
+		const Uint32 n = solid.GetSize();
+		const Uint32 last = n - 1;
+		std::vector<bool> visited(Uint64(n) * n * n, false);
+		std::vector<Vector3D<Uint32>> stack;
+
+		const auto indexOf = [n](const Uint32 x, const Uint32 y, const Uint32 z) {
+			return (Uint64(x) * n + y) * n + z;
+		};
+		const auto facesOf = [last](const Vector3D<Uint32> & cell) {
+			Uint8 faces = 0;
+			if (cell.X == 0) faces |= 1 << FACE_NEG_X;
+			if (cell.X == last) faces |= 1 << FACE_POS_X;
+			if (cell.Y == 0) faces |= 1 << FACE_NEG_Y;
+			if (cell.Y == last) faces |= 1 << FACE_POS_Y;
+			if (cell.Z == 0) faces |= 1 << FACE_NEG_Z;
+			if (cell.Z == last) faces |= 1 << FACE_POS_Z;
+			return faces;
+		};
+		const auto push = [&](const Uint32 x, const Uint32 y, const Uint32 z) {
+			const Uint64 index = indexOf(x, y, z);
+			if (!visited[index] && !solid.Get(x, y, z)) {
+				visited[index] = true;
+				stack.push_back(Vector3D<Uint32>(x, y, z));
+			}
+		};
+
+		for (Uint32 x = 0; x < n; x++) {
+			for (Uint32 y = 0; y < n; y++) {
+				for (Uint32 z = 0; z < n; z++) {
+					// Regions that don't reach a face can't connect anything, so only start fills
+					// from the boundary
+					if (facesOf(Vector3D<Uint32>(x, y, z)) == 0)
+						continue;
+					push(x, y, z);
+
+					Uint8 faces = 0;
+					while (!stack.empty()) {
+						const auto cell = stack.back();
+						stack.pop_back();
+						faces |= facesOf(cell);
+
+						if (cell.X > 0) push(cell.X - 1, cell.Y, cell.Z);
+						if (cell.X < last) push(cell.X + 1, cell.Y, cell.Z);
+						if (cell.Y > 0) push(cell.X, cell.Y - 1, cell.Z);
+						if (cell.Y < last) push(cell.X, cell.Y + 1, cell.Z);
+						if (cell.Z > 0) push(cell.X, cell.Y, cell.Z - 1);
+						if (cell.Z < last) push(cell.X, cell.Y, cell.Z + 1);
+					}
+
+					for (Uint8 a = 0; a < FACE_COUNT; a++) {
+						for (Uint8 b = a + 1; b < FACE_COUNT; b++) {
+							if ((faces >> a & 1) && (faces >> b & 1))
+								connectivity.Connect((ChunkFace) a, (ChunkFace) b);
+						}
+					}
+				}
+			}
+		}
+		return connectivity;
+	}
+
+	bool ChunkConnectivity::IsConnected(const ChunkFace a, const ChunkFace b) const {
+		if (a == b)
+			return true;
+		return (Pairs >> PairIndex(a, b) & 1) != 0;
+	}
+
+	void ChunkConnectivity::Connect(const ChunkFace a, const ChunkFace b) {
+		if (a != b)
+			Pairs |= 1 << PairIndex(a, b);
+	}
+
+	void FindVisibleChunks(
+		const ChunkOffsetVector & origin,
+		const Int64 maxDistance,
+		const ChunkConnectivityLookup & lookup,
+		std::unordered_set<ChunkOffsetVector> & visible
+	) {
+		struct Step {
+			ChunkOffsetVector Offset;
+			ChunkFace Entry;       // Face the chunk was entered through, FACE_COUNT at the origin
+			Uint8 Directions;      // Faces stepped out of so far, one bit per face
+		};
+
+		std::deque<Step> queue;
+		Step start = { origin, FACE_COUNT, 0 };
+		queue.push_back(start);
+		visible.insert(origin);
+
+		while (!queue.empty()) {
+			const Step step = queue.front();
+			queue.pop_front();
+			const ChunkConnectivity * connectivity = lookup(step.Offset);
+
+			for (Uint8 f = 0; f < FACE_COUNT; f++) {
+				const ChunkFace exit = (ChunkFace) f;
+				if (step.Directions & (1 << OppositeFace(exit)))
+					continue;
+				if (step.Entry != FACE_COUNT &&
+					(connectivity == NULL || !connectivity->IsConnected(step.Entry, exit)))
+					continue;
+
+				const ChunkOffsetVector next = step.Offset + FaceDirection(exit);
+				const ChunkOffsetVector distance = next - origin;
+				if (std::abs(distance.X) > maxDistance || std::abs(distance.Y) > maxDistance ||
+					std::abs(distance.Z) > maxDistance)
+					continue;
+
+				// Breadth first, so the first visit reaches the chunk along a shortest path
+				if (visible.count(next) > 0 || lookup(next) == NULL)
+					continue;
+
+				visible.insert(next);
+				Step following = { next, OppositeFace(exit), (Uint8) (step.Directions | 1 << f) };
+				queue.push_back(following);
+			}
+		}
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Models/Terrain/TerrainDataStructures.h>
+#include <Utilities/OccupancyGrid.h>
+
+#include <functional>
+#include <unordered_set>
+
+namespace terrain {
+	/**
+	 * The negative and the positive face of a chunk along each axis. A face and its opposite
+	 * only differ in the lowest bit.
+	 */
+	enum ChunkFace {
+		FACE_NEG_X,
+		FACE_POS_X,
+		FACE_NEG_Y,
+		FACE_POS_Y,
+		FACE_NEG_Z,
+		FACE_POS_Z,
+		FACE_COUNT
+	};
+
+	inline ChunkFace OppositeFace(const ChunkFace face) { return (ChunkFace) (face ^ 1); }
+
+	/**
+	 * @return Offset from a chunk to its neighbour across the given face.
+	 */
+	ChunkOffsetVector FaceDirection(const ChunkFace face);
+
+	/**
+	 * Records which pairs of faces of a chunk are connected through empty grid cells, that is
+	 * whether something looking in through one face could possibly see out through the
+	 * other. There are 15 pairs of distinct faces, each stored in a single bit.
+	 */
+	class ChunkConnectivity {
+	private:
+		Uint16 Pairs;
+
+		static Uint8 PairIndex(const ChunkFace a, const ChunkFace b);
+
+	public:
+		ChunkConnectivity() : Pairs(0) {}
+
+		/**
+		 * Every face connects to every other face, as in an empty chunk.
+		 */
+		static ChunkConnectivity All();
+
+		/**
+		 * Flood fills the empty cells of the grid from its faces. Every face touched by the
+		 * same empty region is connected to the others touched by it.
+		 */
+		static ChunkConnectivity FromOccupancy(const utils::OccupancyGrid3D & solid);
+
+		bool IsConnected(const ChunkFace a, const ChunkFace b) const;
+		void Connect(const ChunkFace a, const ChunkFace b);
+
+		inline Uint16 GetPairs() const { return Pairs; }
+	};
+
+	/**
+	 * @return The connectivity of a loaded chunk, or NULL if the chunk isn't loaded.
+	 */
+	using ChunkConnectivityLookup =
+		std::function<const ChunkConnectivity * (const ChunkOffsetVector & offset)>;
+
+	/**
+	 * Finds the chunks that could be visible from a camera in the origin chunk, walking
+	 * breadth first out from the origin. A chunk is only left through a face connected to
+	 * the face it was entered through, and the walk never steps back against a direction it
+	 * has already taken, so it can't wrap around walls. Chunks that aren't loaded end the
+	 * walk. This is conservative, a visible chunk is never left out.
+	 * @param maxDistance Chunks further from the origin than this along any axis are skipped.
+	 * @param visible Receives the offsets of the visible chunks, including the origin.
+	 */
+	void FindVisibleChunks(
+		const ChunkOffsetVector & origin,
+		const Int64 maxDistance,
+		const ChunkConnectivityLookup & lookup,
+		std::unordered_set<ChunkOffsetVector> & visible);
+}
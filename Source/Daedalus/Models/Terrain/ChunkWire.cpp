@@ -0,0 +1,371 @@
+#include <Daedalus.h>
+#include "ChunkWire.h"
+
+#include <Utilities/Compression.h>
+
+#include <unordered_map>
+
+namespace terrain {
+	using namespace utils;
+
+	namespace {
+		enum FieldEncoding {
+			F_Runs,                 // Palette of values and runs of palette indices
+			F_Raw                   // Every value in order
+		};
+
+		// Upper bounds on sizes read from messages, so corrupt ones can't exhaust memory
+		const Uint64 MaxPayloadSize = 64 << 20;
+		const Uint64 MaxCellCount = 256;
+
+		/*
+		 Palette and run length encodes a field visited in x, y, z order. Runs are only used
+		 while they take fewer bytes than the raw values, roughly.
+		 */
+		template <typename T, typename Get, typename Write>
+		void EncodeField(
+			ByteWriter & writer,
+			const Uint32 n,
+			const Get & get,
+			const Write & write
+		) {
+			std::vector<T> palette;
+			std::unordered_map<T, Uint32> paletteIndices;
+			std::vector<std::pair<Uint32, Uint32>> runs;     // Palette index and length
+			std::vector<T> values;
+			values.reserve(n * n * n);
+
+			for (Uint32 x = 0; x < n; x++) {
+				for (Uint32 y = 0; y < n; y++) {
+					for (Uint32 z = 0; z < n; z++) {
+						const T value = get(x, y, z);
+						values.push_back(value);
+						if (!runs.empty() && palette[runs.back().first] == value) {
+							runs.back().second++;
+							continue;
+						}
+
+						const auto found = paletteIndices.find(value);
+						Uint32 index;
+						if (found == paletteIndices.end()) {
+							index = (Uint32) palette.size();
+							paletteIndices.insert({ value, index });
+							palette.push_back(value);
+						} else {
+							index = found->second;
+						}
+						runs.push_back({ index, 1 });
+					}
+				}
+			}
+
+			if (runs.size() * 2 > values.size()) {
+				writer.WriteByte(F_Raw);
+				for (const auto & value : values)
+					write(writer, value);
+				return;
+			}
+
+			writer.WriteByte(F_Runs);
+			writer.WriteVarint(palette.size());
+			for (const auto & value : palette)
+				write(writer, value);
+			writer.WriteVarint(runs.size());
+			for (const auto & run : runs) {
+				writer.WriteVarint(run.first);
+				writer.WriteVarint(run.second - 1);
+			}
+		}
+
+		template <typename T, typename Set, typename Read>
+		void DecodeField(ByteReader & reader, const Uint32 n, const Set & set, const Read & read) {
+			const Uint64 count = (Uint64) n * n * n;
+			Uint64 i = 0;
+			const auto setNext = [&](const T value) {
+				set((Uint32) (i / (n * n)), (Uint32) (i / n % n), (Uint32) (i % n), value);
+				i++;
+			};
+
+			const Uint8 encoding = reader.ReadByte();
+			if (encoding == F_Raw) {
+				while (i < count)
+					setNext(read(reader));
+				return;
+			}
+			if (encoding != F_Runs)
+				throw StringException("DecodeChunkMessage: Unknown field encoding");
+
+			const Uint64 paletteSize = reader.ReadVarint();
+			if (paletteSize > count)
+				throw StringException("DecodeChunkMessage: Palette is larger than the field");
+			std::vector<T> palette;
+			for (Uint64 p = 0; p < paletteSize; p++)
+				palette.push_back(read(reader));
+
+			const Uint64 runCount = reader.ReadVarint();
+			for (Uint64 r = 0; r < runCount; r++) {
+				const Uint64 index = reader.ReadVarint();
+				const Uint64 length = reader.ReadVarint() + 1;
+				if (index >= palette.size() || length > count - i)
+					throw StringException("DecodeChunkMessage: Run lies outside of the field");
+				for (Uint64 j = 0; j < length; j++)
+					setNext(palette[index]);
+			}
+			if (i != count)
+				throw StringException("DecodeChunkMessage: Runs don't cover the field");
+		}
+
+		void WriteOffset(ByteWriter & writer, const ChunkOffsetVector & offset) {
+			for (Uint8 a = 0; a < 3; a++)
+				writer.WriteSignedVarint(offset[a]);
+		}
+
+		ChunkOffsetVector ReadOffset(ByteReader & reader) {
+			ChunkOffsetVector offset;
+			for (Uint8 a = 0; a < 3; a++)
+				offset[a] = reader.ReadSignedVarint();
+			return offset;
+		}
+
+		void WriteItems(ByteWriter & writer, const std::vector<ChunkDelta::PlacedItem> & items) {
+			writer.WriteVarint(items.size());
+			for (const auto & item : items) {
+				writer.WriteVarint(item.ItemId);
+				writer.WriteVarint(item.Type);
+				for (Uint8 a = 0; a < 3; a++)
+					writer.WriteDouble(item.Position[a]);
+				writer.WriteByte(item.Yaw);
+				writer.WriteByte(item.Pitch);
+			}
+		}
+
+		void ReadItems(ByteReader & reader, std::vector<ChunkDelta::PlacedItem> & items) {
+			const Uint64 count = reader.ReadVarint();
+			for (Uint64 i = 0; i < count; i++) {
+				ChunkDelta::PlacedItem item;
+				item.ItemId = reader.ReadVarint();
+				item.Type = (items::ItemType) reader.ReadVarint();
+				for (Uint8 a = 0; a < 3; a++)
+					item.Position[a] = reader.ReadDouble();
+				item.Yaw = reader.ReadByte();
+				item.Pitch = reader.ReadByte();
+				items.push_back(item);
+			}
+		}
+
+		void FrameMessage(
+			const ChunkMessageType type,
+			const std::vector<Uint8> & payload,
+			std::vector<Uint8> & message
+		) {
+			ByteWriter writer(message);
+			writer.WriteByte((Uint8) type);
+			writer.WriteVarint(payload.size());
+			LzCompress(payload.data(), payload.size(), message);
+		}
+	}
+
+	void EncodeChunkSnapshot(const ChunkData & data, std::vector<Uint8> & message) {
+		std::vector<Uint8> payload;
+		ByteWriter writer(payload);
+		const Uint32 n = data.ChunkFieldSize;
+		WriteOffset(writer, data.ChunkOffset);
+		writer.WriteVarint(data.Version);
+		writer.WriteVarint(n);
+
+		const auto & density = *data.DensityData;
+		EncodeField<float>(writer, n,
+			[&density](Uint32 x, Uint32 y, Uint32 z) { return density.Get(x, y, z); },
+			[](ByteWriter & w, float value) { w.WriteFloat(value); });
+		const auto & materials = *data.MaterialData;
+		EncodeField<Uint64>(writer, n,
+			[&materials](Uint32 x, Uint32 y, Uint32 z) { return materials.Get(x, y, z); },
+			[](ByteWriter & w, Uint64 value) { w.WriteVarint(value); });
+
+		std::vector<ChunkDelta::PlacedItem> items;
+		RecordPlacedItems(data.PlacedItems, items);
+		WriteItems(writer, items);
+
+		FrameMessage(M_ChunkSnapshot, payload, message);
+	}
+
+	void EncodeChunkEdit(
+		const ChunkDelta & edit,
+		const Uint64 version,
+		std::vector<Uint8> & message
+	) {
+		std::vector<Uint8> payload;
+		ByteWriter writer(payload);
+		WriteOffset(writer, edit.ChunkOffset);
+		writer.WriteVarint(version);
+
+		// The samples are sorted, so the gaps between their indices stay small
+		writer.WriteVarint(edit.Samples.size());
+		Uint32 previous = 0;
+		for (const auto & sample : edit.Samples) {
+			writer.WriteVarint(sample.Index - previous);
+			writer.WriteFloat(sample.Density);
+			writer.WriteVarint(sample.Material);
+			previous = sample.Index;
+		}
+		WriteItems(writer, edit.Items);
+
+		FrameMessage(M_ChunkEdit, payload, message);
+	}
+
+	ChunkMessage DecodeChunkMessage(
+		const std::vector<Uint8> & message,
+		const items::ItemDataFactory & factory
+	) {
+		ByteReader frame(message.data(), message.size());
+		ChunkMessage decoded;
+		const Uint8 type = frame.ReadByte();
+		if (type != M_ChunkSnapshot && type != M_ChunkEdit)
+			throw StringException("DecodeChunkMessage: Unknown message type");
+		decoded.Type = (ChunkMessageType) type;
+
+		const Uint64 payloadSize = frame.ReadVarint();
+		if (payloadSize > MaxPayloadSize)
+			throw StringException("DecodeChunkMessage: Payload is too large");
+		std::vector<Uint8> payload;
+		const Uint64 compressedSize = frame.GetRemaining();
+		LzDecompress(frame.ReadBytes(compressedSize), compressedSize, payloadSize, payload);
+
+		ByteReader reader(payload.data(), payload.size());
+		const auto offset = ReadOffset(reader);
+		decoded.Version = reader.ReadVarint();
+
+		if (decoded.Type == M_ChunkEdit) {
+			decoded.Edit.ChunkOffset = offset;
+			const Uint64 count = reader.ReadVarint();
+			Uint64 index = 0;
+			for (Uint64 s = 0; s < count; s++) {
+				index += reader.ReadVarint();
+				ChunkDelta::Sample sample;
+				sample.Index = (Uint32) index;
+				sample.Density = reader.ReadFloat();
+				sample.Material = reader.ReadVarint();
+				decoded.Edit.Samples.push_back(sample);
+			}
+			ReadItems(reader, decoded.Edit.Items);
+			return decoded;
+		}
+
+		const Uint64 n = reader.ReadVarint();
+		if (n == 0 || n > MaxCellCount)
+			throw StringException("DecodeChunkMessage: Chunk size is out of range");
+		decoded.Chunk = ChunkDataPtr(new ChunkData((Uint32) n, offset));
+		auto & data = *decoded.Chunk;
+		data.Version = decoded.Version;
+
+		auto & density = data.DensityData.Mutable();
+		DecodeField<float>(reader, (Uint32) n,
+			[&density](Uint32 x, Uint32 y, Uint32 z, float value) { density.Set(x, y, z, value); },
+			[](ByteReader & r) { return r.ReadFloat(); });
+		auto & materials = data.MaterialData.Mutable();
+		DecodeField<Uint64>(reader, (Uint32) n,
+			[&materials](Uint32 x, Uint32 y, Uint32 z, Uint64 value) {
+				materials.Set(x, y, z, value);
+			},
+			[](ByteReader & r) { return r.ReadVarint(); });
+
+		ChunkDelta items(offset);
+		ReadItems(reader, items.Items);
+		ApplyChunkDelta(items, factory, data);
+		return decoded;
+	}
+
+	ChunkDelta CaptureChunkEdit(const ChunkData & data, const ChunkCellRange & changedSamples) {
+		ChunkDelta edit(data.ChunkOffset);
+		const auto range = changedSamples.Intersect(ChunkCellRange::All(data.ChunkFieldSize));
+		const Int64 n = data.ChunkFieldSize;
+		for (Int64 x = range.Min.X; x <= range.Max.X; x++) {
+			for (Int64 y = range.Min.Y; y <= range.Max.Y; y++) {
+				for (Int64 z = range.Min.Z; z <= range.Max.Z; z++) {
+					const Uint32 ux = (Uint32) x, uy = (Uint32) y, uz = (Uint32) z;
+					const ChunkDelta::Sample sample = {
+						(Uint32) ((x * n + y) * n + z),
+						data.DensityData->Get(ux, uy, uz),
+						data.MaterialData->Get(ux, uy, uz)
+					};
+					edit.Samples.push_back(sample);
+				}
+			}
+		}
+		RecordPlacedItems(data.PlacedItems, edit.Items);
+		return edit;
+	}
+
+	bool ApplyChunkEdit(
+		const ChunkDelta & edit,
+		const Uint64 version,
+		const items::ItemDataFactory & factory,
+		ChunkData & data
+	) {
+		if (version != data.Version + 1)
+			return false;
+		data.PlacedItems.clear();
+		ApplyChunkDelta(edit, factory, data);
+		data.Version = version;
+		return true;
+	}
+
+	std::pair<LoopbackTransport::LoopbackTransportPtr, LoopbackTransport::LoopbackTransportPtr>
+	LoopbackTransport::CreatePair() {
+		std::shared_ptr<Channel> channel(new Channel());
+		return std::make_pair(
+			LoopbackTransportPtr(new LoopbackTransport(channel, 0)),
+			LoopbackTransportPtr(new LoopbackTransport(channel, 1)));
+	}
+
+	void LoopbackTransport::Send(const std::vector<Uint8> & message) {
+		std::lock_guard<std::mutex> guard(Shared->Lock);
+		Shared->Messages[1 - Side].push_back(message);
+		BytesSent += message.size();
+	}
+
+	bool LoopbackTransport::Receive(std::vector<Uint8> & message) {
+		std::lock_guard<std::mutex> guard(Shared->Lock);
+		auto & waiting = Shared->Messages[Side];
+		if (waiting.empty())
+			return false;
+		message = std::move(waiting.front());
+		waiting.pop_front();
+		return true;
+	}
+
+	void ChunkReplica::Receive(
+		ChunkTransport & transport,
+		std::vector<ChunkOffsetVector> & changed,
+		std::vector<ChunkOffsetVector> & resync
+	) {
+		std::vector<Uint8> message;
+		while (transport.Receive(message)) {
+			auto decoded = DecodeChunkMessage(message, Factory);
+			if (decoded.Type == M_ChunkSnapshot) {
+				const auto offset = decoded.Chunk->ChunkOffset;
+				Chunks[offset] = decoded.Chunk;
+				changed.push_back(offset);
+				continue;
+			}
+
+			const auto found = Chunks.find(decoded.Edit.ChunkOffset);
+			if (found == Chunks.end())
+				continue;
+			if (ApplyChunkEdit(decoded.Edit, decoded.Version, Factory, *found->second)) {
+				changed.push_back(found->first);
+			} else if (decoded.Version > found->second->Version) {
+				// An edit in between went missing, so the copy can't catch up on its own
+				resync.push_back(found->first);
+				Chunks.erase(found);
+			}
+		}
+	}
+
+	ChunkDataPtr ChunkReplica::FindChunk(const ChunkOffsetVector & offset) const {
+		const auto found = Chunks.find(offset);
+		if (found == Chunks.end())
+			return NULL;
+		return found->second;
+	}
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <Models/Items/ItemDataFactory.h>
+#include <Models/Terrain/ChunkData.h>
+#include <Models/Terrain/ChunkDelta.h>
+#include <Models/Terrain/TerrainDataStructures.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace terrain {
+	enum ChunkMessageType {
+		M_ChunkSnapshot,        // The whole chunk
+		M_ChunkEdit             // Changed samples of a chunk the receiver already holds
+	};
+
+	/**
+	 * A decoded chunk message. Edits carry every item of the chunk along with the changed
+	 * samples, since items are few and the receiver can then simply replace its own.
+	 */
+	struct ChunkMessage {
+		ChunkMessageType Type;
+		Uint64 Version;             // Version of the chunk on the sender
+		ChunkDataPtr Chunk;         // Only set for snapshots
+		ChunkDelta Edit;            // Only set for edits
+
+		ChunkMessage() : Type(M_ChunkSnapshot), Version(0), Chunk(NULL) {}
+	};
+
+	/*
+	 Messages are framed as the type, the size of the payload, and the payload compressed
+	 with LzCompress. The density and material fields of snapshots are palette and run length
+	 encoded in x, y, z order before compression, which turns uniform and layered chunks into
+	 a handful of runs. Fields too noisy for runs are sent raw and left to the compressor.
+	 */
+
+	void EncodeChunkSnapshot(const ChunkData & data, std::vector<Uint8> & message);
+
+	void EncodeChunkEdit(
+		const ChunkDelta & edit,
+		const Uint64 version,
+		std::vector<Uint8> & message);
+
+	/**
+	 * Throws a StringException if the message is corrupt.
+	 * @param factory Rebuilds the items of the chunk.
+	 */
+	ChunkMessage DecodeChunkMessage(
+		const std::vector<Uint8> & message,
+		const items::ItemDataFactory & factory);
+
+	/**
+	 * Collects the samples within the range changed by an edit, which is what the receiver
+	 * needs to follow the edit, along with every item of the chunk.
+	 */
+	ChunkDelta CaptureChunkEdit(const ChunkData & data, const ChunkCellRange & changedSamples);
+
+	/**
+	 * Applies an edit to the receiver's copy of the chunk, replacing its items and taking on
+	 * the sender's version.
+	 * @param version Version of the chunk on the sender, after the edit.
+	 * @return False if the edit doesn't directly follow the copy's version, in which case the
+	 *         copy is left unchanged.
+	 */
+	bool ApplyChunkEdit(
+		const ChunkDelta & edit,
+		const Uint64 version,
+		const items::ItemDataFactory & factory,
+		ChunkData & data);
+
+	/**
+	 * Carries encoded chunk messages from the chunk loader to the chunk manager, which may
+	 * live in different processes.
+	 */
+	class ChunkTransport {
+	public:
+		virtual ~ChunkTransport() {}
+
+		virtual void Send(const std::vector<Uint8> & message) = 0;
+		/**
+		 * @return False if no message is waiting.
+		 */
+		virtual bool Receive(std::vector<Uint8> & message) = 0;
+	};
+
+	/**
+	 * One end of an in-memory transport, messages sent from one end are received at the
+	 * other. The ends may be used from different threads.
+	 */
+	class LoopbackTransport : public ChunkTransport {
+	public:
+		using LoopbackTransportPtr = std::shared_ptr<LoopbackTransport>;
+
+	private:
+		struct Channel {
+			std::mutex Lock;
+			std::deque<std::vector<Uint8>> Messages[2];     // Waiting to be received by each end
+		};
+
+		std::shared_ptr<Channel> Shared;
+		Uint32 Side;
+		Uint64 BytesSent;
+
+		LoopbackTransport(const std::shared_ptr<Channel> & channel, const Uint32 side) :
+			Shared(channel), Side(side), BytesSent(0) {}
+
+	public:
+		static std::pair<LoopbackTransportPtr, LoopbackTransportPtr> CreatePair();
+
+		virtual void Send(const std::vector<Uint8> & message) override;
+		virtual bool Receive(std::vector<Uint8> & message) override;
+
+		inline Uint64 GetBytesSent() const { return BytesSent; }
+	};
+
+	/**
+	 * The receiving end's copy of the chunks, built from the messages of a transport.
+	 */
+	class ChunkReplica {
+	private:
+		std::unordered_map<ChunkOffsetVector, ChunkDataPtr> Chunks;
+		const items::ItemDataFactory & Factory;
+
+	public:
+		ChunkReplica(const items::ItemDataFactory & factory) : Factory(factory) {}
+
+		/**
+		 * Applies every waiting message. Edits to chunks without a snapshot are dropped, as
+		 * are edits the copy has already seen.
+		 * @param changed Receives the offset of every chunk that changed.
+		 * @param resync Receives the offset of every chunk that missed an edit. The chunk is
+		 *               dropped until the sender sends a new snapshot of it.
+		 */
+		void Receive(
+			ChunkTransport & transport,
+			std::vector<ChunkOffsetVector> & changed,
+			std::vector<ChunkOffsetVector> & resync);
+
+		ChunkDataPtr FindChunk(const ChunkOffsetVector & offset) const;
+	};
+}
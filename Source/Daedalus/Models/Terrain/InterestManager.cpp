@@ -0,0 +1,175 @@
+#include <Daedalus.h>
+#include "InterestManager.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace terrain {
+	using namespace utils;
+
+	namespace {
+		inline bool IsInCube(
+			const ChunkOffsetVector & offset,
+			const ChunkOffsetVector & centre,
+			const Int64 radius
+		) {
+			return std::abs(offset.X - centre.X) <= radius &&
+				std::abs(offset.Y - centre.Y) <= radius && std::abs(offset.Z - centre.Z) <= radius;
+		}
+
+		template <typename Fn>
+		void ForEachInCube(const ChunkOffsetVector & centre, const Int64 radius, Fn fn) {
+			for (Int64 x = centre.X - radius; x <= centre.X + radius; x++) {
+				for (Int64 y = centre.Y - radius; y <= centre.Y + radius; y++) {
+					for (Int64 z = centre.Z - radius; z <= centre.Z + radius; z++)
+						fn(ChunkOffsetVector(x, y, z));
+				}
+			}
+		}
+
+		struct LoadOrder {
+			Uint32 Priority;
+			Int64 Distance2;
+			ChunkOffsetVector Offset;
+		};
+	}
+
+	void InterestManager::Acquire(const Observer & observer, const Observer * ignored) {
+		ForEachInCube(observer.Centre, observer.Radius, [&] (const ChunkOffsetVector & offset) {
+			if (ignored != NULL && IsInCube(offset, ignored->Centre, ignored->Radius))
+				return;
+			auto & residency = Resident.insert({ offset, Residency{ 0, false } }).first->second;
+			if (residency.RefCount++ == 0)
+				PendingLoads.push_back(offset);
+		});
+	}
+
+	void InterestManager::Release(
+		const Observer & observer,
+		const Observer * ignored,
+		InterestChanges & changes
+	) {
+		ForEachInCube(observer.Centre, observer.Radius, [&] (const ChunkOffsetVector & offset) {
+			if (ignored != NULL && IsInCube(offset, ignored->Centre, ignored->Radius))
+				return;
+			const auto found = Resident.find(offset);
+			if (found == Resident.end() || --found->second.RefCount > 0)
+				return;
+			// Chunks that were never taken are dropped from the pending list by TakeLoads
+			changes.Unloaded.push_back(offset);
+			Resident.erase(found);
+		});
+	}
+
+	InterestManager::Observer & InterestManager::FindObserver(const ObserverId id) {
+		const auto found = Observers.find(id);
+		if (found == Observers.end())
+			throw StringException("InterestManager::FindObserver: Unknown observer");
+		return found->second;
+	}
+
+	void InterestManager::AddObserver(
+		const ObserverId id,
+		const ChunkOffsetVector & centre,
+		const Int64 radius,
+		const Uint32 priority
+	) {
+		if (HasObserver(id))
+			throw StringException("InterestManager::AddObserver: Observer was already added");
+		const Observer observer = { centre, radius, priority };
+		Observers.insert({ id, observer });
+		Acquire(observer, NULL);
+	}
+
+	void InterestManager::RemoveObserver(const ObserverId id, InterestChanges & changes) {
+		const Observer observer = FindObserver(id);
+		Observers.erase(id);
+		Release(observer, NULL, changes);
+	}
+
+	void InterestManager::MoveObserver(
+		const ObserverId id,
+		const ChunkOffsetVector & centre,
+		InterestChanges & changes
+	) {
+		auto & observer = FindObserver(id);
+		if (observer.Centre == centre)
+			return;
+
+		const Observer previous = observer;
+		observer.Centre = centre;
+		// Acquired before releasing, so chunks shared with other observers never drop to zero
+		Acquire(observer, &previous);
+		Release(previous, &observer, changes);
+	}
+
+	void InterestManager::SetObserverRadius(
+		const ObserverId id,
+		const Int64 radius,
+		InterestChanges & changes
+	) {
+		auto & observer = FindObserver(id);
+		const Observer previous = observer;
+		observer.Radius = radius;
+		Acquire(observer, &previous);
+		Release(previous, &observer, changes);
+	}
+
+	bool InterestManager::HasObserver(const ObserverId id) const {
+		return Observers.find(id) != Observers.end();
+	}
+
+	void InterestManager::TakeLoads(const Uint32 maxCount, std::vector<ChunkOffsetVector> & loads) {
+		std::vector<LoadOrder> order;
+		order.reserve(PendingLoads.size());
+		for (const auto & offset : PendingLoads) {
+			// Skip chunks released or taken since they were queued
+			const auto found = Resident.find(offset);
+			if (found == Resident.end() || found->second.bTaken)
+				continue;
+
+			LoadOrder entry = { 0, -1, offset };
+			for (const auto & observer : Observers) {
+				const auto & o = observer.second;
+				if (!IsInCube(offset, o.Centre, o.Radius))
+					continue;
+				const auto d = offset - o.Centre;
+				const Int64 distance2 = d.X * d.X + d.Y * d.Y + d.Z * d.Z;
+				if (entry.Distance2 < 0 || o.Priority > entry.Priority ||
+						(o.Priority == entry.Priority && distance2 < entry.Distance2)) {
+					entry.Priority = o.Priority;
+					entry.Distance2 = distance2;
+				}
+			}
+			order.push_back(entry);
+		}
+
+		// Sorted worst first, so the chunks to load can be popped off the back
+		std::sort(order.begin(), order.end(), [] (const LoadOrder & a, const LoadOrder & b) {
+			return a.Priority != b.Priority ? a.Priority < b.Priority : a.Distance2 > b.Distance2;
+		});
+
+		Uint32 taken = 0;
+		while (taken < maxCount && !order.empty()) {
+			auto & residency = Resident.at(order.back().Offset);
+			// A chunk queued twice is only loaded once
+			if (!residency.bTaken) {
+				residency.bTaken = true;
+				loads.push_back(order.back().Offset);
+				taken++;
+			}
+			order.pop_back();
+		}
+
+		PendingLoads.clear();
+		for (const auto & entry : order) {
+			if (!Resident.at(entry.Offset).bTaken)
+				PendingLoads.push_back(entry.Offset);
+		}
+	}
+
+	Uint32 InterestManager::GetRefCount(const ChunkOffsetVector & offset) const {
+		const auto found = Resident.find(offset);
+		return found == Resident.end() ? 0 : found->second.RefCount;
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <Models/Terrain/TerrainDataStructures.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace terrain {
+	using ObserverId = Uint64;
+
+	/**
+	 * Chunks that no observer needs any more. They are reported whether or not they were
+	 * handed out by TakeLoads, since the caller may have loaded them by other means.
+	 */
+	struct InterestChanges {
+		std::vector<ChunkOffsetVector> Unloaded;
+	};
+
+	/**
+	 * Tracks which chunks have to be resident for a set of observers, each with its own
+	 * position, radius and priority. Every chunk within range of an observer holds a
+	 * reference, so chunks shared by several observers are loaded once and only unloaded
+	 * when the last observer leaves them. The manager never loads anything itself, it keeps
+	 * a queue of chunks to load and reports the chunks to unload.
+	 */
+	class InterestManager {
+	private:
+		struct Observer {
+			ChunkOffsetVector Centre;
+			Int64 Radius;
+			Uint32 Priority;                     // Higher priorities are loaded first
+		};
+
+		struct Residency {
+			Uint32 RefCount;
+			bool bTaken;                         // Handed out by TakeLoads
+		};
+
+		std::unordered_map<ObserverId, Observer> Observers;
+		std::unordered_map<ChunkOffsetVector, Residency> Resident;
+		std::vector<ChunkOffsetVector> PendingLoads;
+
+		/*
+		 Acquires the chunks in the cube of the observer, leaving out the ones also in the
+		 cube of the ignored observer. This makes moving an observer cost the chunks on the
+		 edge of the cubes, rather than the whole cube.
+		 */
+		void Acquire(const Observer & observer, const Observer * ignored);
+		void Release(
+			const Observer & observer,
+			const Observer * ignored,
+			InterestChanges & changes);
+
+		Observer & FindObserver(const ObserverId id);
+
+	public:
+		/**
+		 * @param radius Chunks in the cube of this radius around the centre are kept
+		 *               resident. Meshing a chunk needs its neighbours, so observers that mesh
+		 *               should ask for one chunk more than they render.
+		 */
+		void AddObserver(
+			const ObserverId id,
+			const ChunkOffsetVector & centre,
+			const Int64 radius,
+			const Uint32 priority);
+		void RemoveObserver(const ObserverId id, InterestChanges & changes);
+		void MoveObserver(
+			const ObserverId id,
+			const ChunkOffsetVector & centre,
+			InterestChanges & changes);
+		void SetObserverRadius(const ObserverId id, const Int64 radius, InterestChanges & changes);
+
+		bool HasObserver(const ObserverId id) const;
+
+		/**
+		 * Takes at most maxCount of the chunks waiting to be loaded. The chunks wanted by the
+		 * highest priority observer come first, and chunks nearer to it come before the
+		 * chunks further away.
+		 */
+		void TakeLoads(const Uint32 maxCount, std::vector<ChunkOffsetVector> & loads);
+
+		/**
+		 * @return Number of observers the chunk is in range of.
+		 */
+		Uint32 GetRefCount(const ChunkOffsetVector & offset) const;
+		inline bool IsResident(const ChunkOffsetVector & offset) const {
+			return GetRefCount(offset) > 0;
+		}
+		inline Uint64 GetResidentCount() const { return Resident.size(); }
+		inline Uint64 GetPendingCount() const { return PendingLoads.size(); }
+	};
+}
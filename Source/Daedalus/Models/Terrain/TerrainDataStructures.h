@@ -3,6 +3,8 @@
 #include <Utilities/Algebra/Algebra2D.h>
 #include <Utilities/Algebra/Algebra3D.h>
 
+#include <algorithm>
+
 namespace terrain {
 	using ChunkOffsetVector = utils::Vector3D<Int64>;       // Offset vector for entire chunk
 	using ChunkGridIndexVector = utils::Vector3D<Uint16>;   // Index vector within the chunk grid
@@ -19,6 +21,56 @@ namespace terrain {
 		{}
 	};
 
+	/**
+	 * An inclusive box of grid cells, or of density samples, within a chunk. Ranges may
+	 * reach outside the chunk until they are clamped. The default range is empty.
+	 */
+	struct ChunkCellRange {
+		utils::Vector3D<Int64> Min;
+		utils::Vector3D<Int64> Max;
+
+		ChunkCellRange() : Min(1), Max(0) {}
+		ChunkCellRange(const utils::Vector3D<Int64> & min, const utils::Vector3D<Int64> & max)
+			: Min(min), Max(max)
+		{}
+
+		/**
+		 * @return Every cell of a chunk with the given number of cells along an edge.
+		 */
+		static ChunkCellRange All(const Uint32 cellCount) {
+			return ChunkCellRange(utils::Vector3D<Int64>(0), utils::Vector3D<Int64>(cellCount - 1));
+		}
+
+		inline bool IsEmpty() const {
+			return Min.X > Max.X || Min.Y > Max.Y || Min.Z > Max.Z;
+		}
+
+		/**
+		 * Grows the range to the smallest box holding both ranges.
+		 */
+		void Include(const ChunkCellRange & other) {
+			if (other.IsEmpty())
+				return;
+			if (IsEmpty()) {
+				*this = other;
+				return;
+			}
+			for (Uint8 i = 0; i < 3; i++) {
+				Min[i] = std::min(Min[i], other.Min[i]);
+				Max[i] = std::max(Max[i], other.Max[i]);
+			}
+		}
+
+		ChunkCellRange Intersect(const ChunkCellRange & other) const {
+			ChunkCellRange result;
+			for (Uint8 i = 0; i < 3; i++) {
+				result.Min[i] = std::max(Min[i], other.Min[i]);
+				result.Max[i] = std::min(Max[i], other.Max[i]);
+			}
+			return result;
+		}
+	};
+
 	struct TerrainGeneratorParameters {
 		const Uint16 GridCellCount;       // Number of grid cells along a single edge of the cube
 		const Int64 Seed;
@@ -112,6 +164,41 @@ namespace terrain {
 		}
 	};
 
+	enum ChunkBand {
+		E_Sky,              // The chunk and its neighbours lie entirely above the surface
+		E_Surface,          // The chunk or one of its neighbours may hold part of the surface
+		E_Buried            // The chunk and its neighbours lie entirely below the surface
+	};
+
+	/**
+	 * Bounds of the generated surface height over a column of chunks and the 8 columns
+	 * around it. Chunks of the column outside of the band are uniform along with all of
+	 * their neighbours, so they produce no mesh.
+	 */
+	struct ChunkColumnSummary {
+		Int64 MinHeight;
+		Int64 MaxHeight;
+
+		ChunkColumnSummary(const Int64 height) : MinHeight(height), MaxHeight(height) {}
+
+		inline void Include(const Int64 height) {
+			MinHeight = std::min(MinHeight, height);
+			MaxHeight = std::max(MaxHeight, height);
+		}
+
+		/**
+		 * @param chunkHeight Size of a chunk in centimetres, truncated like the generator does.
+		 */
+		inline ChunkBand Classify(const Int64 z, const Int64 chunkHeight) const {
+			// The generator's tests for empty and solid chunks, applied to the neighbours
+			if ((z - 1) * chunkHeight > MaxHeight)
+				return E_Sky;
+			if ((z + 2) * chunkHeight < MinHeight)
+				return E_Buried;
+			return E_Surface;
+		}
+	};
+
 
 	using BiomeRegionOffsetVector = utils::Vector2D<Int64>;      // Offset vector for biome regions
 	using BiomeRegionGridIndexVector = utils::Vector2D<Uint16>;  // Index vector within a region
@@ -0,0 +1,130 @@
+#include <Daedalus.h>
+#include "TerrainEditing.h"
+
+#include <cmath>
+
+namespace terrain {
+	using namespace utils;
+
+	bool TerrainEdit::Contains(const Vector3D<> & offset) const {
+		if (Shape == E_Box) {
+			return std::abs(offset.X) <= Extent.X && std::abs(offset.Y) <= Extent.Y &&
+				std::abs(offset.Z) <= Extent.Z;
+		}
+
+		if (Extent.X <= 0 || Extent.Y <= 0 || Extent.Z <= 0)
+			return false;
+		const double x = offset.X / Extent.X;
+		const double y = offset.Y / Extent.Y;
+		const double z = offset.Z / Extent.Z;
+		return x * x + y * y + z * z <= 1;
+	}
+
+	void FindEditedChunks(
+		const TerrainEdit & edit,
+		const Uint32 cellCount,
+		std::vector<ChunkOffsetVector> & offsets
+	) {
+		const double n = cellCount;
+		Vector3D<Int64> from, to;
+		for (Uint8 i = 0; i < 3; i++) {
+			const double centre = edit.Centre.ChunkOffset[i] * n + edit.Centre.InnerOffset[i];
+			from[i] = (Int64) std::floor((centre - edit.Extent[i]) / n);
+			to[i] = (Int64) std::floor((centre + edit.Extent[i]) / n);
+		}
+
+		for (Int64 x = from.X; x <= to.X; x++) {
+			for (Int64 y = from.Y; y <= to.Y; y++) {
+				for (Int64 z = from.Z; z <= to.Z; z++)
+					offsets.push_back(ChunkOffsetVector(x, y, z));
+			}
+		}
+	}
+
+	bool ApplyTerrainEdit(const TerrainEdit & edit, ChunkData & data, ChunkCellRange & changed) {
+		const Int64 n = data.ChunkFieldSize;
+		// Position of the first sample of the chunk relative to the centre of the brush
+		const Vector3D<> origin(
+			(data.ChunkOffset.X - edit.Centre.ChunkOffset.X) * n - edit.Centre.InnerOffset.X,
+			(data.ChunkOffset.Y - edit.Centre.ChunkOffset.Y) * n - edit.Centre.InnerOffset.Y,
+			(data.ChunkOffset.Z - edit.Centre.ChunkOffset.Z) * n - edit.Centre.InnerOffset.Z);
+
+		// Only visit the samples within the bounds of the brush
+		Vector3D<Int64> from, to;
+		for (Uint8 i = 0; i < 3; i++) {
+			from[i] = std::max((Int64) 0, (Int64) std::ceil(-edit.Extent[i] - origin[i]));
+			to[i] = std::min(n - 1, (Int64) std::floor(edit.Extent[i] - origin[i]));
+		}
+
+		bool bChanged = false;
+		for (Int64 x = from.X; x <= to.X; x++) {
+			for (Int64 y = from.Y; y <= to.Y; y++) {
+				for (Int64 z = from.Z; z <= to.Z; z++) {
+					if (!edit.Contains(origin + Vector3D<>((double) x, (double) y, (double) z)))
+						continue;
+
+					const Uint32 ux = (Uint32) x, uy = (Uint32) y, uz = (Uint32) z;
+					const float density = data.DensityData->Get(ux, uy, uz);
+					const Uint64 material = data.MaterialData->Get(ux, uy, uz);
+					float newDensity = density;
+					Uint64 newMaterial = material;
+
+					switch (edit.Type) {
+					case E_Dig:
+						newDensity = 0;
+						break;
+					case E_Fill:
+						newDensity = 1;
+						newMaterial = edit.Material;
+						break;
+					case E_SetMaterial:
+						if (density > 0)
+							newMaterial = edit.Material;
+						break;
+					}
+
+					if (newDensity == density && newMaterial == material)
+						continue;
+
+					data.DensityData.Mutable().Set(ux, uy, uz, newDensity);
+					data.MaterialData.Mutable().Set(ux, uy, uz, newMaterial);
+					const Vector3D<Int64> sample(x, y, z);
+					changed.Include(ChunkCellRange(sample, sample));
+					bChanged = true;
+				}
+			}
+		}
+
+		if (bChanged)
+			data.Version++;
+		return bChanged;
+	}
+
+	void MarkDirtyCells(
+		const ChunkOffsetVector & offset,
+		const ChunkCellRange & changedSamples,
+		const Uint32 cellCount,
+		DirtyChunkMap & dirty
+	) {
+		if (changedSamples.IsEmpty())
+			return;
+
+		const Int64 n = cellCount;
+		const auto cells = ChunkCellRange::All(cellCount);
+		const Vector3D<Int64> before(2), after(1);
+
+		for (Int64 x = -1; x <= 1; x++) {
+			for (Int64 y = -1; y <= 1; y++) {
+				for (Int64 z = -1; z <= 1; z++) {
+					// The changed samples in the space of the neighbour
+					const Vector3D<Int64> shift(x * n, y * n, z * n);
+					const ChunkCellRange range(
+						changedSamples.Min - shift - before, changedSamples.Max - shift + after);
+					const auto clamped = range.Intersect(cells);
+					if (!clamped.IsEmpty())
+						dirty[offset + ChunkOffsetVector(x, y, z)].Include(clamped);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Models/Terrain/ChunkData.h>
+#include <Models/Terrain/TerrainDataStructures.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace terrain {
+	enum TerrainEditType {
+		E_Dig,              // Empties the samples in the brush
+		E_Fill,             // Fills the samples in the brush with the material
+		E_SetMaterial       // Changes the material of the solid samples in the brush
+	};
+
+	enum TerrainBrushShape {
+		E_Sphere,
+		E_Box
+	};
+
+	/**
+	 * A change to the density and material samples within a brush. A sphere brush with
+	 * different extents along each axis is an ellipsoid.
+	 */
+	struct TerrainEdit {
+		TerrainEditType Type;
+		TerrainBrushShape Shape;
+		ChunkPositionVector Centre;      // Inner offset in grid cells
+		utils::Vector3D<> Extent;        // Half the size of the brush along each axis
+		Uint64 Material;                 // Used by fills and material edits
+
+		TerrainEdit(
+			const TerrainEditType type,
+			const TerrainBrushShape shape,
+			const ChunkPositionVector & centre,
+			const utils::Vector3D<> & extent,
+			const Uint64 material = 0
+		) : Type(type), Shape(shape), Centre(centre), Extent(extent), Material(material) {}
+
+		/**
+		 * @param offset Position relative to the centre of the brush, in grid cells.
+		 */
+		bool Contains(const utils::Vector3D<> & offset) const;
+	};
+
+	// Cells of each chunk that have to be remeshed
+	using DirtyChunkMap = std::unordered_map<ChunkOffsetVector, ChunkCellRange>;
+
+	/**
+	 * Finds every chunk with samples that may be inside the brush.
+	 */
+	void FindEditedChunks(
+		const TerrainEdit & edit,
+		const Uint32 cellCount,
+		std::vector<ChunkOffsetVector> & offsets);
+
+	/**
+	 * Applies the edit to the samples of a single chunk, and increments the version of the
+	 * chunk if anything changed.
+	 * @param changed Grows to hold every sample that changed.
+	 * @return True if any sample changed.
+	 */
+	bool ApplyTerrainEdit(const TerrainEdit & edit, ChunkData & data, ChunkCellRange & changed);
+
+	/**
+	 * Marks the cells whose mesh depends on the changed samples of a chunk. These lie in the
+	 * chunk itself and, for samples on or next to its faces, in its neighbours. The normals
+	 * of the mesh reach one sample further than the cells, so each changed sample dirties
+	 * two cells to either side of it.
+	 */
+	void MarkDirtyCells(
+		const ChunkOffsetVector & offset,
+		const ChunkCellRange & changedSamples,
+		const Uint32 cellCount,
+		DirtyChunkMap & dirty);
+}
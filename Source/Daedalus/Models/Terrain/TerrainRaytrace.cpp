@@ -0,0 +1,213 @@
+#include <Daedalus.h>
+#include "TerrainRaytrace.h"
+
+#include <Models/Items/ItemSpatialIndex.h>
+#include <Models/Terrain/ChunkApron.h>
+#include <Models/Terrain/ChunkKernels.h>
+#include <Utilities/FastVoxelTraversal.h>
+#include <Utilities/OccupancyGrid.h>
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+
+namespace terrain {
+	using namespace utils;
+	using namespace items;
+
+	Option<TerrainRaytraceResult> TerrainResult(const ChunkPositionVector & entry) {
+		return Some(TerrainRaytraceResult(E_Terrain, entry, None<ItemDataId>()));
+	}
+
+	Option<TerrainRaytraceResult> ItemResult(
+		const ItemDataId & id, const ChunkPositionVector & pos
+	) {
+		return Some(TerrainRaytraceResult(E_PlacedItem, pos, Some(id)));
+	}
+
+	Option<TerrainRaytraceResult> NoResult() {
+		return None<TerrainRaytraceResult>();
+	}
+
+	namespace {
+		/**
+		 * Everything needed to trace rays through a single chunk, built once per chunk and
+		 * shared by every ray that passes through it during a query.
+		 */
+		struct ChunkTraceContext {
+			ChunkOffsetVector Offset;
+			ChunkDataPtr Chunk;
+			OccupancyGrid3D SolidTerrain;
+			const ItemSpatialIndex * ItemIndex;
+			bool bIsBuilt;
+
+			ChunkTraceContext() : Offset(0), ItemIndex(NULL), bIsBuilt(false) {}
+		};
+
+		using ChunkTraceContextPtr = std::unique_ptr<ChunkTraceContext>;
+
+		struct ChunkTraceGroup {
+			ChunkTraceContext * Context;
+			ChunkOffsetVector Offset;
+			const std::vector<Uint64> * RayIndices;
+		};
+
+		void BuildContext(
+			ChunkTraceContext & context,
+			const ChunkFinder & findChunk,
+			const ChunkDataPtr & emptyChunk,
+			const TerrainGeneratorParameters & params,
+			const ChunkOffsetVector & offset
+		) {
+			const Uint32 cellCount = params.GridCellCount;
+			context.Offset = offset;
+			context.bIsBuilt = true;
+			context.SolidTerrain.Reset(cellCount);
+			context.Chunk = findChunk(offset);
+			if (!context.Chunk)
+				return;
+			context.ItemIndex = &context.Chunk->ItemIndex;
+
+			ChunkDataSet chunks(NULL);
+			for (Uint32 x = 0; x < 3; x++) {
+				for (Uint32 y = 0; y < 3; y++) {
+					for (Uint32 z = 0; z < 3; z++) {
+						const auto chunk = findChunk({
+							offset.X + x - 1, offset.Y + y - 1, offset.Z + z - 1 });
+						chunks.Set(x, y, z, chunk ? chunk : emptyChunk);
+					}
+				}
+			}
+
+			// The same density test as AChunk::IsSolidTerrainAt, through a throwaway apron
+			const auto & kernels = GetChunkKernels();
+			ChunkApron apron;
+			kernels.FillApron(chunks, apron, cellCount);
+			kernels.FillSolid(apron, context.SolidTerrain, cellCount);
+		}
+
+		Option<TerrainRaytraceResult> TraceChunk(
+			const ChunkTraceContext & context,
+			const TerrainGeneratorParameters & params,
+			const Ray3D & ray,
+			const double maxDistance
+		) {
+			// Items spilling over from the neighbouring chunks are registered in this chunk's index
+			const auto * itemIndex = context.ItemIndex;
+			if (context.SolidTerrain.IsEmpty() && (!itemIndex || itemIndex->IsEmpty()))
+				return NoResult();
+
+			const Ray3D localRay(
+				params.ToGridCoordSpace(ray.Origin, context.Offset).InnerOffset, ray.Direction);
+			FastVoxelTraversalIterator fvt(
+				Vector3D<>(1.0), Vector3D<Int64>(0), Vector3D<Int64>(params.GridCellCount),
+				localRay, maxDistance / params.ChunkGridUnitSize);
+
+			while (fvt.IsValid()) {
+				const auto & current = fvt.GetCurrentCell();
+				if (current.IsBoundedBy(0, params.GridCellCount)) {
+					const Uint32 x = (Uint32) current.X;
+					const Uint32 y = (Uint32) current.Y;
+					const Uint32 z = (Uint32) current.Z;
+
+					const bool bHasItems = itemIndex && !itemIndex->IsBucketEmptyAt(x, y, z);
+					if (!bHasItems && context.SolidTerrain.IsBrickEmptyAt(x, y, z)) {
+						fvt.SkipBlock(OccupancyGrid3D::BRICK_SIZE);
+						continue;
+					}
+
+					const ChunkPositionVector prevPos(
+						context.Offset, fvt.GetPreviousCell().Cast<double>());
+					if (context.SolidTerrain.Get(x, y, z)) {
+						return TerrainResult(prevPos);
+					} else if (bHasItems) {
+						const double inset = 0.01; // Accounts for rounding errors
+						const Point3D cell = current.Cast<double>();
+						const AxisAlignedBoundingBox3D bb(
+							cell + Vector3D<>(inset), cell + Vector3D<>(1 - inset));
+						const auto item = itemIndex->FindCollision(bb);
+						if (item.IsValid()) {
+							const ItemDataId id((*item)->ItemId, (*item)->Position.ChunkOffset);
+							return ItemResult(id, prevPos);
+						}
+					}
+				}
+
+				fvt.Next();
+			}
+
+			return NoResult();
+		}
+	}
+
+	TerrainRaytracer::TerrainRaytracer(
+		const TerrainGeneratorParameters & params,
+		const ChunkFinder & findChunk,
+		JobSystem & jobs
+	) : TerrainGenParams(params), FindChunk(findChunk), Jobs(jobs),
+		EmptyChunk(new ChunkData(params.GridCellCount, ChunkOffsetVector(0)))
+	{}
+
+	TerrainRaytraceResults TerrainRaytracer::Raytrace(
+		const std::vector<Ray3D> & rays,
+		const std::vector<double> & maxDistances
+	) const {
+		if (rays.size() != maxDistances.size())
+			throw StringException("TerrainRaytracer::Raytrace: Ray and distance counts differ");
+
+		TerrainRaytraceResults results(rays.size());
+
+		// Chunk level traversal for each ray, the same as AChunkManager::Raytrace
+		std::vector<FastVoxelTraversalIterator> chunkIterators;
+		chunkIterators.reserve(rays.size());
+		for (Uint64 i = 0; i < rays.size(); i++) {
+			chunkIterators.emplace_back(
+				Point3D(TerrainGenParams.ChunkScale), rays[i], maxDistances[i]);
+		}
+
+		std::unordered_map<ChunkOffsetVector, ChunkTraceContextPtr> contexts;
+		std::unordered_map<ChunkOffsetVector, std::vector<Uint64>> groups;
+		std::vector<ChunkTraceGroup> work;
+
+		while (true) {
+			// Group all the unfinished rays by their current chunk
+			groups.clear();
+			for (Uint64 i = 0; i < rays.size(); i++) {
+				if (!results[i].IsValid() && chunkIterators[i].IsValid())
+					groups[chunkIterators[i].GetCurrentCell()].push_back(i);
+			}
+			if (groups.empty())
+				break;
+
+			// Contexts are only created here, the workers each fill in their own context
+			work.clear();
+			for (const auto & group : groups) {
+				auto & context = contexts[group.first];
+				if (!context)
+					context.reset(new ChunkTraceContext());
+				work.push_back({ context.get(), group.first, &group.second });
+			}
+
+			// The caller is waiting on the results, so they go ahead of any background work
+			Jobs.ParallelFor(work.size(), 1, [&] (const Uint64 index) {
+				const auto & group = work[index];
+				auto & context = *group.Context;
+				if (!context.bIsBuilt)
+					BuildContext(
+						context, FindChunk, EmptyChunk, TerrainGenParams, group.Offset);
+
+				for (const auto rayIndex : *group.RayIndices) {
+					results[rayIndex] = TraceChunk(
+						context, TerrainGenParams, rays[rayIndex], maxDistances[rayIndex]);
+				}
+			}, J_High);
+
+			for (Uint64 i = 0; i < rays.size(); i++) {
+				if (!results[i].IsValid() && chunkIterators[i].IsValid())
+					chunkIterators[i].Next();
+			}
+		}
+
+		return results;
+	}
+}
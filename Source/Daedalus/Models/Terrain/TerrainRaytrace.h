@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Models/Items/ItemData.h>
+#include <Models/Terrain/ChunkData.h>
+#include <Models/Terrain/TerrainDataStructures.h>
+#include <Utilities/DataStructures.h>
+#include <Utilities/JobSystem.h>
+#include <Utilities/Algebra/Algebra3D.h>
+
+#include <functional>
+#include <vector>
+
+namespace terrain {
+	enum TerrainRaytraceResultType {
+		E_Character,
+		E_Terrain,
+		E_PlacedItem
+	};
+
+	struct TerrainRaytraceResult {
+		const TerrainRaytraceResultType Type;
+		utils::Option<items::ItemDataId> ItemId;
+		const ChunkPositionVector EntryPosition;
+
+		TerrainRaytraceResult(
+			const TerrainRaytraceResultType type,
+			const ChunkPositionVector & pos,
+			const utils::Option<items::ItemDataId> itemId
+		) : Type(type), ItemId(itemId), EntryPosition(pos)
+		{}
+	};
+
+	using TerrainRaytraceResults = std::vector<utils::Option<TerrainRaytraceResult>>;
+
+	utils::Option<TerrainRaytraceResult> TerrainResult(const ChunkPositionVector & entry);
+	utils::Option<TerrainRaytraceResult> ItemResult(
+		const items::ItemDataId & id, const ChunkPositionVector & pos);
+	utils::Option<TerrainRaytraceResult> NoResult();
+
+	/**
+	 * Looks up a chunk without loading or generating it, returning a null pointer for
+	 * chunks that aren't loaded, such as ChunkLoader::FindLoadedChunk.
+	 */
+	using ChunkFinder = std::function<ChunkDataPtr (const ChunkOffsetVector &)>;
+
+	/**
+	 * Read-only batch raycaster over chunk data that is already loaded. The rays are
+	 * processed in rounds: each round groups the active rays by the chunk they are currently
+	 * in, resolves that chunk's neighbourhood and occupancy once for the whole group, and
+	 * traces the groups as jobs. Chunks that haven't been loaded are treated as empty space,
+	 * so a query never spawns or generates terrain. The chunks must not be modified while a
+	 * query is running.
+	 */
+	class TerrainRaytracer {
+	private:
+		const TerrainGeneratorParameters & TerrainGenParams;
+		const ChunkFinder FindChunk;
+		utils::JobSystem & Jobs;
+		// Stands in for the neighbours that aren't loaded
+		ChunkDataPtr EmptyChunk;
+
+	public:
+		/**
+		 * @param findChunk Called from the jobs, so it must be safe to call concurrently.
+		 * @param jobs Runs the chunk groups of each round, the calling thread helps out.
+		 */
+		TerrainRaytracer(
+			const TerrainGeneratorParameters & params,
+			const ChunkFinder & findChunk,
+			utils::JobSystem & jobs = utils::GetJobSystem());
+
+		/**
+		 * @param rays Rays in real world coordinates, the directions should be normal.
+		 * @param maxDistances Maximum distance of each ray in real world units.
+		 * @return The result of each ray, in the same order as the input rays.
+		 */
+		TerrainRaytraceResults Raytrace(
+			const std::vector<utils::Ray3D> & rays,
+			const std::vector<double> & maxDistances) const;
+	};
+}
@@ -0,0 +1,126 @@
+#include <Daedalus.h>
+#include "WorldSnapshot.h"
+
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+	// Unreal's own types clash with the ones windows.h declares
+	#ifdef PLATFORM_WINDOWS
+		#include "AllowWindowsPlatformTypes.h"
+	#endif
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#ifdef PLATFORM_WINDOWS
+		#include "HideWindowsPlatformTypes.h"
+	#endif
+#endif
+
+namespace terrain {
+	namespace {
+		/*
+		 Moves the file over the destination in a single step, so that the destination is
+		 always either the old or the new file. std::rename doesn't replace existing files on
+		 Windows. Paths are narrow strings, the same as the ones given to std::ofstream.
+		 */
+		bool MoveFileOver(const std::string & from, const std::string & to) {
+#ifdef _WIN32
+			return MoveFileExA(from.c_str(), to.c_str(),
+				MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+			return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+		}
+	}
+
+	void WriteWorldSnapshot(std::ostream & output, const WorldSnapshot & snapshot) {
+		ChunkDeltaMap deltas(snapshot.Deltas);
+		for (const auto & chunk : snapshot.Chunks) {
+			std::shared_ptr<ChunkDelta> delta(new ChunkDelta(chunk.ChunkOffset));
+			DiffChunkSamples(
+				*chunk.BaseDensity, *chunk.BaseMaterials, *chunk.Density, *chunk.Materials, *delta);
+			delta->Items = chunk.Items;
+			// Edits can be undone, leaving nothing to save
+			if (!delta->IsEmpty())
+				deltas[chunk.ChunkOffset] = delta;
+		}
+		WriteChunkDeltas(output, deltas);
+	}
+
+	WorldSnapshotWriter::WorldSnapshotWriter(const std::string & path) :
+		Path(path), bWriting(false), bStopping(false), WrittenCount(0), FailedCount(0),
+		Worker(&WorldSnapshotWriter::Run, this)
+	{}
+
+	WorldSnapshotWriter::~WorldSnapshotWriter() {
+		{
+			std::lock_guard<std::mutex> guard(Lock);
+			bStopping = true;
+		}
+		Changed.notify_all();
+		Worker.join();
+	}
+
+	void WorldSnapshotWriter::Submit(const WorldSnapshotPtr & snapshot) {
+		{
+			std::lock_guard<std::mutex> guard(Lock);
+			Pending = snapshot;
+		}
+		Changed.notify_all();
+	}
+
+	void WorldSnapshotWriter::Flush() {
+		std::unique_lock<std::mutex> guard(Lock);
+		Changed.wait(guard, [this] { return !Pending && !bWriting; });
+	}
+
+	Uint64 WorldSnapshotWriter::GetWrittenCount() {
+		std::lock_guard<std::mutex> guard(Lock);
+		return WrittenCount;
+	}
+
+	Uint64 WorldSnapshotWriter::GetFailedCount() {
+		std::lock_guard<std::mutex> guard(Lock);
+		return FailedCount;
+	}
+
+	void WorldSnapshotWriter::Run() {
+		std::unique_lock<std::mutex> guard(Lock);
+		while (true) {
+			Changed.wait(guard, [this] { return Pending || bStopping; });
+			// The pending snapshot is still written when stopping
+			if (!Pending)
+				return;
+
+			const auto snapshot = Pending;
+			Pending = NULL;
+			bWriting = true;
+			guard.unlock();
+
+			const bool bWritten = Write(*snapshot);
+
+			guard.lock();
+			bWriting = false;
+			if (bWritten)
+				WrittenCount++;
+			else
+				FailedCount++;
+			Changed.notify_all();
+		}
+	}
+
+	bool WorldSnapshotWriter::Write(const WorldSnapshot & snapshot) const {
+		const std::string temporary = Path + ".tmp";
+		{
+			std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+			if (!output)
+				return false;
+			WriteWorldSnapshot(output, snapshot);
+			output.flush();
+			if (!output)
+				return false;
+		}
+
+		return MoveFileOver(temporary, Path);
+	}
+}
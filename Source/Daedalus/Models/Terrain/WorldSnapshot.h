@@ -0,0 +1,89 @@
+#pragma once
+
+#include <Models/Terrain/ChunkData.h>
+#include <Models/Terrain/ChunkDelta.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace terrain {
+	/**
+	 * The versions of an edited chunk's fields at the time of a snapshot, along with the
+	 * versions the generator built. The chunk copies its fields before writing to them again,
+	 * so the pinned versions never change and can be diffed on any thread.
+	 */
+	struct ChunkSnapshot {
+		ChunkOffsetVector ChunkOffset;
+		std::shared_ptr<const ChunkData::DensityField> Density;
+		std::shared_ptr<const ChunkData::MaterialField> Materials;
+		std::shared_ptr<const ChunkData::DensityField> BaseDensity;
+		std::shared_ptr<const ChunkData::MaterialField> BaseMaterials;
+		// Items are mutable and few, so they are copied instead
+		std::vector<ChunkDelta::PlacedItem> Items;
+
+		ChunkSnapshot() : ChunkOffset(0) {}
+	};
+
+	/**
+	 * A consistent view of every change players made to the world. Biome regions aren't
+	 * included since they are never changed, the seed rebuilds them.
+	 */
+	struct WorldSnapshot {
+		std::vector<ChunkSnapshot> Chunks;      // Edited chunks that are loaded
+		ChunkDeltaMap Deltas;                   // Edited chunks that aren't loaded
+	};
+
+	using WorldSnapshotPtr = std::shared_ptr<const WorldSnapshot>;
+
+	/**
+	 * Diffs the chunks of the snapshot against their bases and writes the deltas of the whole
+	 * world, in the format read by ReadChunkDeltas. Safe to call on any thread.
+	 */
+	void WriteWorldSnapshot(std::ostream & output, const WorldSnapshot & snapshot);
+
+	/**
+	 * Writes snapshots to a file on a background thread, so that saving never stalls the game.
+	 * A snapshot submitted while another is waiting replaces it, since it is more recent. The
+	 * file is written beside the destination first and then moved over it, so an interrupted
+	 * save leaves the previous save intact.
+	 */
+	class WorldSnapshotWriter {
+	private:
+		const std::string Path;
+
+		std::mutex Lock;
+		std::condition_variable Changed;
+		WorldSnapshotPtr Pending;
+		bool bWriting;
+		bool bStopping;
+		Uint64 WrittenCount;
+		Uint64 FailedCount;
+
+		std::thread Worker;     // Started last, once the state above is initialized
+
+		void Run();
+		bool Write(const WorldSnapshot & snapshot) const;
+
+	public:
+		WorldSnapshotWriter(const std::string & path);
+		/**
+		 * Finishes writing the pending snapshot before returning.
+		 */
+		~WorldSnapshotWriter();
+
+		void Submit(const WorldSnapshotPtr & snapshot);
+
+		/**
+		 * Blocks until every submitted snapshot has been written.
+		 */
+		void Flush();
+
+		Uint64 GetWrittenCount();
+		Uint64 GetFailedCount();
+	};
+}
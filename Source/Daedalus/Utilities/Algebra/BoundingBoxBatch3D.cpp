@@ -0,0 +1,384 @@
+#include <Daedalus.h>
+#include "BoundingBoxBatch3D.h"
+
+#include <Utilities/Constants.h>
+#include <Utilities/Algebra/Algebra3D.h>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+	#define DAEDALUS_OBB_BATCH_AVX
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define DAEDALUS_OBB_BATCH_SSE2
+	#include <emmintrin.h>
+#endif
+
+namespace utils {
+	namespace {
+		/*
+		 The kernel is written once against these lane types. Each one wraps a register of
+		 doubles and a comparison mask, and every operation maps to a single instruction. The
+		 arithmetic is done in exactly the same order as BoundingBox3D::BoundingBoxIntersection
+		 so that both give identical results.
+		 */
+		struct ScalarLanes {
+			static const Uint32 WIDTH = 1;
+			using Value = double;
+			using Mask = bool;
+
+			static inline Value Load(const double * p) { return *p; }
+			static inline Value Broadcast(const double v) { return v; }
+			static inline Value Add(const Value a, const Value b) { return a + b; }
+			static inline Value Sub(const Value a, const Value b) { return a - b; }
+			static inline Value Mul(const Value a, const Value b) { return a * b; }
+			static inline Value Abs(const Value a) { return std::abs(a); }
+			static inline Value Max(const Value a, const Value b) { return a < b ? b : a; }
+			static inline Mask GreaterThan(const Value a, const Value b) { return a > b; }
+			static inline Mask GreaterEqual(const Value a, const Value b) { return a >= b; }
+			static inline Mask LessThan(const Value a, const Value b) { return a < b; }
+			static inline Mask Or(const Mask a, const Mask b) { return a || b; }
+			static inline Mask AndNot(const Mask a, const Mask b) { return !a && b; }
+			static inline Mask False() { return false; }
+			static inline Uint32 Bits(const Mask m) { return m ? 1 : 0; }
+		};
+
+#if defined(DAEDALUS_OBB_BATCH_SSE2)
+		struct SimdLanes {
+			static const Uint32 WIDTH = 2;
+			using Value = __m128d;
+			using Mask = __m128d;
+
+			static inline Value Load(const double * p) { return _mm_loadu_pd(p); }
+			static inline Value Broadcast(const double v) { return _mm_set1_pd(v); }
+			static inline Value Add(const Value a, const Value b) { return _mm_add_pd(a, b); }
+			static inline Value Sub(const Value a, const Value b) { return _mm_sub_pd(a, b); }
+			static inline Value Mul(const Value a, const Value b) { return _mm_mul_pd(a, b); }
+			static inline Value Abs(const Value a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+			static inline Value Max(const Value a, const Value b) { return _mm_max_pd(a, b); }
+			static inline Mask GreaterThan(const Value a, const Value b) { return _mm_cmpgt_pd(a, b); }
+			static inline Mask GreaterEqual(const Value a, const Value b) { return _mm_cmpge_pd(a, b); }
+			static inline Mask LessThan(const Value a, const Value b) { return _mm_cmplt_pd(a, b); }
+			static inline Mask Or(const Mask a, const Mask b) { return _mm_or_pd(a, b); }
+			static inline Mask AndNot(const Mask a, const Mask b) { return _mm_andnot_pd(a, b); }
+			static inline Mask False() { return _mm_setzero_pd(); }
+			static inline Uint32 Bits(const Mask m) { return (Uint32) _mm_movemask_pd(m); }
+		};
+#elif defined(DAEDALUS_OBB_BATCH_AVX)
+		struct SimdLanes {
+			static const Uint32 WIDTH = 4;
+			using Value = __m256d;
+			using Mask = __m256d;
+
+			static inline Value Load(const double * p) { return _mm256_loadu_pd(p); }
+			static inline Value Broadcast(const double v) { return _mm256_set1_pd(v); }
+			static inline Value Add(const Value a, const Value b) { return _mm256_add_pd(a, b); }
+			static inline Value Sub(const Value a, const Value b) { return _mm256_sub_pd(a, b); }
+			static inline Value Mul(const Value a, const Value b) { return _mm256_mul_pd(a, b); }
+			static inline Value Abs(const Value a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+			static inline Value Max(const Value a, const Value b) { return _mm256_max_pd(a, b); }
+			static inline Mask GreaterThan(const Value a, const Value b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+			static inline Mask GreaterEqual(const Value a, const Value b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+			static inline Mask LessThan(const Value a, const Value b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+			static inline Mask Or(const Mask a, const Mask b) { return _mm256_or_pd(a, b); }
+			static inline Mask AndNot(const Mask a, const Mask b) { return _mm256_andnot_pd(a, b); }
+			static inline Mask False() { return _mm256_setzero_pd(); }
+			static inline Uint32 Bits(const Mask m) { return (Uint32) _mm256_movemask_pd(m); }
+		};
+#else
+		using SimdLanes = ScalarLanes;
+#endif
+
+		// Margin for the axis aligned prefilter, so that it never rejects a pair of boxes
+		// that the separating axis test with its relative epsilon comparisons would accept
+		const double PREFILTER_MARGIN = 1E-6;
+		const double PREFILTER_RELATIVE_MARGIN = 1E-7;
+
+		/**
+		 * Query box values that are shared by every lane.
+		 */
+		struct QueryBox {
+			double Axes[3][3];
+			double Extents[3];
+			double Centre[3];
+			double Min[3];
+			double Max[3];
+			double Margin;
+
+			QueryBox(const BoundingBox3D & box) {
+				const Basis3D basis = box.GetBasis();
+				const Vector3D<> extents = box.GetExtents();
+				const Vector3D<> centre = box.GetCentre();
+				for (Uint8 i = 0; i < 3; i++) {
+					for (Uint8 k = 0; k < 3; k++)
+						Axes[i][k] = basis[i][k];
+					Extents[i] = extents[i];
+					Centre[i] = centre[i];
+				}
+				double scale = 1;
+				for (Uint8 k = 0; k < 3; k++) {
+					double radius = 0;
+					for (Uint8 i = 0; i < 3; i++)
+						radius += Extents[i] * std::abs(Axes[i][k]);
+					Min[k] = Centre[k] - radius;
+					Max[k] = Centre[k] + radius;
+					scale = std::max(scale, std::max(std::abs(Min[k]), std::abs(Max[k])));
+				}
+				Margin = PREFILTER_MARGIN + PREFILTER_RELATIVE_MARGIN * scale;
+			}
+		};
+
+		using Fields = std::array<std::vector<double>, OrientedBoundingBoxBatch3D::F_FieldCount>;
+
+		/**
+		 * @return Mask of the lanes starting at index which can't intersect the query.
+		 */
+		template <typename L>
+		inline typename L::Mask Prefilter(const QueryBox & query, const Fields & fields, const Uint64 index) {
+			using F = OrientedBoundingBoxBatch3D;
+			auto outside = L::False();
+			for (Uint8 k = 0; k < 3; k++) {
+				const auto min = L::Load(fields[F::F_MinX + k].data() + index);
+				const auto max = L::Load(fields[F::F_MaxX + k].data() + index);
+				outside = L::Or(outside,
+					L::LessThan(L::Broadcast(query.Max[k] + query.Margin), min));
+				outside = L::Or(outside,
+					L::GreaterThan(L::Broadcast(query.Min[k] - query.Margin), max));
+			}
+			return outside;
+		}
+
+		/**
+		 * Separating axis test for the lanes starting at index, see
+		 * BoundingBox3D::BoundingBoxIntersection for the derivation.
+		 * @return Mask of the lanes which are separated from the query.
+		 */
+		template <typename L>
+		inline typename L::Mask Separated(
+			const QueryBox & query, const Fields & fields,
+			const Uint64 index, const bool isInclusive
+		) {
+			using F = OrientedBoundingBoxBatch3D;
+			using Value = typename L::Value;
+			using Mask = typename L::Mask;
+
+			const Value maxDiff = L::Broadcast(DOUBLE_EPSILON);
+			const Value negMaxDiff = L::Broadcast(-DOUBLE_EPSILON);
+			const Value maxRelDiff = L::Broadcast(DOUBLE_EPSILON);
+			const auto compare = [&] (const Value r1, const Value r2) -> Mask {
+				const Value diff = L::Sub(r1, r2);
+				const Value rel = L::Abs(L::Mul(L::Max(r1, r2), maxRelDiff));
+				if (isInclusive)
+					return L::Or(L::GreaterThan(diff, maxDiff), L::GreaterThan(diff, rel));
+				return L::Or(
+					L::GreaterEqual(diff, negMaxDiff),
+					L::GreaterEqual(diff, L::Sub(L::Broadcast(0.0), rel)));
+			};
+			const auto load = [&] (const Uint32 field) {
+				return L::Load(fields[field].data() + index);
+			};
+
+			Value axes[3][3];
+			Value extents[3];
+			Value centreDiff[3];
+			for (Uint8 j = 0; j < 3; j++) {
+				for (Uint8 k = 0; k < 3; k++)
+					axes[j][k] = load(F::F_Axis0X + j * 3 + k);
+				extents[j] = load(F::F_ExtentX + j);
+				centreDiff[j] = L::Sub(load(F::F_CentreX + j), L::Broadcast(query.Centre[j]));
+			}
+
+			const Value cutoff = L::Broadcast(1.0 - DOUBLE_RADIAN_EPSILON);
+			Mask parallel = L::False();
+			Mask separated = L::False();
+
+			Value C[3][3];
+			Value AbsC[3][3];
+			Value AD[3];
+			Value qExtents[3];
+			Value qAxes[3][3];
+			for (Uint8 i = 0; i < 3; i++) {
+				qExtents[i] = L::Broadcast(query.Extents[i]);
+				for (Uint8 k = 0; k < 3; k++)
+					qAxes[i][k] = L::Broadcast(query.Axes[i][k]);
+			}
+
+			// Face axes of the query box
+			for (Uint8 i = 0; i < 3; i++) {
+				for (Uint8 j = 0; j < 3; j++) {
+					C[i][j] = L::Add(L::Add(
+						L::Mul(qAxes[i][0], axes[j][0]),
+						L::Mul(qAxes[i][1], axes[j][1])),
+						L::Mul(qAxes[i][2], axes[j][2]));
+					AbsC[i][j] = L::Abs(C[i][j]);
+					parallel = L::Or(parallel, L::GreaterThan(AbsC[i][j], cutoff));
+				}
+				AD[i] = L::Add(L::Add(
+					L::Mul(qAxes[i][0], centreDiff[0]),
+					L::Mul(qAxes[i][1], centreDiff[1])),
+					L::Mul(qAxes[i][2], centreDiff[2]));
+				const Value thatRadius = L::Add(L::Add(
+					L::Mul(extents[0], AbsC[i][0]),
+					L::Mul(extents[1], AbsC[i][1])),
+					L::Mul(extents[2], AbsC[i][2]));
+				separated = L::Or(separated,
+					compare(L::Abs(AD[i]), L::Add(qExtents[i], thatRadius)));
+			}
+
+			// Face axes of the batch boxes
+			for (Uint8 j = 0; j < 3; j++) {
+				const Value radiusDiff = L::Abs(L::Add(L::Add(
+					L::Mul(axes[j][0], centreDiff[0]),
+					L::Mul(axes[j][1], centreDiff[1])),
+					L::Mul(axes[j][2], centreDiff[2])));
+				const Value thisRadius = L::Add(L::Add(
+					L::Mul(qExtents[0], AbsC[0][j]),
+					L::Mul(qExtents[1], AbsC[1][j])),
+					L::Mul(qExtents[2], AbsC[2][j]));
+				separated = L::Or(separated,
+					compare(radiusDiff, L::Add(thisRadius, extents[j])));
+			}
+
+			// Edge cross products, which only matter when no pair of axes is parallel
+			Mask edgeSeparated = L::False();
+			for (Uint8 i = 0; i < 3; i++) {
+				const Uint8 i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+				for (Uint8 j = 0; j < 3; j++) {
+					const Uint8 j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+					const Value radiusDiff = L::Abs(L::Sub(
+						L::Mul(AD[i2], C[i1][j]),
+						L::Mul(AD[i1], C[i2][j])));
+					const Value thisRadius = L::Add(
+						L::Mul(qExtents[i1], AbsC[i2][j]),
+						L::Mul(qExtents[i2], AbsC[i1][j]));
+					const Value thatRadius = L::Add(
+						L::Mul(extents[j1], AbsC[i][j2]),
+						L::Mul(extents[j2], AbsC[i][j1]));
+					edgeSeparated = L::Or(edgeSeparated,
+						compare(radiusDiff, L::Add(thisRadius, thatRadius)));
+				}
+			}
+
+			return L::Or(separated, L::AndNot(parallel, edgeSeparated));
+		}
+
+		/**
+		 * Runs the test over [begin, end) and calls onHits with the index of the first lane and
+		 * the bits of the lanes that hit. Stops early when onHits returns false.
+		 */
+		template <typename L, typename H>
+		Uint64 RunLanes(
+			const QueryBox & query, const Fields & fields,
+			Uint64 index, const Uint64 end,
+			const bool isInclusive, const H & onHits
+		) {
+			const Uint32 allLanes = (1u << L::WIDTH) - 1;
+			for (; index + L::WIDTH <= end; index += L::WIDTH) {
+				const auto outside = Prefilter<L>(query, fields, index);
+				const Uint32 outsideBits = L::Bits(outside);
+				if (outsideBits == allLanes)
+					continue;
+				const Uint32 hits =
+					~(outsideBits | L::Bits(Separated<L>(query, fields, index, isInclusive))) & allLanes;
+				if (hits != 0 && !onHits(index, hits))
+					return end;
+			}
+			return index;
+		}
+
+		template <typename H>
+		void Run(const QueryBox & query, const Fields & fields, const bool isInclusive, const H & onHits) {
+			const Uint64 size = fields[0].size();
+			const Uint64 index = RunLanes<SimdLanes>(query, fields, 0, size, isInclusive, onHits);
+			RunLanes<ScalarLanes>(query, fields, index, size, isInclusive, onHits);
+		}
+	}
+
+	void OrientedBoundingBoxBatch3D::Store(
+		const Uint64 index,
+		const OrientedBoundingBox3D & box,
+		const Vector3D<> & offset
+	) {
+		const Basis3D basis = box.GetBasis();
+		const Vector3D<> extents = box.GetExtents();
+		const Vector3D<> centre = box.GetCentre() + offset;
+		auto enclosing = box.GetEnclosingBoundingBox();
+
+		for (Uint8 k = 0; k < 3; k++) {
+			Fields[F_CentreX + k][index] = centre[k];
+			Fields[F_ExtentX + k][index] = extents[k];
+			Fields[F_Axis0X + k][index] = basis.XVector[k];
+			Fields[F_Axis1X + k][index] = basis.YVector[k];
+			Fields[F_Axis2X + k][index] = basis.ZVector[k];
+			Fields[F_MinX + k][index] = enclosing.MinPoint[k] + offset[k];
+			Fields[F_MaxX + k][index] = enclosing.MaxPoint[k] + offset[k];
+		}
+	}
+
+	Uint64 OrientedBoundingBoxBatch3D::Add(
+		const OrientedBoundingBox3D & box,
+		const Vector3D<> & offset
+	) {
+		const Uint64 index = Size();
+		for (auto & field : Fields)
+			field.push_back(0);
+		Store(index, box, offset);
+		return index;
+	}
+
+	void OrientedBoundingBoxBatch3D::Set(
+		const Uint64 index,
+		const OrientedBoundingBox3D & box,
+		const Vector3D<> & offset
+	) {
+		Store(index, box, offset);
+	}
+
+	void OrientedBoundingBoxBatch3D::RemoveSwap(const Uint64 index) {
+		for (auto & field : Fields) {
+			field[index] = field.back();
+			field.pop_back();
+		}
+	}
+
+	void OrientedBoundingBoxBatch3D::Clear() {
+		for (auto & field : Fields)
+			field.clear();
+	}
+
+	bool OrientedBoundingBoxBatch3D::Intersect(
+		const BoundingBox3D & query,
+		std::vector<Uint64> & hitMask,
+		const bool isInclusive
+	) const {
+		hitMask.assign((Size() + 63) / 64, 0);
+		bool bFound = false;
+		Run(QueryBox(query), Fields, isInclusive, [&] (const Uint64 index, const Uint32 hits) {
+			for (Uint32 lane = 0; lane < 32; lane++) {
+				if (hits & (1u << lane)) {
+					const Uint64 i = index + lane;
+					hitMask[i / 64] |= Uint64(1) << (i % 64);
+				}
+			}
+			bFound = true;
+			return true;
+		});
+		return bFound;
+	}
+
+	Option<Uint64> OrientedBoundingBoxBatch3D::FindFirstIntersection(
+		const BoundingBox3D & query,
+		const bool isInclusive
+	) const {
+		Option<Uint64> found;
+		Run(QueryBox(query), Fields, isInclusive, [&] (const Uint64 index, const Uint32 hits) {
+			Uint32 lane = 0;
+			while (!(hits & (1u << lane)))
+				lane++;
+			found = Some(index + lane);
+			return false;
+		});
+		return found;
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <Utilities/DataStructures.h>
+#include <Utilities/Algebra/DataStructures3D.h>
+
+#include <array>
+#include <vector>
+
+namespace utils {
+	/**
+	 * Stores a set of oriented bounding boxes in structure of arrays layout, so that a single
+	 * query box can be tested against all of them with a non-virtual separating axis test that
+	 * runs several boxes per SIMD instruction. The results are the same as calling
+	 * BoundingBox3D::BoundingBoxIntersection on every box in turn.
+	 */
+	class OrientedBoundingBoxBatch3D {
+	public:
+		enum Field {
+			F_CentreX, F_CentreY, F_CentreZ,
+			F_ExtentX, F_ExtentY, F_ExtentZ,
+			F_Axis0X, F_Axis0Y, F_Axis0Z,
+			F_Axis1X, F_Axis1Y, F_Axis1Z,
+			F_Axis2X, F_Axis2Y, F_Axis2Z,
+			F_MinX, F_MinY, F_MinZ,              // Enclosing axis aligned bounds
+			F_MaxX, F_MaxY, F_MaxZ,
+			F_FieldCount
+		};
+
+	private:
+		std::array<std::vector<double>, F_FieldCount> Fields;
+
+		void Store(const Uint64 index, const OrientedBoundingBox3D & box, const Vector3D<> & offset);
+
+	public:
+		/**
+		 * @param offset Translation applied to the box before it is stored.
+		 * @return Index of the new box.
+		 */
+		Uint64 Add(const OrientedBoundingBox3D & box, const Vector3D<> & offset = Vector3D<>(0));
+		void Set(
+			const Uint64 index,
+			const OrientedBoundingBox3D & box,
+			const Vector3D<> & offset = Vector3D<>(0));
+
+		/**
+		 * Removes the box at the given index, the last box takes its place.
+		 */
+		void RemoveSwap(const Uint64 index);
+		void Clear();
+
+		inline Uint64 Size() const { return Fields[0].size(); }
+		inline bool IsEmpty() const { return Fields[0].empty(); }
+		inline const double * GetField(const Field field) const { return Fields[field].data(); }
+
+		/**
+		 * Tests the query box against every box in the batch.
+		 * @param hitMask Receives one bit per box, bit i % 64 of word i / 64 is set when the
+		 *                query intersects box i.
+		 * @return True if any of the boxes intersect the query.
+		 */
+		bool Intersect(
+			const BoundingBox3D & query,
+			std::vector<Uint64> & hitMask,
+			const bool isInclusive = true) const;
+
+		/**
+		 * @return Index of the first box that intersects the query.
+		 */
+		Option<Uint64> FindFirstIntersection(
+			const BoundingBox3D & query,
+			const bool isInclusive = true) const;
+	};
+}
@@ -6,6 +6,7 @@
 #include <Utilities/Algebra/Matrix4D.h>
 
 #include <array>
+#include <utility>
 
 namespace utils {
 	using Point3D = Vector3D<>;
@@ -42,10 +43,11 @@ namespace utils {
 		}
 	};
 
+	template <typename T = double>
 	struct Triangle3D {
-		Point3D Point1, Point2, Point3;
+		Vector3D<T> Point1, Point2, Point3;
 
-		Triangle3D(const Point3D & p1, const Point3D & p2, const Point3D & p3) :
+		Triangle3D(const Vector3D<T> & p1, const Vector3D<T> & p2, const Vector3D<T> & p3) :
 			Point1(p1), Point2(p2), Point3(p3)
 		{}
 	};
@@ -135,10 +137,80 @@ namespace utils {
 	// TODO: make actual colour class
 	using Colour = Vector3D<Uint8>;
 
+	/**
+	 * Up to MAX_MATERIALS materials blended at a point, heaviest first once normalized.
+	 */
+	struct MaterialBlend {
+		static const Uint8 MAX_MATERIALS = 4;
+
+		Uint32 Ids[MAX_MATERIALS];
+		float Weights[MAX_MATERIALS];
+		Uint8 Count;
+
+		MaterialBlend() : Count(0) {}
+
+		/**
+		 * Adds weight to a material. Once the blend is full, the lightest material is replaced
+		 * by a heavier new one.
+		 */
+		void Add(const Uint32 id, const float weight) {
+			if (weight <= 0)
+				return;
+			for (Uint8 i = 0; i < Count; i++) {
+				if (Ids[i] == id) {
+					Weights[i] += weight;
+					return;
+				}
+			}
+			if (Count < MAX_MATERIALS) {
+				Ids[Count] = id;
+				Weights[Count++] = weight;
+				return;
+			}
+			Uint8 lightest = 0;
+			for (Uint8 i = 1; i < Count; i++) {
+				if (Weights[i] < Weights[lightest])
+					lightest = i;
+			}
+			if (Weights[lightest] < weight) {
+				Ids[lightest] = id;
+				Weights[lightest] = weight;
+			}
+		}
+
+		/**
+		 * Sorts the materials by weight and scales the weights to sum to 1.
+		 */
+		void Normalize() {
+			float sum = 0;
+			for (Uint8 i = 0; i < Count; i++)
+				sum += Weights[i];
+			for (Uint8 i = 0; i < Count; i++) {
+				Weights[i] /= sum;
+				for (Uint8 j = i; j > 0 && Weights[j] > Weights[j - 1]; j--) {
+					std::swap(Weights[j], Weights[j - 1]);
+					std::swap(Ids[j], Ids[j - 1]);
+				}
+			}
+		}
+	};
+
 	// TODO: get rid of this
 	struct GridCell {
 		float values[8];
-		Vector3D<> points[8];
+		Vector3D<float> points[8];
+		// Only read when meshing with attributes
+		Vector3D<float> normals[8];
+		Uint32 materials[8];
+
+		/**
+		 * @return Index into points of a corner numbered x << 2 | y << 1 | z, the order
+		 *         of Tensor3D::GetCorners.
+		 */
+		static inline Uint8 PointOfCorner(const Uint8 corner) {
+			static const Uint8 points[8] = { 0, 4, 3, 7, 1, 5, 2, 6 };
+			return points[corner];
+		}
 
 		void Initialize(
 			const float blf, const float tlf,
@@ -148,14 +220,14 @@ namespace utils {
 		) {
 			values[0] = blf; values[1] = brf; values[2] = brb; values[3] = blb;
 			values[4] = tlf; values[5] = trf; values[6] = trb; values[7] = tlb;
-			points[0] = Vector3D<>(0, 0, 0);
-			points[1] = Vector3D<>(1, 0, 0);
-			points[2] = Vector3D<>(1, 1, 0);
-			points[3] = Vector3D<>(0, 1, 0);
-			points[4] = Vector3D<>(0, 0, 1);
-			points[5] = Vector3D<>(1, 0, 1);
-			points[6] = Vector3D<>(1, 1, 1);
-			points[7] = Vector3D<>(0, 1, 1);
+			points[0] = Vector3D<float>(0, 0, 0);
+			points[1] = Vector3D<float>(1, 0, 0);
+			points[2] = Vector3D<float>(1, 1, 0);
+			points[3] = Vector3D<float>(0, 1, 0);
+			points[4] = Vector3D<float>(0, 0, 1);
+			points[5] = Vector3D<float>(1, 0, 1);
+			points[6] = Vector3D<float>(1, 1, 1);
+			points[7] = Vector3D<float>(0, 1, 1);
 		}
 
 		inline float Sum() const {
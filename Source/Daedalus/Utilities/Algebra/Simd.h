@@ -0,0 +1,11 @@
+#pragma once
+
+/**
+ * Picks the instruction set used by the single precision vector specializations. SSE2 is
+ * part of every x64 target; define DAEDALUS_NO_SIMD to fall back to the generic templates.
+ */
+#if !defined(DAEDALUS_NO_SIMD) && \
+	(defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	#define DAEDALUS_SIMD_SSE
+	#include <emmintrin.h>
+#endif
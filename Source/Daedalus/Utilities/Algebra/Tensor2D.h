@@ -2,7 +2,17 @@
 
 #include <Utilities/Algebra/Vector2D.h>
 
+#include <array>
 #include <vector>
+#include <sstream>
+
+#ifndef DAEDALUS_TENSOR_BOUNDS_CHECK
+	#ifdef NDEBUG
+		#define DAEDALUS_TENSOR_BOUNDS_CHECK 0
+	#else
+		#define DAEDALUS_TENSOR_BOUNDS_CHECK 1
+	#endif
+#endif
 
 namespace utils {
 	template <typename T>
@@ -47,15 +57,15 @@ namespace utils {
 		{}
 
 		const T & Get(const size_t x, const size_t y) const {
-			return this->Data.at(x * this->Width + y);
+			return this->Data.at(x * this->Depth + y);
 		}
 
 		T & Get(const size_t x, const size_t y) {
-			return this->Data.at(x * this->Width + y);
+			return this->Data.at(x * this->Depth + y);
 		}
 
 		void Set(const size_t x, const size_t y, const T & value) {
-			this->Data[x * this->Width + y] = value;
+			this->Data[x * this->Depth + y] = value;
 		}
 
 		void Fill(const T & value) {
@@ -82,11 +92,11 @@ namespace utils {
 		{}
 
 		bool Get(const size_t x, const size_t y) const {
-			return this->Data.at(x * this->Width + y);
+			return this->Data.at(x * this->Depth + y);
 		}
 
 		void Set(const size_t x, const size_t y, const bool value) {
-			this->Data[x * this->Width + y] = value;
+			this->Data[x * this->Depth + y] = value;
 		}
 
 		void Fill(const bool value) {
@@ -122,10 +132,44 @@ namespace utils {
 
 
 	
-	template <typename T, size_t S>
-	class TensorFixed2D : public Tensor2D<T> {
+	/**
+	 * Tensor with its size fixed at compile time, stored inline so it never allocates.
+	 */
+	template <typename T, size_t W, size_t D = W>
+	class TensorFixed2D {
 	public:
-		TensorFixed2D() : Tensor2D<T>(S) {}
-		TensorFixed2D(const T & value) : Tensor2D<T>(S, S, value) {}
+		static const size_t WIDTH = W;      // X
+		static const size_t DEPTH = D;      // Y
+
+	private:
+		std::array<T, W * D> Data;
+
+		static inline size_t IndexOf(const size_t x, const size_t y) {
+#if DAEDALUS_TENSOR_BOUNDS_CHECK
+			if (x >= W || y >= D) {
+				std::stringstream ss;
+				ss << "TensorFixed2D::IndexOf: Index (" << x << ", " << y <<
+					") is out of bounds (" << W << ", " << D << ").";
+				throw StringException(ss.str());
+			}
+#endif
+			return x * D + y;
+		}
+
+	public:
+		TensorFixed2D() : Data() {}
+		TensorFixed2D(const T & value) { Data.fill(value); }
+
+		static inline size_t GetWidth() { return W; }
+		static inline size_t GetDepth() { return D; }
+
+		inline const T & Get(const size_t x, const size_t y) const { return Data[IndexOf(x, y)]; }
+		inline T & Get(const size_t x, const size_t y) { return Data[IndexOf(x, y)]; }
+
+		inline void Set(const size_t x, const size_t y, const T & value) {
+			Data[IndexOf(x, y)] = value;
+		}
+
+		void Fill(const T & value) { Data.fill(value); }
 	};
 }
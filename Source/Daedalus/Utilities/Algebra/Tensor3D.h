@@ -2,12 +2,160 @@
 
 #include <Utilities/Algebra/Vector3D.h>
 
-#include <cassert>
+#include <algorithm>
+#include <array>
 #include <vector>
 #include <sstream>
 
+// Bounds checks on tensor accesses are only done in debug builds, define this as 1 to force
+// them on in release builds
+#ifndef DAEDALUS_TENSOR_BOUNDS_CHECK
+	#ifdef NDEBUG
+		#define DAEDALUS_TENSOR_BOUNDS_CHECK 0
+	#else
+		#define DAEDALUS_TENSOR_BOUNDS_CHECK 1
+	#endif
+#endif
+
 namespace utils {
-	template<typename T>
+	/**
+	 * Storage layouts for Tensor3D. Each layout maps an (x, y, z) coordinate to an index into
+	 * the flat storage, and reports how much storage a tensor of a given size needs. Tile is
+	 * the edge length of the blocks that are contiguous in storage, which iteration follows.
+	 */
+
+	/**
+	 * Row major layout with z varying fastest.
+	 */
+	struct LinearLayout {
+		static const Uint32 TILE_SIZE = 1;
+
+		static inline Uint64 Capacity(const Uint32 width, const Uint32 depth, const Uint32 height) {
+			return (Uint64) width * depth * height;
+		}
+
+		static inline Uint64 Index(
+			const Uint32 x, const Uint32 y, const Uint32 z,
+			const Uint32 width, const Uint32 depth, const Uint32 height
+		) {
+			return ((Uint64) x * depth + y) * height + z;
+		}
+
+		/**
+		 * Indices of the 8 corners of the cell at (x, y, z), ordered by x << 2 | y << 1 | z.
+		 */
+		static inline void CornerIndices(
+			const Uint32 x, const Uint32 y, const Uint32 z,
+			const Uint32 width, const Uint32 depth, const Uint32 height,
+			Uint64 (&indices)[8]
+		) {
+			const Uint64 base = Index(x, y, z, width, depth, height);
+			const Uint64 dy = height;
+			const Uint64 dx = (Uint64) depth * height;
+			indices[0] = base;           indices[1] = base + 1;
+			indices[2] = base + dy;      indices[3] = base + dy + 1;
+			indices[4] = base + dx;      indices[5] = base + dx + 1;
+			indices[6] = base + dx + dy; indices[7] = base + dx + dy + 1;
+		}
+	};
+
+	/**
+	 * Stores the tensor as 4x4x4 bricks of 64 contiguous elements, so that every cell of a
+	 * brick and most cell neighbourhoods share a couple of cache lines.
+	 */
+	struct BrickedLayout {
+		static const Uint32 TILE_SIZE = 4;
+
+		static inline Uint32 BrickCount(const Uint32 size) { return (size + 3) >> 2; }
+
+		static inline Uint64 Capacity(const Uint32 width, const Uint32 depth, const Uint32 height) {
+			return (Uint64) BrickCount(width) * BrickCount(depth) * BrickCount(height) * 64;
+		}
+
+		static inline Uint64 Index(
+			const Uint32 x, const Uint32 y, const Uint32 z,
+			const Uint32 width, const Uint32 depth, const Uint32 height
+		) {
+			const Uint64 brick =
+				((Uint64) (x >> 2) * BrickCount(depth) + (y >> 2)) * BrickCount(height) + (z >> 2);
+			return brick << 6 | (x & 3) << 4 | (y & 3) << 2 | (z & 3);
+		}
+
+		static inline void CornerIndices(
+			const Uint32 x, const Uint32 y, const Uint32 z,
+			const Uint32 width, const Uint32 depth, const Uint32 height,
+			Uint64 (&indices)[8]
+		) {
+			if ((x & 3) < 3 && (y & 3) < 3 && (z & 3) < 3) {
+				// All corners are in the same brick
+				const Uint64 base = Index(x, y, z, width, depth, height);
+				indices[0] = base;      indices[1] = base + 1;
+				indices[2] = base + 4;  indices[3] = base + 5;
+				indices[4] = base + 16; indices[5] = base + 17;
+				indices[6] = base + 20; indices[7] = base + 21;
+				return;
+			}
+			for (Uint8 i = 0; i < 8; i++)
+				indices[i] = Index(x + (i >> 2), y + (i >> 1 & 1), z + (i & 1), width, depth, height);
+		}
+	};
+
+	/**
+	 * Z-order layout, interleaving the bits of the coordinates. Every aligned power of two
+	 * block is contiguous. Works best for cubic tensors with a power of two size, other sizes
+	 * leave holes in the storage.
+	 */
+	struct MortonLayout {
+		static const Uint32 TILE_SIZE = 4;
+
+		static inline Uint64 SpreadBits(Uint64 value) {
+			value &= 0x1fffff;
+			value = (value | value << 32) & 0x1f00000000ffffULL;
+			value = (value | value << 16) & 0x1f0000ff0000ffULL;
+			value = (value | value << 8) & 0x100f00f00f00f00fULL;
+			value = (value | value << 4) & 0x10c30c30c30c30c3ULL;
+			value = (value | value << 2) & 0x1249249249249249ULL;
+			return value;
+		}
+
+		static inline Uint64 Encode(const Uint32 x, const Uint32 y, const Uint32 z) {
+			return SpreadBits(x) << 2 | SpreadBits(y) << 1 | SpreadBits(z);
+		}
+
+		static inline Uint64 Capacity(const Uint32 width, const Uint32 depth, const Uint32 height) {
+			// The encoding is monotonic along each axis, so the far corner has the largest index
+			if (width == 0 || depth == 0 || height == 0)
+				return 0;
+			return Encode(width - 1, depth - 1, height - 1) + 1;
+		}
+
+		static inline Uint64 Index(
+			const Uint32 x, const Uint32 y, const Uint32 z,
+			const Uint32 width, const Uint32 depth, const Uint32 height
+		) {
+			return Encode(x, y, z);
+		}
+
+		static inline void CornerIndices(
+			const Uint32 x, const Uint32 y, const Uint32 z,
+			const Uint32 width, const Uint32 depth, const Uint32 height,
+			Uint64 (&indices)[8]
+		) {
+			if ((x & 1) == 0 && (y & 1) == 0 && (z & 1) == 0) {
+				// The cell starts an aligned 2x2x2 block, which is 8 contiguous elements
+				const Uint64 base = Encode(x, y, z);
+				for (Uint8 i = 0; i < 8; i++)
+					indices[i] = base + i;
+				return;
+			}
+			for (Uint8 i = 0; i < 8; i++)
+				indices[i] = Encode(x + (i >> 2), y + (i >> 1 & 1), z + (i & 1));
+		}
+	};
+
+
+
+	template <typename T, typename Layout = LinearLayout>
 	class Tensor3DBase {
 	protected:
 		std::vector<T> Data;
@@ -15,30 +163,41 @@ namespace utils {
 		Uint32 Depth;       // Y
 		Uint32 Height;      // Z
 
+		void ThrowOutOfBounds(const Uint32 w, const Uint32 d, const Uint32 h) const {
+			std::stringstream ss;
+			ss << "Tensor3DBase::CheckBounded: Index (" << w << ", " << d << ", " << h <<
+				") is out of bounds (" << Width << ", " << Depth << ", " << Height << ").";
+			throw StringException(ss.str());
+		}
+
 		inline void CheckBounded(const Uint32 w, const Uint32 d, const Uint32 h) const {
-			if (w < 0 && w >= Width) {
-				std::stringstream ss;
-				ss << "Tensor3DBase::CheckBounded: Width `" << w <<
-					"` is out of bounds [0, " << Width << ").";
-				throw StringException(ss.str());
-			}
-			if (h < 0 && h >= Height) {
-				std::stringstream ss;
-				ss << "Tensor3DBase::CheckBounded: Height `" << h <<
-					"` is out of bounds [0, " << Height << ").";
-				throw StringException(ss.str());
-			}
-			if (d < 0 && d >= Depth) {
-				std::stringstream ss;
-				ss << "Tensor3DBase::CheckBounded: Depth `" << d <<
-					"` is out of bounds [0, " << Depth << ").";
-				throw StringException(ss.str());
-			}
+			if (w >= Width || d >= Depth || h >= Height)
+				ThrowOutOfBounds(w, d, h);
+		}
+
+		inline Uint64 IndexOf(const Uint32 x, const Uint32 y, const Uint32 z) const {
+#if DAEDALUS_TENSOR_BOUNDS_CHECK
+			CheckBounded(x, y, z);
+#endif
+			return Layout::Index(x, y, z, Width, Depth, Height);
+		}
+
+		inline void CornerIndicesOf(
+			const Uint32 x, const Uint32 y, const Uint32 z,
+			Uint64 (&indices)[8]
+		) const {
+#if DAEDALUS_TENSOR_BOUNDS_CHECK
+			CheckBounded(x, y, z);
+			CheckBounded(x + 1, y + 1, z + 1);
+#endif
+			Layout::CornerIndices(x, y, z, Width, Depth, Height, indices);
 		}
 
 	public:
+		using LayoutType = Layout;
+
 		explicit Tensor3DBase() : Tensor3DBase(0, 0, 0) {}
-		explicit Tensor3DBase(const Uint32 size) : Tensor3DBase<T>(size, size, size) {}
+		explicit Tensor3DBase(const Uint32 size) : Tensor3DBase(size, size, size) {}
 		explicit Tensor3DBase(const Vector3D<Uint32> & size) :
 			Tensor3DBase(size.X, size.Y, size.Z)
 		{}
@@ -46,10 +205,12 @@ namespace utils {
 			Tensor3DBase(size.X, size.Y, size.Z, value)
 		{}
 		Tensor3DBase(const Uint32 width, const Uint32 depth, const Uint32 height) :
-			Width(width), Height(height), Depth(depth), Data(width * height * depth)
+			Data(Layout::Capacity(width, depth, height)),
+			Width(width), Depth(depth), Height(height)
 		{}
 		Tensor3DBase(const Uint32 width, const Uint32 depth, const Uint32 height, const T & value) :
-			Width(width), Height(height), Depth(depth), Data(width * height * depth, value)
+			Data(Layout::Capacity(width, depth, height), value),
+			Width(width), Depth(depth), Height(height)
 		{}
 
 		Uint32 GetWidth() const { return Width; }
@@ -60,120 +221,242 @@ namespace utils {
 
 
 
-	template <typename T>
-	class Tensor3D : public Tensor3DBase<T> {
+	/**
+	 * Dense 3D array of values. The storage layout is chosen with the Layout parameter,
+	 * accesses are bounds checked in debug builds only.
+	 */
+	template <typename T, typename Layout = LinearLayout>
+	class Tensor3D : public Tensor3DBase<T, Layout> {
 	public:
-		explicit Tensor3D() : Tensor3DBase<T>(0, 0, 0) {}
-		explicit Tensor3D(const Uint32 size) : Tensor3DBase<T>(size, size, size) {}
+		// std::vector<bool> hands out proxies instead of references
+		using Reference = typename std::vector<T>::reference;
+		using ConstReference = typename std::vector<T>::const_reference;
+
+		explicit Tensor3D() : Tensor3DBase<T, Layout>(0, 0, 0) {}
+		explicit Tensor3D(const Uint32 size) : Tensor3DBase<T, Layout>(size, size, size) {}
 		explicit Tensor3D(const Vector3D<Uint32> & size) :
-			Tensor3DBase<T>(size.X, size.Y, size.Z)
+			Tensor3DBase<T, Layout>(size.X, size.Y, size.Z)
 		{}
 		Tensor3D(const Vector3D<Uint32> & size, const T & value) :
-			Tensor3DBase<T>(size.X, size.Y, size.Z, value)
+			Tensor3DBase<T, Layout>(size.X, size.Y, size.Z, value)
 		{}
 		Tensor3D(const Uint32 width, const Uint32 depth, const Uint32 height) :
-			Tensor3DBase<T>(width, height, depth)
+			Tensor3DBase<T, Layout>(width, depth, height)
 		{}
 		Tensor3D(const Uint32 width, const Uint32 depth, const Uint32 height, const T & value) :
-			Tensor3DBase<T>(width, height, depth, value)
+			Tensor3DBase<T, Layout>(width, depth, height, value)
 		{}
 
-		const T & Get(const Uint32 & x, const Uint32 & y, const Uint32 & z) const {
-			this->CheckBounded(x, y, z);
-			return this->Data[(x * this->Width + y) * this->Height + z];
+		inline ConstReference Get(const Uint32 x, const Uint32 y, const Uint32 z) const {
+			return this->Data[this->IndexOf(x, y, z)];
 		}
 
-		T & Get(const Uint32 & x, const Uint32 & y, const Uint32 & z) {
-			this->CheckBounded(x, y, z);
-			return this->Data[(x * this->Width + y) * this->Height + z];
+		inline Reference Get(const Uint32 x, const Uint32 y, const Uint32 z) {
+			return this->Data[this->IndexOf(x, y, z)];
 		}
 
-		const T & Get(const Vector3D<Uint32> & vec) const { return Get(vec.X, vec.Y, vec.Z); }
-		T & Get(const Vector3D<Uint32> & vec) { return Get(vec.X, vec.Y, vec.Z); }
+		inline ConstReference Get(const Vector3D<Uint32> & vec) const { return Get(vec.X, vec.Y, vec.Z); }
+		inline Reference Get(const Vector3D<Uint32> & vec) { return Get(vec.X, vec.Y, vec.Z); }
+
+		inline void Set(const Uint32 x, const Uint32 y, const Uint32 z, const T & value) {
+			this->Data[this->IndexOf(x, y, z)] = value;
+		}
 
-		void Set(const Uint32 & x, const Uint32 & y, const Uint32 & z, const T & value) {
-			this->CheckBounded(x, y, z);
-			this->Data[(x * this->Width + y) * this->Height + z] = value;
+		/**
+		 * Reads the 8 corners of the cell at (x, y, z), which span (x, y, z) to
+		 * (x + 1, y + 1, z + 1). The corners are ordered by x << 2 | y << 1 | z, which is the
+		 * argument order of GridCell::Initialize.
+		 */
+		inline std::array<T, 8> GetCorners(const Uint32 x, const Uint32 y, const Uint32 z) const {
+			Uint64 indices[8];
+			this->CornerIndicesOf(x, y, z, indices);
+			std::array<T, 8> corners;
+			for (Uint8 i = 0; i < 8; i++)
+				corners[i] = this->Data[indices[i]];
+			return corners;
 		}
 
 		void Fill(const T & value) {
-			this->Data.assign(this->Width * this->Height * this->Depth, value);
+			this->Data.assign(this->Data.size(), value);
 		}
-	};
 
+		/**
+		 * Raw storage, laid out as described by Layout. Meant for kernels that compute
+		 * indices themselves.
+		 */
+		inline T * GetData() { return this->Data.data(); }
+		inline const T * GetData() const { return this->Data.data(); }
 
-	
-	// Specialization for Tensor3D<bool> because vector<bool> has a special implementation
-	template <>
-	class Tensor3D<bool> : public Tensor3DBase<bool> {
-	public:
-		Tensor3D() : Tensor3DBase(0, 0, 0) {}
-		Tensor3D(const Vector3D<Uint32> & size) : Tensor3DBase(size.X, size.Y, size.Z) {}
-		Tensor3D(const Vector3D<Uint32> & size, const bool value) :
-			Tensor3DBase(size.X, size.Y, size.Z, value)
-		{}
-		Tensor3D(const Uint32 width, const Uint32 depth, const Uint32 height) :
-			Tensor3DBase(width, height, depth)
-		{}
-		Tensor3D(const Uint32 width, const Uint32 depth, const Uint32 height, const bool value) :
-			Tensor3DBase(width, height, depth, value)
-		{}
+		/**
+		 * Calls visitor(x, y, z, value) for every element in the range [min, max). The
+		 * range is walked tile by tile in the order of the storage layout. A range that is one
+		 * element thick along an axis visits a slice of the tensor.
+		 */
+		template <typename V>
+		void ForEachInRange(const Vector3D<Uint32> & min, const Vector3D<Uint32> & max, V visitor) {
+			ForEachInRangeImpl(*this, min, max, visitor);
+		}
 
-		bool Get(const Uint32 & x, const Uint32 & y, const Uint32 & z) const {
-			CheckBounded(x, y, z);
-			return this->Data[(x * this->Width + y) * this->Height + z];
+		template <typename V>
+		void ForEachInRange(
+			const Vector3D<Uint32> & min,
+			const Vector3D<Uint32> & max,
+			V visitor
+		) const {
+			ForEachInRangeImpl(*this, min, max, visitor);
 		}
 
-		bool Get(const Vector3D<Uint32> & vec) const { return Get(vec.X, vec.Y, vec.Z); }
+		/**
+		 * Calls visitor(x, y, z, value) for every element, see ForEachInRange.
+		 */
+		template <typename V>
+		void ForEach(V visitor) { ForEachInRange(Vector3D<Uint32>(0), this->Size(), visitor); }
 
-		void Set(const Uint32 & x, const Uint32 & y, const Uint32 & z, const bool value) {
-			CheckBounded(x, y, z);
-			this->Data[(x * this->Width + y) * this->Height + z] = value;
-		}
+		template <typename V>
+		void ForEach(V visitor) const { ForEachInRange(Vector3D<Uint32>(0), this->Size(), visitor); }
 
-		void Fill(const bool value) {
-			this->Data.assign(this->Width * this->Height * this->Depth, value);
+	private:
+		template <typename S, typename V>
+		static void ForEachInRangeImpl(
+			S & tensor,
+			const Vector3D<Uint32> & min,
+			const Vector3D<Uint32> & max,
+			V & visitor
+		) {
+			const Uint32 tile = Layout::TILE_SIZE;
+			const Vector3D<Uint32> end(
+				std::min(max.X, tensor.Width), std::min(max.Y, tensor.Depth), std::min(max.Z, tensor.Height));
+			for (Uint32 tx = min.X; tx < end.X; tx = (tx / tile + 1) * tile) {
+				const Uint32 ex = std::min(end.X, (tx / tile + 1) * tile);
+				for (Uint32 ty = min.Y; ty < end.Y; ty = (ty / tile + 1) * tile) {
+					const Uint32 ey = std::min(end.Y, (ty / tile + 1) * tile);
+					for (Uint32 tz = min.Z; tz < end.Z; tz = (tz / tile + 1) * tile) {
+						const Uint32 ez = std::min(end.Z, (tz / tile + 1) * tile);
+						for (Uint32 x = tx; x < ex; x++) {
+							for (Uint32 y = ty; y < ey; y++) {
+								for (Uint32 z = tz; z < ez; z++) {
+									visitor(x, y, z, tensor.Data[Layout::Index(
+										x, y, z, tensor.Width, tensor.Depth, tensor.Height)]);
+								}
+							}
+						}
+					}
+				}
+			}
 		}
 	};
 
 
 
-	template <typename T>
-	class TensorResizable3D : public Tensor3D<T> {
+	template <typename T, typename Layout = LinearLayout>
+	class TensorResizable3D : public Tensor3D<T, Layout> {
 	public:
-		TensorResizable3D() : Tensor3D<T>(0, 0, 0) {}
-		TensorResizable3D(const Vector3D<Uint32> & size) : Tensor3D<T>(size.X, size.Y, size.Z) {}
+		TensorResizable3D() : Tensor3D<T, Layout>(0, 0, 0) {}
+		TensorResizable3D(const Vector3D<Uint32> & size) : Tensor3D<T, Layout>(size.X, size.Y, size.Z) {}
 		TensorResizable3D(const Vector3D<Uint32> & size, const T & value) :
-			Tensor3D<T>(size.X, size.Y, size.Z, value)
+			Tensor3D<T, Layout>(size.X, size.Y, size.Z, value)
 		{}
 		TensorResizable3D(const Uint32 width, const Uint32 depth, const Uint32 height) :
-			Tensor3D<T>(width, height, depth)
+			Tensor3D<T, Layout>(width, depth, height)
 		{}
 		TensorResizable3D(
 			const Uint32 width, const Uint32 depth,
 			const Uint32 height, const T & value
-		) : Tensor3D<T>(width, height, depth, value)
+		) : Tensor3D<T, Layout>(width, depth, height, value)
 		{}
 
+		/**
+		 * Resizes the tensor, all elements are set to the given value.
+		 */
 		TensorResizable3D & Reset(
-			const Uint32 Width, const Uint32 Height,
-			const Uint32 Depth, const T & value
+			const Uint32 width, const Uint32 depth,
+			const Uint32 height, const T & value
 		) {
-			this->Width = Width;
-			this->Height = Height;
-			this->Depth = Depth;
-			this->Data.resize(Width * Height * Depth, value);
+			this->Width = width;
+			this->Depth = depth;
+			this->Height = height;
+			this->Data.assign(Layout::Capacity(width, depth, height), value);
 
 			return *this;
 		}
 	};
 
 
-	
-	template <typename T, Uint32 S>
-	class TensorFixed3D : public Tensor3D<T> {
+
+	/**
+	 * Tensor with its size fixed at compile time. The elements are stored inline in linear
+	 * layout, so it never allocates and all index math uses constant extents.
+	 */
+	template <typename T, Uint32 W, Uint32 D = W, Uint32 H = W>
+	class TensorFixed3D {
+	public:
+		static const Uint32 WIDTH = W;      // X
+		static const Uint32 DEPTH = D;      // Y
+		static const Uint32 HEIGHT = H;     // Z
+		static const Uint32 COUNT = W * D * H;
+
+	private:
+		std::array<T, COUNT> Data;
+
+		static inline Uint32 IndexOf(const Uint32 x, const Uint32 y, const Uint32 z) {
+#if DAEDALUS_TENSOR_BOUNDS_CHECK
+			if (x >= W || y >= D || z >= H) {
+				std::stringstream ss;
+				ss << "TensorFixed3D::IndexOf: Index (" << x << ", " << y << ", " << z <<
+					") is out of bounds (" << W << ", " << D << ", " << H << ").";
+				throw StringException(ss.str());
+			}
+#endif
+			return (x * D + y) * H + z;
+		}
+
 	public:
-		TensorFixed3D() : Tensor3D<T>(S) {}
-		TensorFixed3D(const T & value) : Tensor3D<T>(S, S, S, value) {}
+		TensorFixed3D() : Data() {}
+		TensorFixed3D(const T & value) { Data.fill(value); }
+
+		static inline Uint32 GetWidth() { return W; }
+		static inline Uint32 GetDepth() { return D; }
+		static inline Uint32 GetHeight() { return H; }
+		static inline Vector3D<Uint32> Size() { return Vector3D<Uint32>(W, D, H); }
+
+		inline const T & Get(const Uint32 x, const Uint32 y, const Uint32 z) const {
+			return Data[IndexOf(x, y, z)];
+		}
+
+		inline T & Get(const Uint32 x, const Uint32 y, const Uint32 z) {
+			return Data[IndexOf(x, y, z)];
+		}
+
+		inline const T & Get(const Vector3D<Uint32> & vec) const { return Get(vec.X, vec.Y, vec.Z); }
+		inline T & Get(const Vector3D<Uint32> & vec) { return Get(vec.X, vec.Y, vec.Z); }
+
+		inline void Set(const Uint32 x, const Uint32 y, const Uint32 z, const T & value) {
+			Data[IndexOf(x, y, z)] = value;
+		}
+
+		/**
+		 * Reads the 8 corners of the cell at (x, y, z), see Tensor3D::GetCorners.
+		 */
+		inline std::array<T, 8> GetCorners(const Uint32 x, const Uint32 y, const Uint32 z) const {
+			const Uint32 base = IndexOf(x, y, z);
+#if DAEDALUS_TENSOR_BOUNDS_CHECK
+			IndexOf(x + 1, y + 1, z + 1);
+#endif
+			const Uint32 dy = H;
+			const Uint32 dx = D * H;
+			std::array<T, 8> corners = {{
+				Data[base], Data[base + 1], Data[base + dy], Data[base + dy + 1],
+				Data[base + dx], Data[base + dx + 1], Data[base + dx + dy], Data[base + dx + dy + 1]
+			}};
+			return corners;
+		}
+
+		void Fill(const T & value) { Data.fill(value); }
+
+		/**
+		 * Raw storage in linear layout, see Tensor3D::GetData.
+		 */
+		inline T * GetData() { return Data.data(); }
+		inline const T * GetData() const { return Data.data(); }
 	};
 }
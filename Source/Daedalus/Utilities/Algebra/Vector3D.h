@@ -3,6 +3,7 @@
 #include <Utilities/DataStructures.h>
 #include <Utilities/Algebra/Vector2D.h>
 #include <Utilities/Algebra/Algebra.h>
+#include <Utilities/Algebra/Simd.h>
 
 #include <cassert>
 #include <functional>
@@ -44,7 +45,7 @@ namespace utils {
 			const bool isMinIncluded = true,
 			const bool isMaxIncluded = false
 		) const {
-			if (isMinIncluded && (X < min.X || Y < min.Z || Z < min.Z) ||
+			if (isMinIncluded && (X < min.X || Y < min.Y || Z < min.Z) ||
 				!isMinIncluded && (X <= min.X || Y <= min.Y || Z <= min.Z)) return false;
 			
 			if (isMaxIncluded && (X > max.X || Y > max.Y || Z > max.Z) ||
@@ -63,6 +64,8 @@ namespace utils {
 		/**
 		 * Cross product.
 		 */
+		inline Vector3D<T> Cross(const Vector3D<T> & other) const { return Cross<T, T>(other); }
+
 		template <typename T1, typename T2>
 		inline Vector3D<T1> Cross(const Vector3D<T2> other) const {
 			return Vector3D<T1>(
@@ -160,6 +163,207 @@ namespace utils {
 			return *this;
 		}
 	};
+
+#ifdef DAEDALUS_SIMD_SSE
+	/**
+	 * Single precision vector backed by an SSE register. It has the same members and operators
+	 * as the generic vector, with a fourth padding lane so that a vector loads in a single
+	 * instruction. The padding lane holds no meaningful value and is ignored by every
+	 * horizontal operation and comparison. Loads and stores are unaligned, which keeps the
+	 * type usable in standard containers.
+	 */
+	template <>
+	struct Vector3D<float> {
+		float X, Y, Z;
+		float Pad;
+
+		explicit Vector3D() : Pad(0) {}
+		explicit Vector3D(const float & v) : X(v), Y(v), Z(v), Pad(0) {}
+		Vector3D(const float & x, const float & y, const float & z) : X(x), Y(y), Z(z), Pad(0) {}
+		Vector3D(const Vector2D<float> & vec) : Vector3D(vec.X, vec.Y, 0) {}
+		Vector3D(const Vector2D<float> & vec, const float z) : Vector3D(vec.X, vec.Y, z) {}
+
+		inline __m128 GetLanes() const { return _mm_loadu_ps(&X); }
+
+		static inline Vector3D<float> FromLanes(const __m128 lanes) {
+			Vector3D<float> result;
+			_mm_storeu_ps(&result.X, lanes);
+			return result;
+		}
+
+		bool IsBoundedBy(
+			const float min, const float max,
+			const bool isMinIncluded = true,
+			const bool isMaxIncluded = false
+		) const {
+			return IsBoundedBy(Vector3D<float>(min), Vector3D<float>(max), isMinIncluded, isMaxIncluded);
+		}
+
+		bool IsBoundedBy(
+			const Vector3D<float> & min, const Vector3D<float> & max,
+			const bool isMinIncluded = true,
+			const bool isMaxIncluded = false
+		) const {
+			const __m128 lanes = GetLanes();
+			const __m128 aboveMin = isMinIncluded ?
+				_mm_cmpge_ps(lanes, min.GetLanes()) : _mm_cmpgt_ps(lanes, min.GetLanes());
+			const __m128 belowMax = isMaxIncluded ?
+				_mm_cmple_ps(lanes, max.GetLanes()) : _mm_cmplt_ps(lanes, max.GetLanes());
+			return (_mm_movemask_ps(_mm_and_ps(aboveMin, belowMax)) & 7) == 7;
+		}
+
+		/**
+		 * Dot product. The lanes are summed in the same order as the generic version.
+		 */
+		inline float Dot(const Vector3D<float> & other) const {
+			const __m128 product = _mm_mul_ps(GetLanes(), other.GetLanes());
+			const __m128 xy = _mm_add_ss(
+				product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(1, 1, 1, 1)));
+			return _mm_cvtss_f32(_mm_add_ss(xy, _mm_movehl_ps(product, product)));
+		}
+
+		/**
+		 * Cross product.
+		 */
+		inline Vector3D<float> Cross(const Vector3D<float> & other) const {
+			const __m128 a = GetLanes(), b = other.GetLanes();
+			const __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+			const __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+			const __m128 aZXY = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+			const __m128 bZXY = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+			return FromLanes(_mm_sub_ps(_mm_mul_ps(aYZX, bZXY), _mm_mul_ps(aZXY, bYZX)));
+		}
+
+		template <typename T1, typename T2>
+		inline Vector3D<T1> Cross(const Vector3D<T2> other) const {
+			return Vector3D<T1>(
+				Y * other.Z - Z * other.Y,
+				Z * other.X - X * other.Z,
+				X * other.Y - Y * other.X);
+		}
+
+		inline void Reset(float x, float y, float z) { X = x; Y = y; Z = z; }
+		inline void Reset(const Vector2D<float> & vec, float z) { X = vec.X; Y = vec.Y; Z = z; }
+
+		/** Length squared. */
+		inline float Length2() const { return Dot(*this); }
+		inline float Length() const { return std::sqrt(Length2()); }
+
+		inline bool IsNormal() const { return std::abs(Length2() - 1) <= FLOAT_ERROR; }
+
+		/**
+		 * Unlike the generic version this stays in single precision.
+		 */
+		inline Vector3D<float> Normalize() const {
+			const float length2 = Length2();
+			if (EEq(length2, 1))
+				return *this;
+			return FromLanes(_mm_div_ps(GetLanes(), _mm_set1_ps(std::sqrt(length2))));
+		}
+
+		inline Vector2D<float> Truncate() const { return Vector2D<float>(X, Y); }
+
+		template <typename T1>
+		inline Vector3D<T1> Cast() const {
+			return Vector3D<T1>((T1) this->X, (T1) this->Y, (T1) this->Z);
+		}
+
+		inline float & operator [] (const Uint64 index) {
+			switch (index) {
+			case 0: return X;
+			case 1: return Y;
+			case 2: return Z;
+			default:
+				std::stringstream ss;
+				ss << "Vector3D::[]: Invalid index value `" << index << "`.";
+				throw StringException(ss.str());
+			}
+		}
+
+		inline const float & operator [] (const Uint64 index) const {
+			switch (index) {
+			case 0: return X;
+			case 1: return Y;
+			case 2: return Z;
+			default:
+				std::stringstream ss;
+				ss << "Vector3D::[]: Invalid index value `" << index << "`.";
+				throw StringException(ss.str());
+			}
+		}
+
+		inline Vector3D<float> & operator += (const Vector3D<float> & rhs) {
+			return *this = FromLanes(_mm_add_ps(GetLanes(), rhs.GetLanes()));
+		}
+		inline Vector3D<float> & operator -= (const Vector3D<float> & rhs) {
+			return *this = FromLanes(_mm_sub_ps(GetLanes(), rhs.GetLanes()));
+		}
+		inline Vector3D<float> & operator *= (const Vector3D<float> & rhs) {
+			return *this = FromLanes(_mm_mul_ps(GetLanes(), rhs.GetLanes()));
+		}
+		inline Vector3D<float> & operator /= (const Vector3D<float> & rhs) {
+			return *this = FromLanes(_mm_div_ps(GetLanes(), rhs.GetLanes()));
+		}
+
+		inline Vector3D<float> & operator += (const float & rhs) {
+			return *this = FromLanes(_mm_add_ps(GetLanes(), _mm_set1_ps(rhs)));
+		}
+		inline Vector3D<float> & operator -= (const float & rhs) {
+			return *this = FromLanes(_mm_sub_ps(GetLanes(), _mm_set1_ps(rhs)));
+		}
+		inline Vector3D<float> & operator *= (const float & rhs) {
+			return *this = FromLanes(_mm_mul_ps(GetLanes(), _mm_set1_ps(rhs)));
+		}
+		inline Vector3D<float> & operator /= (const float & rhs) {
+			return *this = FromLanes(_mm_div_ps(GetLanes(), _mm_set1_ps(rhs)));
+		}
+	};
+
+	/**
+	 * The generic operator templates in Algebra3D.h would work on the specialization one lane
+	 * at a time, so these overloads take precedence over them.
+	 */
+
+	inline Vector3D<float> operator - (const Vector3D<float> & lhs) {
+		return Vector3D<float>::FromLanes(_mm_sub_ps(_mm_setzero_ps(), lhs.GetLanes()));
+	}
+
+	inline Vector3D<float> operator + (const Vector3D<float> & lhs, const Vector3D<float> & rhs) {
+		return Vector3D<float>::FromLanes(_mm_add_ps(lhs.GetLanes(), rhs.GetLanes()));
+	}
+
+	inline Vector3D<float> operator - (const Vector3D<float> & lhs, const Vector3D<float> & rhs) {
+		return Vector3D<float>::FromLanes(_mm_sub_ps(lhs.GetLanes(), rhs.GetLanes()));
+	}
+
+	inline Vector3D<float> operator * (const Vector3D<float> & lhs, const Vector3D<float> & rhs) {
+		return Vector3D<float>::FromLanes(_mm_mul_ps(lhs.GetLanes(), rhs.GetLanes()));
+	}
+
+	inline Vector3D<float> operator / (const Vector3D<float> & lhs, const Vector3D<float> & rhs) {
+		return Vector3D<float>::FromLanes(_mm_div_ps(lhs.GetLanes(), rhs.GetLanes()));
+	}
+
+	inline Vector3D<float> operator + (const Vector3D<float> & lhs, const float & rhs) {
+		return Vector3D<float>::FromLanes(_mm_add_ps(lhs.GetLanes(), _mm_set1_ps(rhs)));
+	}
+
+	inline Vector3D<float> operator - (const Vector3D<float> & lhs, const float & rhs) {
+		return Vector3D<float>::FromLanes(_mm_sub_ps(lhs.GetLanes(), _mm_set1_ps(rhs)));
+	}
+
+	inline Vector3D<float> operator * (const Vector3D<float> & lhs, const float & rhs) {
+		return Vector3D<float>::FromLanes(_mm_mul_ps(lhs.GetLanes(), _mm_set1_ps(rhs)));
+	}
+
+	inline Vector3D<float> operator / (const Vector3D<float> & lhs, const float & rhs) {
+		return Vector3D<float>::FromLanes(_mm_div_ps(lhs.GetLanes(), _mm_set1_ps(rhs)));
+	}
+
+	inline bool operator == (const Vector3D<float> & lhs, const Vector3D<float> & rhs) {
+		return (_mm_movemask_ps(_mm_cmpeq_ps(lhs.GetLanes(), rhs.GetLanes())) & 7) == 7;
+	}
+#endif
 }
 
 namespace std {
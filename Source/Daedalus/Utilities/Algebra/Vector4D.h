@@ -32,18 +32,90 @@ namespace utils {
 		 * Cross product. Since this operation is meant to operate in a 3D space, we use the
 		 * same cross product algorithm as Vector3D.
 		 */
+		inline Vector4D<T> Cross(const Vector4D<T> & other) const { return Cross<T, T>(other); }
+
 		template <typename T1, typename T2>
 		inline Vector4D<T1> Cross(const Vector4D<T2> other) const {
 			return Vector4D<T1>(
 				Y * other.Z - Z * other.Y,
 				Z * other.X - X * other.Z,
-				X * other.Y - Y * other.X);
+				X * other.Y - Y * other.X,
+				0);
 		}
 
 		/* Length squared. */
 		inline double Length2() const { return X * X + Y * Y + Z * Z; }
-		inline double Length() const { return std::abs(Length2()); }
+		inline double Length() const { return std::sqrt(Length2()); }
 
 		inline Vector3D<T> Truncate() const { return Vector3D<T>(X, Y, Z); }
 	};
+
+#ifdef DAEDALUS_SIMD_SSE
+	/**
+	 * Single precision xyzw vector backed by an SSE register, with the same members as the
+	 * generic vector.
+	 */
+	template <>
+	struct Vector4D<float> {
+		float X;
+		float Y;
+		float Z;
+		float W;
+
+		Vector4D() {}
+		Vector4D(const float x, const float y, const float z, const float w) :
+			X(x), Y(y), Z(z), W(w) {}
+		Vector4D(const Vector3D<float> & vec, const float w = 0) : Vector4D(vec.X, vec.Y, vec.Z, w) {}
+
+		inline __m128 GetLanes() const { return _mm_loadu_ps(&X); }
+
+		static inline Vector4D<float> FromLanes(const __m128 lanes) {
+			Vector4D<float> result;
+			_mm_storeu_ps(&result.X, lanes);
+			return result;
+		}
+
+		inline void Reset(float x, float y, float z, float w) { X = x; Y = y; Z = z; W = w; }
+
+		/**
+		 * Dot product, summed in single precision in the same order as the generic version.
+		 * Unlike the generic version the result isn't widened to double.
+		 */
+		inline float Dot(const Vector4D<float> & other) const {
+			const __m128 product = _mm_mul_ps(GetLanes(), other.GetLanes());
+			const __m128 xy = _mm_add_ss(
+				product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(1, 1, 1, 1)));
+			const __m128 xyz = _mm_add_ss(xy, _mm_movehl_ps(product, product));
+			return _mm_cvtss_f32(
+				_mm_add_ss(xyz, _mm_shuffle_ps(product, product, _MM_SHUFFLE(3, 3, 3, 3))));
+		}
+
+		template <typename T1>
+		inline double Dot(const Vector4D<T1> other) const {
+			return X * other.X + Y * other.Y + Z * other.Z + W * other.W;
+		}
+
+		/**
+		 * Cross product of the xyz parts, with W set to 0.
+		 */
+		inline Vector4D<float> Cross(const Vector4D<float> & other) const {
+			return Vector4D<float>(Truncate().Cross(other.Truncate()), 0);
+		}
+
+		template <typename T1, typename T2>
+		inline Vector4D<T1> Cross(const Vector4D<T2> other) const {
+			return Vector4D<T1>(
+				Y * other.Z - Z * other.Y,
+				Z * other.X - X * other.Z,
+				X * other.Y - Y * other.X,
+				0);
+		}
+
+		/* Length squared. */
+		inline float Length2() const { return Truncate().Length2(); }
+		inline float Length() const { return std::sqrt(Length2()); }
+
+		inline Vector3D<float> Truncate() const { return Vector3D<float>::FromLanes(GetLanes()); }
+	};
+#endif
 }
@@ -0,0 +1,229 @@
+#include <Daedalus.h>
+#include "Compression.h"
+
+#include <Utilities/DataStructures.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace utils {
+	namespace {
+		const Uint32 MinMatch = 4;
+		const Uint32 HashBits = 14;
+		const Uint64 MaxDistance = 0xffff;
+		const Uint32 NoPosition = 0xffffffff;
+
+		inline Uint32 Read32(const Uint8 * data) {
+			Uint32 value;
+			std::memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		inline Uint32 HashOf(const Uint32 value) {
+			return (value * 2654435761u) >> (32 - HashBits);
+		}
+
+		// Lengths that don't fit in the 4 bits of the token continue in 255 steps
+		void WriteLength(std::vector<Uint8> & output, Uint64 length) {
+			while (length >= 255) {
+				output.push_back(255);
+				length -= 255;
+			}
+			output.push_back((Uint8) length);
+		}
+
+		void WriteSequence(
+			std::vector<Uint8> & output,
+			const Uint8 * literals,
+			const Uint64 literalCount,
+			const Uint64 distance,
+			const Uint64 matchLength
+		) {
+			const Uint64 matchCode = matchLength == 0 ? 0 : matchLength - MinMatch;
+			output.push_back((Uint8) (
+				(std::min(literalCount, (Uint64) 15) << 4) | std::min(matchCode, (Uint64) 15)));
+			if (literalCount >= 15)
+				WriteLength(output, literalCount - 15);
+			output.insert(output.end(), literals, literals + literalCount);
+
+			// The last sequence has no match
+			if (matchLength == 0)
+				return;
+			output.push_back((Uint8) (distance & 0xff));
+			output.push_back((Uint8) (distance >> 8));
+			if (matchCode >= 15)
+				WriteLength(output, matchCode - 15);
+		}
+
+		void ThrowCorrupt() {
+			throw StringException("LzDecompress: Compressed data is corrupt");
+		}
+	}
+
+	void LzCompress(const Uint8 * data, const Uint64 size, std::vector<Uint8> & output) {
+		std::vector<Uint32> table(1 << HashBits, NoPosition);
+		Uint64 anchor = 0;
+		Uint64 i = 0;
+
+		while (i + MinMatch <= size) {
+			const Uint32 hash = HashOf(Read32(data + i));
+			const Uint32 candidate = table[hash];
+			table[hash] = (Uint32) i;
+
+			if (candidate == NoPosition || i - candidate > MaxDistance ||
+					Read32(data + candidate) != Read32(data + i)) {
+				i++;
+				continue;
+			}
+
+			Uint64 length = MinMatch;
+			while (i + length < size && data[candidate + length] == data[i + length])
+				length++;
+			WriteSequence(output, data + anchor, i - anchor, i - candidate, length);
+
+			// Index the start of the match's last word, so that runs keep chaining
+			const Uint64 end = i + length;
+			if (end >= MinMatch + 1 && end - 1 + MinMatch <= size)
+				table[HashOf(Read32(data + end - 1))] = (Uint32) (end - 1);
+			i = end;
+			anchor = end;
+		}
+
+		WriteSequence(output, data + anchor, size - anchor, 0, 0);
+	}
+
+	void LzDecompress(
+		const Uint8 * data,
+		const Uint64 size,
+		const Uint64 decompressedSize,
+		std::vector<Uint8> & output
+	) {
+		const Uint64 start = output.size();
+		output.reserve(start + decompressedSize);
+		Uint64 i = 0;
+
+		const auto readLength = [&](Uint64 length) {
+			if (length < 15)
+				return length;
+			Uint8 next;
+			do {
+				if (i >= size)
+					ThrowCorrupt();
+				next = data[i++];
+				length += next;
+			} while (next == 255);
+			return length;
+		};
+
+		while (i < size) {
+			const Uint8 token = data[i++];
+			const Uint64 literalCount = readLength(token >> 4);
+			if (literalCount > size - i || output.size() - start + literalCount > decompressedSize)
+				ThrowCorrupt();
+			output.insert(output.end(), data + i, data + i + literalCount);
+			i += literalCount;
+
+			if (i == size)
+				break;
+			if (size - i < 2)
+				ThrowCorrupt();
+			const Uint64 distance = data[i] | ((Uint64) data[i + 1] << 8);
+			i += 2;
+			const Uint64 length = readLength(token & 0xf) + MinMatch;
+
+			const Uint64 written = output.size() - start;
+			if (distance == 0 || distance > written || written + length > decompressedSize)
+				ThrowCorrupt();
+			// Byte by byte, since the match may overlap the bytes it produces
+			const Uint64 from = output.size() - distance;
+			for (Uint64 j = 0; j < length; j++)
+				output.push_back(output[from + j]);
+		}
+
+		if (output.size() - start != decompressedSize)
+			ThrowCorrupt();
+	}
+
+	void ByteWriter::WriteVarint(Uint64 value) {
+		while (value >= 0x80) {
+			Bytes.push_back((Uint8) (value | 0x80));
+			value >>= 7;
+		}
+		Bytes.push_back((Uint8) value);
+	}
+
+	void ByteWriter::WriteSignedVarint(const Int64 value) {
+		WriteVarint(((Uint64) value << 1) ^ (Uint64) (value >> 63));
+	}
+
+	void ByteWriter::WriteFloat(const float value) {
+		Uint32 bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		for (Uint32 i = 0; i < 4; i++)
+			Bytes.push_back((Uint8) (bits >> (8 * i)));
+	}
+
+	void ByteWriter::WriteDouble(const double value) {
+		Uint64 bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		for (Uint32 i = 0; i < 8; i++)
+			Bytes.push_back((Uint8) (bits >> (8 * i)));
+	}
+
+	void ByteWriter::WriteBytes(const Uint8 * data, const Uint64 size) {
+		Bytes.insert(Bytes.end(), data, data + size);
+	}
+
+	void ByteReader::Require(const Uint64 count) const {
+		if (count > Size - Position)
+			throw StringException("ByteReader::Require: Read past the end of the buffer");
+	}
+
+	Uint8 ByteReader::ReadByte() {
+		Require(1);
+		return Data[Position++];
+	}
+
+	Uint64 ByteReader::ReadVarint() {
+		Uint64 value = 0;
+		for (Uint32 shift = 0; shift < 64; shift += 7) {
+			const Uint8 byte = ReadByte();
+			value |= (Uint64) (byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+				return value;
+		}
+		throw StringException("ByteReader::ReadVarint: Variable length integer is too long");
+	}
+
+	Int64 ByteReader::ReadSignedVarint() {
+		const Uint64 value = ReadVarint();
+		return (Int64) (value >> 1) ^ -(Int64) (value & 1);
+	}
+
+	float ByteReader::ReadFloat() {
+		Require(4);
+		Uint32 bits = 0;
+		for (Uint32 i = 0; i < 4; i++)
+			bits |= (Uint32) Data[Position++] << (8 * i);
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	double ByteReader::ReadDouble() {
+		Require(8);
+		Uint64 bits = 0;
+		for (Uint32 i = 0; i < 8; i++)
+			bits |= (Uint64) Data[Position++] << (8 * i);
+		double value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	const Uint8 * ByteReader::ReadBytes(const Uint64 count) {
+		Require(count);
+		const Uint8 * bytes = Data + Position;
+		Position += count;
+		return bytes;
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <Utilities/Integers.h>
+
+#include <vector>
+
+namespace utils {
+	/**
+	 * Byte oriented LZ77 compression, in the spirit of LZ4. Matches are found through a hash
+	 * of the next 4 bytes, which keeps compression fast enough to run per message at the cost
+	 * of some ratio. The output is a series of sequences, each a token holding the literal
+	 * and match lengths, the literal bytes, and the 16-bit distance back to the match. The
+	 * last sequence only holds literals.
+	 */
+	void LzCompress(const Uint8 * data, const Uint64 size, std::vector<Uint8> & output);
+
+	/**
+	 * Appends the decompressed bytes to the output. Throws a StringException if the input is
+	 * corrupt, or doesn't decompress to exactly the given size.
+	 */
+	void LzDecompress(
+		const Uint8 * data,
+		const Uint64 size,
+		const Uint64 decompressedSize,
+		std::vector<Uint8> & output);
+
+	/**
+	 * Appends values to a byte buffer in little endian order. Integers are written as
+	 * variable length quantities, 7 bits per byte, so that small values take a single byte.
+	 */
+	class ByteWriter {
+	private:
+		std::vector<Uint8> & Bytes;
+
+	public:
+		ByteWriter(std::vector<Uint8> & bytes) : Bytes(bytes) {}
+
+		void WriteByte(const Uint8 value) { Bytes.push_back(value); }
+		void WriteVarint(Uint64 value);
+		// Zig-zag encoded so that small negative values stay short
+		void WriteSignedVarint(const Int64 value);
+		void WriteFloat(const float value);
+		void WriteDouble(const double value);
+		void WriteBytes(const Uint8 * data, const Uint64 size);
+	};
+
+	/**
+	 * Reads values written by ByteWriter. Throws a StringException when reading past the end.
+	 */
+	class ByteReader {
+	private:
+		const Uint8 * Data;
+		Uint64 Size;
+		Uint64 Position;
+
+		void Require(const Uint64 count) const;
+
+	public:
+		ByteReader(const Uint8 * data, const Uint64 size) : Data(data), Size(size), Position(0) {}
+
+		Uint8 ReadByte();
+		Uint64 ReadVarint();
+		Int64 ReadSignedVarint();
+		float ReadFloat();
+		double ReadDouble();
+		/**
+		 * @return Pointer to the next count bytes, which are skipped.
+		 */
+		const Uint8 * ReadBytes(const Uint64 count);
+
+		inline Uint64 GetRemaining() const { return Size - Position; }
+	};
+}
@@ -2,6 +2,7 @@
 
 #include <Utilities/Integers.h>
 
+#include <atomic>
 #include <vector>
 #include <memory>
 #include <string>
@@ -90,6 +91,48 @@ namespace utils {
 	template <typename T>
 	Option<T> None() { return Option<T>(); }
 
+	/**
+	 * A value that is shared with readers until the owner changes it, at which point the owner
+	 * copies it first. Shared versions are never written again, so readers on other threads
+	 * can hold on to them without locking. Only the owning thread may call Mutable and Share,
+	 * which is what keeps a value from becoming shared while it is being written.
+	 */
+	template <typename T>
+	class CopyOnWrite {
+	private:
+		std::shared_ptr<T> Value;
+
+	public:
+		explicit CopyOnWrite(const std::shared_ptr<T> & value) : Value(value) {}
+
+		const T & operator * () const { return *Value; }
+		const T * operator -> () const { return Value.get(); }
+
+		/**
+		 * Copies the value first if any reader holds on to it. No new reader can appear
+		 * between the check and the write, since the snapshots that share the value are
+		 * taken on the game thread, the same thread that edits it. Readers on other threads
+		 * can still be letting go of the value, which is what the fence below is for.
+		 */
+		T & Mutable() {
+			// A reader releasing its version concurrently can only cause a redundant copy
+			if (Value.use_count() != 1) {
+				Value = std::make_shared<T>(*Value);
+			} else {
+				// The count is read relaxed. Dropping the last other reference releases it,
+				// and this acquires it, so that reader's reads happen before the writes.
+				std::atomic_thread_fence(std::memory_order_acquire);
+			}
+			return *Value;
+		}
+
+		/**
+		 * @return The current version, which stays unchanged even if the owner changes the
+		 *         value later on.
+		 */
+		std::shared_ptr<const T> Share() const { return Value; }
+	};
+
 
 	//template <typename T>
 	//struct Option {
@@ -2,6 +2,7 @@
 #include "FastVoxelTraversal.h"
 
 #include <algorithm>
+#include <cmath>
 
 #include <Utilities/Algebra/Algebra2D.h>
 #include <Utilities/Algebra/Algebra3D.h>
@@ -114,14 +115,67 @@ namespace utils {
 					TNext.Z += TDelta.Z;
 				}
 			}
-			if (bIsBounded && !CurrentCell.IsBoundedBy(LowerBound, UpperBound))
-				bIsValid = false; // Not found.
-
-			// Target is out of range
-			if (TCurrent.X > DistanceLimit &&
-					TCurrent.Y > DistanceLimit &&
-					TCurrent.Z > DistanceLimit)
-				bIsValid = false;
+			CheckValidity();
 		}
 	}
+
+	void FastVoxelTraversalIterator::SkipBlock(const Uint32 blockSize) {
+		if (!bIsValid)
+			return;
+
+		const Int64 size = (Int64) blockSize;
+		Int64 remaining[3] = { 0, 0, 0 };
+		double tLeave = std::numeric_limits<double>::infinity();
+		Uint8 exitAxis = 0;
+
+		// Find the number of cell boundaries left to cross along each axis before leaving the
+		// block, and the axis through which the ray leaves the block first.
+		for (Uint8 i = 0; i < 3; i++) {
+			if (Step[i] == 0)
+				continue;
+			const Int64 local = ((CurrentCell[i] % size) + size) % size;
+			remaining[i] = Step[i] > 0 ? size - 1 - local : local;
+			const double tExit = TNext[i] + remaining[i] * TDelta[i];
+			if (tExit < tLeave) {
+				tLeave = tExit;
+				exitAxis = i;
+			}
+		}
+
+		if (tLeave == std::numeric_limits<double>::infinity()) {
+			bIsValid = false;
+			return;
+		}
+
+		// Advance the other axes by all of the boundaries they cross before the exit point.
+		for (Uint8 i = 0; i < 3; i++) {
+			if (i == exitAxis || Step[i] == 0)
+				continue;
+			const double crossings = std::ceil((tLeave - TNext[i]) / TDelta[i]);
+			const Int64 count = std::min(remaining[i], std::max((Int64) 0, (Int64) crossings));
+			CurrentCell[i] += Step[i] * count;
+			TNext[i] += count * TDelta[i];
+		}
+
+		CurrentCell[exitAxis] += Step[exitAxis] * (remaining[exitAxis] + 1);
+		TNext[exitAxis] += (remaining[exitAxis] + 1) * TDelta[exitAxis];
+
+		PreviousCell = CurrentCell;
+		PreviousCell[exitAxis] -= Step[exitAxis];
+		TCurrent = TNext;
+		TCurrent[exitAxis] = tLeave;
+
+		CheckValidity();
+	}
+
+	void FastVoxelTraversalIterator::CheckValidity() {
+		if (bIsBounded && !CurrentCell.IsBoundedBy(LowerBound, UpperBound))
+			bIsValid = false; // Not found.
+
+		// Target is out of range
+		if (TCurrent.X > DistanceLimit &&
+				TCurrent.Y > DistanceLimit &&
+				TCurrent.Z > DistanceLimit)
+			bIsValid = false;
+	}
 }
@@ -35,6 +35,7 @@ namespace utils {
 		bool bIsValid;
 
 		void Initialize();
+		void CheckValidity();
 
 		inline void Gridize(
 			utils::Vector3D<Int64> & out,
@@ -61,6 +62,15 @@ namespace utils {
 			const double distanceLimit);
 
 		void Next();
+
+		/**
+		 * Advances the iterator directly to the first cell outside of the aligned block of
+		 * blockSize^3 cells that contains the current cell. This is equivalent to calling Next()
+		 * until the current cell leaves the block, but runs in constant time, and is used to skip
+		 * over regions which are known to be empty.
+		 */
+		void SkipBlock(const Uint32 blockSize);
+
 		inline bool IsValid() const { return bIsValid; }
 		inline const Vector3D<Int64> & GetCurrentCell() const { return CurrentCell; }
 		inline const Vector3D<Int64> & GetPreviousCell() const { return PreviousCell; }
@@ -0,0 +1,283 @@
+#include <Daedalus.h>
+#include "JobSystem.h"
+
+#include <Utilities/DataStructures.h>
+
+#include <algorithm>
+
+namespace utils {
+	JobSystem::JobSystem(const Uint32 workerCount) : WaiterCount(0), bStopping(false) {
+		for (Uint32 i = 0; i <= workerCount; i++)
+			Queues.emplace_back(new JobQueue());
+		for (Uint32 p = 0; p < J_PriorityCount; p++)
+			QueuedCounts[p] = 0;
+		Workers.reserve(workerCount);
+		for (Uint32 i = 0; i < workerCount; i++)
+			Workers.emplace_back(&JobSystem::Run, this, i);
+	}
+
+	JobSystem::~JobSystem() {
+		{
+			std::lock_guard<std::mutex> guard(SleepLock);
+			bStopping = true;
+		}
+		WorkQueued.notify_all();
+		for (auto & worker : Workers)
+			worker.join();
+
+		// Without workers, the queued jobs are run here
+		const Uint32 self = FindWorkerIndex();
+		while (auto job = FindJob(self))
+			Execute(job, self);
+	}
+
+	void JobSystem::Run(const Uint32 index) {
+		while (true) {
+			const auto job = FindJob(index);
+			if (job) {
+				Execute(job, index);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> guard(SleepLock);
+			WorkQueued.wait(guard, [this] { return bStopping || HasQueuedJobs(); });
+			if (bStopping && !HasQueuedJobs())
+				return;
+		}
+	}
+
+	Uint32 JobSystem::FindWorkerIndex() const {
+		const auto id = std::this_thread::get_id();
+		for (Uint32 i = 0; i < Workers.size(); i++) {
+			if (Workers[i].get_id() == id)
+				return i;
+		}
+		return (Uint32) Workers.size();
+	}
+
+	bool JobSystem::HasQueuedJobs(const JobPriority lowest) const {
+		for (Uint32 p = 0; p <= (Uint32) lowest; p++) {
+			if (QueuedCounts[p] > 0)
+				return true;
+		}
+		return false;
+	}
+
+	void JobSystem::Enqueue(const JobHandle & job, const Uint32 index) {
+		auto & queue = *Queues[index];
+		// Counted before the job is published, so a thief taking it right away can't
+		// decrement the count first. A thief seeing the count early finds no job and moves on.
+		QueuedCounts[job->Priority]++;
+		{
+			std::lock_guard<std::mutex> guard(queue.Lock);
+			queue.Jobs[job->Priority].push_back(job);
+		}
+
+		// Taking the lock orders the count before the sleepers check it
+		{
+			std::lock_guard<std::mutex> guard(SleepLock);
+		}
+		WorkQueued.notify_one();
+		if (WaiterCount > 0)
+			JobFinished.notify_all();
+	}
+
+	JobHandle JobSystem::FindJob(const Uint32 index, const JobPriority lowest) {
+		const Uint32 queueCount = (Uint32) Queues.size();
+		for (Uint32 p = 0; p <= (Uint32) lowest; p++) {
+			if (QueuedCounts[p] == 0)
+				continue;
+
+			// The newest job of our own queue first, then the oldest job of everyone else's
+			for (Uint32 i = 0; i < queueCount; i++) {
+				const Uint32 victim = (index + i) % queueCount;
+				auto & queue = *Queues[victim];
+				std::lock_guard<std::mutex> guard(queue.Lock);
+				auto & jobs = queue.Jobs[p];
+				if (jobs.empty())
+					continue;
+
+				JobHandle job;
+				// The shared queue is last, and has no owner
+				if (i == 0 && index + 1 < queueCount) {
+					job = jobs.back();
+					jobs.pop_back();
+				} else {
+					job = jobs.front();
+					jobs.pop_front();
+				}
+				QueuedCounts[p]--;
+				return job;
+			}
+		}
+		return NULL;
+	}
+
+	void JobSystem::Execute(const JobHandle & job, const Uint32 index) {
+		try {
+			job->Task();
+		} catch (...) {
+			job->Error = std::current_exception();
+		}
+		// Releases whatever the task captured
+		job->Task = nullptr;
+
+		std::vector<JobHandle> continuations;
+		{
+			std::lock_guard<std::mutex> guard(job->Lock);
+			job->bFinished = true;
+			continuations.swap(job->Continuations);
+		}
+		for (const auto & continuation : continuations) {
+			if (--continuation->Blockers == 0)
+				Enqueue(continuation, index);
+		}
+		WakeWaiters();
+	}
+
+	void JobSystem::WakeWaiters() {
+		if (WaiterCount == 0)
+			return;
+		{
+			std::lock_guard<std::mutex> guard(SleepLock);
+		}
+		JobFinished.notify_all();
+	}
+
+	JobHandle JobSystem::Submit(const std::function<void ()> & task, const JobPriority priority) {
+		return Submit(task, std::vector<JobHandle>(), priority);
+	}
+
+	JobHandle JobSystem::Submit(
+		const std::function<void ()> & task,
+		const std::vector<JobHandle> & dependencies,
+		const JobPriority priority
+	) {
+		const auto job = std::make_shared<Job>(task, priority);
+		for (const auto & dependency : dependencies) {
+			std::lock_guard<std::mutex> guard(dependency->Lock);
+			if (!dependency->bFinished) {
+				job->Blockers++;
+				dependency->Continuations.push_back(job);
+			}
+		}
+
+		// The extra blocker keeps dependencies finishing meanwhile from queueing the job early
+		if (--job->Blockers == 0)
+			Enqueue(job, FindWorkerIndex());
+		return job;
+	}
+
+	void JobSystem::Wait(const JobHandle & job) {
+		const Uint32 self = FindWorkerIndex();
+		while (!job->IsFinished()) {
+			// Until the job is queued it may be waiting on lower priority dependencies, which
+			// would never run if every thread were waiting. Once queued, this thread can
+			// always run the job itself.
+			const JobPriority lowest = job->Blockers > 0 ? J_Low : job->Priority;
+			const auto next = FindJob(self, lowest);
+			if (next) {
+				Execute(next, self);
+				continue;
+			}
+
+			// Counted before checking, so a job finishing meanwhile always sees the waiter
+			WaiterCount++;
+			{
+				std::unique_lock<std::mutex> guard(SleepLock);
+				JobFinished.wait(guard, [&] {
+					return job->IsFinished() || HasQueuedJobs(lowest);
+				});
+			}
+			WaiterCount--;
+		}
+
+		if (job->Error)
+			std::rethrow_exception(job->Error);
+	}
+
+	void JobSystem::ParallelFor(
+		const Uint64 count,
+		const Uint64 grainSize,
+		const std::function<void (Uint64)> & task,
+		const JobPriority priority
+	) {
+		if (count == 0)
+			return;
+		const Uint64 jobTarget = std::max<Uint64>(1, Workers.size()) * 4;
+		const Uint64 grain = grainSize > 0 ? grainSize : (count + jobTarget - 1) / jobTarget;
+
+		std::vector<JobHandle> jobs;
+		for (Uint64 begin = 0; begin < count; begin += grain) {
+			const Uint64 end = std::min(count, begin + grain);
+			jobs.push_back(Submit([&task, begin, end] {
+				for (Uint64 i = begin; i < end; i++)
+					task(i);
+			}, priority));
+		}
+
+		// Every job has to finish before returning, since they refer to the task
+		std::exception_ptr error;
+		for (const auto & job : jobs) {
+			try {
+				Wait(job);
+			} catch (...) {
+				if (!error)
+					error = std::current_exception();
+			}
+		}
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	void JobSystem::ParallelFor2D(
+		const Uint64 sizeX,
+		const Uint64 sizeY,
+		const std::function<void (Uint64, Uint64)> & task,
+		const JobPriority priority
+	) {
+		ParallelFor(sizeX, 0, [&] (const Uint64 x) {
+			for (Uint64 y = 0; y < sizeY; y++)
+				task(x, y);
+		}, priority);
+	}
+
+	void JobSystem::ParallelFor3D(
+		const Uint64 sizeX,
+		const Uint64 sizeY,
+		const Uint64 sizeZ,
+		const std::function<void (Uint64, Uint64, Uint64)> & task,
+		const JobPriority priority
+	) {
+		ParallelFor(sizeX * sizeY, 0, [&] (const Uint64 column) {
+			const Uint64 x = column / sizeY;
+			const Uint64 y = column % sizeY;
+			for (Uint64 z = 0; z < sizeZ; z++)
+				task(x, y, z);
+		}, priority);
+	}
+
+	namespace {
+		// Not a smart pointer, so that no worker is ever joined during static destruction
+		JobSystem * SharedJobs = NULL;
+	}
+
+	void StartJobSystem() {
+		if (SharedJobs)
+			return;
+		// At least one worker, since jobs nobody waits for would never run otherwise
+		const Uint32 threads = std::thread::hardware_concurrency();
+		SharedJobs = new JobSystem(std::max(2u, threads) - 1);
+	}
+
+	void StopJobSystem() {
+		delete SharedJobs;
+		SharedJobs = NULL;
+	}
+
+	JobSystem & GetJobSystem() {
+		if (!SharedJobs)
+			throw StringException("GetJobSystem: The job system hasn't been started");
+		return *SharedJobs;
+	}
+}
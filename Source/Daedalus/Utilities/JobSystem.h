@@ -0,0 +1,180 @@
+#pragma once
+
+#include <Utilities/Integers.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils {
+	enum JobPriority {
+		J_High,             // Work the current frame is waiting for
+		J_Normal,
+		J_Low,              // Speculative work, such as prefetching
+		J_PriorityCount
+	};
+
+	/**
+	 * A task submitted to a job system. A job runs once all of the jobs it depends on have
+	 * finished, whether they succeeded or not.
+	 */
+	class Job {
+		friend class JobSystem;
+
+	private:
+		std::function<void ()> Task;
+		const JobPriority Priority;
+		std::atomic<Uint32> Blockers;          // Unfinished dependencies, plus one until queued
+
+		std::mutex Lock;                       // Guards the continuations
+		std::vector<std::shared_ptr<Job>> Continuations;
+		std::atomic<bool> bFinished;
+		std::exception_ptr Error;              // Only read once the job has finished
+
+	public:
+		Job(const std::function<void ()> & task, const JobPriority priority) :
+			Task(task), Priority(priority), Blockers(1), bFinished(false)
+		{}
+
+		inline bool IsFinished() const { return bFinished; }
+		inline JobPriority GetPriority() const { return Priority; }
+	};
+
+	using JobHandle = std::shared_ptr<Job>;
+
+	/**
+	 * Runs jobs on a fixed set of worker threads. Every worker has its own queue per
+	 * priority: it takes its newest jobs first, which are likely to still be in its cache,
+	 * and steals the oldest jobs of the other workers when it runs out. Higher priorities are
+	 * always taken first, from any queue. Jobs submitted from outside of the workers go to a
+	 * shared queue that every worker steals from.
+	 *
+	 * Threads waiting for a job run other jobs in the meantime, so jobs may wait for jobs
+	 * they submitted themselves, and a job system without workers runs everything on the
+	 * waiting thread.
+	 */
+	class JobSystem {
+	private:
+		struct JobQueue {
+			std::mutex Lock;
+			std::deque<JobHandle> Jobs[J_PriorityCount];
+		};
+
+		// One per worker, followed by the shared queue
+		std::vector<std::unique_ptr<JobQueue>> Queues;
+		std::atomic<Uint64> QueuedCounts[J_PriorityCount];
+
+		std::mutex SleepLock;
+		std::condition_variable WorkQueued;    // Wakes the workers
+		std::condition_variable JobFinished;   // Wakes the threads waiting for a job
+		std::atomic<Uint32> WaiterCount;
+		bool bStopping;
+
+		std::vector<std::thread> Workers;      // Started last, after the state above
+
+		void Run(const Uint32 index);
+
+		/**
+		 * @return Index of the calling worker, or the index of the shared queue if the
+		 *         calling thread isn't a worker.
+		 */
+		Uint32 FindWorkerIndex() const;
+		/**
+		 * @param lowest Lowest priority to look at, jobs below it are ignored.
+		 */
+		bool HasQueuedJobs(const JobPriority lowest = J_Low) const;
+
+		void Enqueue(const JobHandle & job, const Uint32 index);
+		JobHandle FindJob(const Uint32 index, const JobPriority lowest = J_Low);
+		void Execute(const JobHandle & job, const Uint32 index);
+		void WakeWaiters();
+
+	public:
+		/**
+		 * @param workerCount Number of threads to start, the threads that wait for jobs help
+		 *                    out on top of these.
+		 */
+		explicit JobSystem(const Uint32 workerCount);
+		/**
+		 * Finishes every queued job before returning.
+		 */
+		~JobSystem();
+
+		JobSystem(const JobSystem &) = delete;
+		JobSystem & operator = (const JobSystem &) = delete;
+
+		inline Uint32 GetWorkerCount() const { return (Uint32) Workers.size(); }
+
+		JobHandle Submit(
+			const std::function<void ()> & task,
+			const JobPriority priority = J_Normal);
+
+		/**
+		 * Submits a job that only runs once every one of the dependencies has finished.
+		 */
+		JobHandle Submit(
+			const std::function<void ()> & task,
+			const std::vector<JobHandle> & dependencies,
+			const JobPriority priority = J_Normal);
+
+		/**
+		 * Runs other jobs until the job has finished, then rethrows whatever it threw. Once
+		 * the job is queued, only jobs of at least its priority are run meanwhile, so that
+		 * waiting on urgent work never gets stuck behind background work.
+		 */
+		void Wait(const JobHandle & job);
+
+		/**
+		 * Runs the task for every index in [0, count) and waits for all of them, rethrowing
+		 * the first exception once every index has run.
+		 * @param grainSize Number of indices per job, 0 picks a few jobs per worker.
+		 */
+		void ParallelFor(
+			const Uint64 count,
+			const Uint64 grainSize,
+			const std::function<void (Uint64)> & task,
+			const JobPriority priority = J_Normal);
+
+		/**
+		 * Splits the range into rows along X, so that each job walks whole rows along Y.
+		 */
+		void ParallelFor2D(
+			const Uint64 sizeX,
+			const Uint64 sizeY,
+			const std::function<void (Uint64, Uint64)> & task,
+			const JobPriority priority = J_Normal);
+
+		/**
+		 * Splits the range into columns of the XY plane, so that each job walks whole columns
+		 * along Z, in the same order as the chunk fields are laid out.
+		 */
+		void ParallelFor3D(
+			const Uint64 sizeX,
+			const Uint64 sizeY,
+			const Uint64 sizeZ,
+			const std::function<void (Uint64, Uint64, Uint64)> & task,
+			const JobPriority priority = J_Normal);
+	};
+
+	/**
+	 * Starts the job system shared by the whole game, with a worker for every hardware thread
+	 * but one, and at least one worker. Called when the game module starts up.
+	 */
+	void StartJobSystem();
+	/**
+	 * Finishes every queued job and stops the workers of the shared job system. Called when
+	 * the game module shuts down, rather than leaving the workers to static destruction.
+	 */
+	void StopJobSystem();
+	/**
+	 * @return The job system shared by the whole game, between StartJobSystem and
+	 *         StopJobSystem.
+	 */
+	JobSystem & GetJobSystem();
+}
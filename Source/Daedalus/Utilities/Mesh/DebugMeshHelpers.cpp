@@ -3,7 +3,7 @@
 
 namespace utils {
 	inline void AddFace(
-		std::vector<Triangle3D> & output,
+		std::vector<Triangle3D<>> & output,
 		const Vector3D<> & f0,
 		const Vector3D<> & f1,
 		const Vector3D<> & f2,
@@ -14,7 +14,7 @@ namespace utils {
 	}
 
 	Uint16 CreatePrism(
-		std::vector<Triangle3D> & output,
+		std::vector<Triangle3D<>> & output,
 		Vector3D<> * const input
 	) {
 		AddFace(output, input[0], input[1], input[2], input[3]);
@@ -39,7 +39,7 @@ namespace utils {
 	};
 
 	Uint16 CreatePoint(
-		std::vector<Triangle3D> & results, const Vector3D<> & position, const float radius
+		std::vector<Triangle3D<>> & results, const Vector3D<> & position, const float radius
 	) {
 		
 		Matrix4D<> transform =
@@ -54,7 +54,7 @@ namespace utils {
 	}
 
 	Uint16 CreateLine(
-		std::vector<Triangle3D> & results, const Vector3D<> & startPoint,
+		std::vector<Triangle3D<>> & results, const Vector3D<> & startPoint,
 		const Vector3D<> & endPoint, const float radius
 	) {
 		Vector3D<> u1 = endPoint - startPoint;
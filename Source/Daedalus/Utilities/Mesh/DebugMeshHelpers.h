@@ -10,8 +10,8 @@
  */
 namespace utils {
 	Uint16 CreatePoint(
-		std::vector<Triangle3D> & results, const Vector3D<> & position, const float radius);
+		std::vector<Triangle3D<>> & results, const Vector3D<> & position, const float radius);
 	Uint16 CreateLine(
-		std::vector<Triangle3D> & results, const Vector3D<> & startPoint,
+		std::vector<Triangle3D<>> & results, const Vector3D<> & startPoint,
 		const Vector3D<> & endPoint, const float radius);
 }
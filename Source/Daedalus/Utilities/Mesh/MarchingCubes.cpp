@@ -2,6 +2,8 @@
 #include "MarchingCubes.h"
 #include <Utilities/Constants.h>
 
+#include <algorithm>
+
 namespace utils {
 	int EdgeTable[256] = {
 		0x0, 0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c,
@@ -297,110 +299,153 @@ namespace utils {
 		{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 }
 	};
 
-	Vector3D<> VertexLerp(
-		const float isoThreshold, const Vector3D<> & p1, const Vector3D<> & p2,
-		float bp1, float bp2);
+	// Grid cell points at either end of each cell edge
+	const Uint8 EdgePoints[12][2] = {
+		{ 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 }, { 4, 5 }, { 5, 6 },
+		{ 6, 7 }, { 7, 4 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+	};
+
+	/*
+	Linearly interpolate the position where an isosurface cuts
+	an edge between two vertices, each with their own scalar value.
+	Edges are always interpolated from their lower end, so that the
+	cells sharing an edge produce bitwise identical vertices, which
+	lets the resulting mesh be welded by position. The normal and
+	the materials, if requested, are interpolated with the same
+	weights.
+	*/
+	Vector3D<float> VertexLerp(
+		const float isoThreshold,
+		const GridCell & grid,
+		const Uint8 edgeStart,
+		const Uint8 edgeEnd,
+		Vector3D<float> * normal,
+		MaterialBlend * materials
+	) {
+		// Cell edges are axis aligned, so the lower end has the smaller coordinate sum
+		const Vector3D<float> & start = grid.points[edgeStart];
+		const Vector3D<float> & end = grid.points[edgeEnd];
+		const bool isReversed = end.X + end.Y + end.Z < start.X + start.Y + start.Z;
+		const Uint8 i1 = isReversed ? edgeEnd : edgeStart;
+		const Uint8 i2 = isReversed ? edgeStart : edgeEnd;
+		const Vector3D<float> & p1 = grid.points[i1];
+		const Vector3D<float> & p2 = grid.points[i2];
+		const float valp1 = grid.values[i1];
+		const float valp2 = grid.values[i2];
+
+		// Weight of the upper end, the snapped cases return the end points exactly
+		float mu;
+		Vector3D<float> position;
+		if (std::abs(isoThreshold - valp1) >= FLOAT_ERROR &&
+				std::abs(isoThreshold - valp2) < FLOAT_ERROR) {
+			mu = 1;
+			position = p2;
+		} else if (std::abs(isoThreshold - valp1) < FLOAT_ERROR ||
+				std::abs(valp1 - valp2) < FLOAT_ERROR) {
+			mu = 0;
+			position = p1;
+		} else {
+			mu = (isoThreshold - valp1) / (valp2 - valp1);
+			position = p1 + (p2 - p1) * mu;
+		}
+
+		if (normal) {
+			if (mu == 0)
+				*normal = grid.normals[i1];
+			else if (mu == 1)
+				*normal = grid.normals[i2];
+			else
+				*normal = grid.normals[i1] + (grid.normals[i2] - grid.normals[i1]) * mu;
+		}
+
+		if (materials) {
+			materials->Count = 0;
+			materials->Add(grid.materials[i1], (1 - mu) * std::max(valp1, 0.0f));
+			materials->Add(grid.materials[i2], mu * std::max(valp2, 0.0f));
+			// A vertex snapped onto the empty end takes the material of the other end
+			if (materials->Count == 0)
+				materials->Add(grid.materials[valp1 >= valp2 ? i1 : i2], 1);
+			materials->Normalize();
+		}
+
+		return position;
+	}
 
 	/*
 	Given a grid cell and an calculate the triangular
 	facets required to represent the isosurface through the cell.
-	Return the number of triangular facets, the array "triangles"
-	will be loaded up with the vertices at most 5 triangular facets.
-	0 will be returned if the grid cell is either totally above
-	of totally below the isolevel.
+	The triangles, and their attributes if requested, are appended
+	with the vertices of at most 5 triangular facets. Nothing is
+	appended if the grid cell is either totally above of totally
+	below the isolevel.
 	*/
-	void MarchingCube(
-		std::vector<Triangle3D> & resultTries,
+	void Polygonise(
+		std::vector<Triangle3D<float>> & resultTries,
+		std::vector<Triangle3D<float>> * resultNormals,
+		std::vector<MaterialBlend> * resultMaterials,
 		const float isoThreshold,
 		const GridCell & grid
 	) {
-		Vector3D<> vertlist[12];
+		Vector3D<float> vertlist[12];
+		Vector3D<float> normlist[12];
+		MaterialBlend matlist[12];
 		int cubeindex = 0;
 
 		/*
 		Determine the index into the edge table which
 		tells us which vertices are inside of the surface
 		*/
-		if (grid.values[0] <= isoThreshold) cubeindex |= 1;
-		if (grid.values[1] <= isoThreshold) cubeindex |= 2;
-		if (grid.values[2] <= isoThreshold) cubeindex |= 4;
-		if (grid.values[3] <= isoThreshold) cubeindex |= 8;
-		if (grid.values[4] <= isoThreshold) cubeindex |= 16;
-		if (grid.values[5] <= isoThreshold) cubeindex |= 32;
-		if (grid.values[6] <= isoThreshold) cubeindex |= 64;
-		if (grid.values[7] <= isoThreshold) cubeindex |= 128;
+		for (Uint8 i = 0; i < 8; i++) {
+			if (grid.values[i] <= isoThreshold)
+				cubeindex |= 1 << i;
+		}
 
 		/* Cube is entirely in/out of the surface */
 		if (EdgeTable[cubeindex] == 0)
 			return;
 
 		/* Find the vertices where the surface intersects the cube */
-		if (EdgeTable[cubeindex] & 1)
-			vertlist[0] = VertexLerp(
-				isoThreshold, grid.points[0], grid.points[1], grid.values[0], grid.values[1]);
-		if (EdgeTable[cubeindex] & 2)
-			vertlist[1] = VertexLerp(
-				isoThreshold, grid.points[1], grid.points[2], grid.values[1], grid.values[2]);
-		if (EdgeTable[cubeindex] & 4)
-			vertlist[2] = VertexLerp(
-				isoThreshold, grid.points[2], grid.points[3], grid.values[2], grid.values[3]);
-		if (EdgeTable[cubeindex] & 8)
-			vertlist[3] = VertexLerp(
-				isoThreshold, grid.points[3], grid.points[0], grid.values[3], grid.values[0]);
-		if (EdgeTable[cubeindex] & 16)
-			vertlist[4] = VertexLerp(
-				isoThreshold, grid.points[4], grid.points[5], grid.values[4], grid.values[5]);
-		if (EdgeTable[cubeindex] & 32)
-			vertlist[5] = VertexLerp(
-				isoThreshold, grid.points[5], grid.points[6], grid.values[5], grid.values[6]);
-		if (EdgeTable[cubeindex] & 64)
-			vertlist[6] = VertexLerp(
-				isoThreshold, grid.points[6], grid.points[7], grid.values[6], grid.values[7]);
-		if (EdgeTable[cubeindex] & 128)
-			vertlist[7] = VertexLerp(
-				isoThreshold, grid.points[7], grid.points[4], grid.values[7], grid.values[4]);
-		if (EdgeTable[cubeindex] & 256)
-			vertlist[8] = VertexLerp(
-				isoThreshold, grid.points[0], grid.points[4], grid.values[0], grid.values[4]);
-		if (EdgeTable[cubeindex] & 512)
-			vertlist[9] = VertexLerp(
-				isoThreshold, grid.points[1], grid.points[5], grid.values[1], grid.values[5]);
-		if (EdgeTable[cubeindex] & 1024)
-			vertlist[10] = VertexLerp(
-				isoThreshold, grid.points[2], grid.points[6], grid.values[2], grid.values[6]);
-		if (EdgeTable[cubeindex] & 2048)
-			vertlist[11] = VertexLerp(
-				isoThreshold, grid.points[3], grid.points[7], grid.values[3], grid.values[7]);
+		for (Uint8 edge = 0; edge < 12; edge++) {
+			if (EdgeTable[cubeindex] & (1 << edge)) {
+				vertlist[edge] = VertexLerp(
+					isoThreshold, grid, EdgePoints[edge][0], EdgePoints[edge][1],
+					resultNormals ? &normlist[edge] : NULL,
+					resultMaterials ? &matlist[edge] : NULL);
+			}
+		}
 
 		/* Create the triangle */
 		for (Uint32 i = 0; TriTable[cubeindex][i] != -1; i += 3) {
-			resultTries.push_back(Triangle3D(
-				vertlist[TriTable[cubeindex][i]],
-				vertlist[TriTable[cubeindex][i + 2]],
-				vertlist[TriTable[cubeindex][i + 1]]));
+			const int edges[] = {
+				TriTable[cubeindex][i], TriTable[cubeindex][i + 2], TriTable[cubeindex][i + 1] };
+			resultTries.push_back(Triangle3D<float>(
+				vertlist[edges[0]], vertlist[edges[1]], vertlist[edges[2]]));
+			if (resultNormals) {
+				resultNormals->push_back(Triangle3D<float>(
+					normlist[edges[0]], normlist[edges[1]], normlist[edges[2]]));
+			}
+			if (resultMaterials) {
+				for (const auto edge : edges)
+					resultMaterials->push_back(matlist[edge]);
+			}
 		}
 	}
 
-	/*
-	Linearly interpolate the position where an isosurface cuts
-	an edge between two vertices, each with their own scalar value
-	*/
-	Vector3D<> VertexLerp(
+	void MarchingCube(
+		std::vector<Triangle3D<float>> & resultTries,
 		const float isoThreshold,
-		const Vector3D<> & p1,
-		const Vector3D<> & p2,
-		float valp1,
-		float valp2
+		const GridCell & grid
 	) {
-		if (std::abs(isoThreshold - valp1) < FLOAT_ERROR)
-			return p1;
-		if (std::abs(isoThreshold - valp2) < FLOAT_ERROR)
-			return p2;
-		if (std::abs(valp1 - valp2) < FLOAT_ERROR)
-			return p1;
-
-		double mu = (isoThreshold - valp1) / (valp2 - valp1);
+		Polygonise(resultTries, NULL, NULL, isoThreshold, grid);
+	}
 
-		return p1 + (p2 - p1) * mu;
+	void MarchingCube(
+		std::vector<Triangle3D<float>> & resultTries,
+		std::vector<Triangle3D<float>> & resultNormals,
+		std::vector<MaterialBlend> & resultMaterials,
+		const float isoThreshold,
+		const GridCell & grid
+	) {
+		Polygonise(resultTries, &resultNormals, &resultMaterials, isoThreshold, grid);
 	}
-}
\ No newline at end of file
+}
@@ -5,8 +5,26 @@
 #include <vector>
 
 namespace utils {
+	/**
+	 * Triangulates the isosurface through a grid cell in single precision, appending at most 5
+	 * triangles in the space of the cell's corner points.
+	 */
 	void MarchingCube(
-		std::vector<Triangle3D> & resultTries,
+		std::vector<Triangle3D<float>> & resultTries,
+		const float isoThreshold,
+		const GridCell & grid);
+
+	/**
+	 * Same as above, also appending the attributes of each triangle's vertices. Normals are
+	 * interpolated along the cell edges from the normals of the grid cell. Materials are
+	 * blended from the grid cell corners at either end of the edge, weighted by distance and
+	 * density, so that the empty corner of an edge adds nothing.
+	 * @param resultMaterials Receives three blends per triangle, normalized.
+	 */
+	void MarchingCube(
+		std::vector<Triangle3D<float>> & resultTries,
+		std::vector<Triangle3D<float>> & resultNormals,
+		std::vector<MaterialBlend> & resultMaterials,
 		const float isoThreshold,
 		const GridCell & grid);
 }
@@ -0,0 +1,202 @@
+#include <Daedalus.h>
+#include "MeshBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace utils {
+	namespace {
+		/**
+		 * Same winding as the tangent basis of the generated mesh component. The length of the
+		 * result is twice the area of the triangle.
+		 */
+		inline Vector3D<float> FaceNormal(const Triangle3D<float> & triangle) {
+			return (triangle.Point3 - triangle.Point1).Cross(triangle.Point2 - triangle.Point1);
+		}
+
+		inline Vector3D<float> SafeNormalize(const Vector3D<float> & vec) {
+			const float length2 = vec.Length2();
+			return length2 > 0 ? vec / std::sqrt(length2) : Vector3D<float>(0);
+		}
+	}
+
+	/********************************************************************************
+	 * MeshBuffer
+	 ********************************************************************************/
+
+	MeshBuffer::MeshBuffer() : BoundsMin(0), BoundsMax(0) {}
+
+	void MeshBuffer::Clear() {
+		Sections.clear();
+		BoundsMin.Reset(0, 0, 0);
+		BoundsMax.Reset(0, 0, 0);
+	}
+
+	bool MeshBuffer::IsEmpty() const {
+		return GetTriangleCount() == 0;
+	}
+
+	Uint64 MeshBuffer::GetTriangleCount() const {
+		Uint64 count = 0;
+		for (const auto & section : Sections)
+			count += section.GetTriangleCount();
+		return count;
+	}
+
+	Uint64 MeshBuffer::GetVertexCount() const {
+		Uint64 count = 0;
+		for (const auto & section : Sections)
+			count += section.GetVertexCount();
+		return count;
+	}
+
+	MeshSection & MeshBuffer::GetSection(const Uint32 materialId) {
+		for (auto & section : Sections) {
+			if (section.MaterialId == materialId)
+				return section;
+		}
+		Sections.push_back(MeshSection(materialId));
+		return Sections.back();
+	}
+
+	const MeshSection * MeshBuffer::FindSection(const Uint32 materialId) const {
+		for (const auto & section : Sections) {
+			if (section.MaterialId == materialId)
+				return &section;
+		}
+		return NULL;
+	}
+
+	void MeshBuffer::ExtendBounds(const Vector3D<float> & point) {
+		if (GetVertexCount() == 0) {
+			BoundsMin = point;
+			BoundsMax = point;
+			return;
+		}
+		for (Uint8 i = 0; i < 3; i++) {
+			BoundsMin[i] = std::min(BoundsMin[i], point[i]);
+			BoundsMax[i] = std::max(BoundsMax[i], point[i]);
+		}
+	}
+
+	void MeshBuffer::AddTriangle(const Triangle3D<float> & triangle, const Uint32 materialId) {
+		const Vector3D<float> normal = SafeNormalize(FaceNormal(triangle));
+		const Vector3D<float> * points[] = { &triangle.Point1, &triangle.Point2, &triangle.Point3 };
+
+		MeshSection & section = GetSection(materialId);
+		for (const auto point : points) {
+			ExtendBounds(*point);
+			section.Indices.push_back((Uint32) section.Positions.size());
+			section.Positions.push_back(*point);
+			section.Normals.push_back(normal);
+			if (section.IsBlended())
+				section.LayerWeights.push_back(Vector4D<float>(1, 0, 0, 0));
+		}
+	}
+
+	/********************************************************************************
+	 * MeshWelder
+	 ********************************************************************************/
+
+	MeshWelder::MeshWelder(MeshBuffer & buffer) : Buffer(buffer) {
+		// Vertices already in the buffer are never shared with the new triangles
+		SectionVertices.resize(buffer.Sections.size());
+	}
+
+	Uint32 MeshWelder::AddVertex(
+		MeshSection & section,
+		VertexMap & vertices,
+		const Vector3D<float> & position,
+		const Vector3D<float> & normal,
+		const MaterialBlend * blend
+	) {
+		const auto found = vertices.find(position);
+		if (found != vertices.end()) {
+			section.Normals[found->second] += normal;
+			return found->second;
+		}
+
+		Buffer.ExtendBounds(position);
+		const Uint32 index = (Uint32) section.Positions.size();
+		section.Positions.push_back(position);
+		section.Normals.push_back(normal);
+		if (blend) {
+			// Vertices added before the section was blended sit entirely on the first layer
+			section.LayerWeights.resize(index, Vector4D<float>(1, 0, 0, 0));
+			section.LayerWeights.push_back(ToLayerWeights(section, *blend));
+		}
+		vertices.insert({ position, index });
+		return index;
+	}
+
+	Vector4D<float> MeshWelder::ToLayerWeights(MeshSection & section, const MaterialBlend & blend) {
+		float weights[MeshSection::MAX_LAYERS] = { 0, 0, 0, 0 };
+		float sum = 0;
+		for (Uint8 i = 0; i < blend.Count; i++) {
+			if (blend.Ids[i] > MeshSection::MAX_LAYER_ID)
+				continue;
+			auto layer = std::find(section.Layers.begin(), section.Layers.end(), blend.Ids[i]);
+			if (layer == section.Layers.end()) {
+				if (section.Layers.size() == MeshSection::MAX_LAYERS)
+					continue;
+				section.Layers.push_back(blend.Ids[i]);
+				layer = section.Layers.end() - 1;
+			}
+			weights[layer - section.Layers.begin()] += blend.Weights[i];
+			sum += blend.Weights[i];
+		}
+
+		// Every material of the blend was dropped, fall back to the first layer
+		if (sum <= 0)
+			return Vector4D<float>(1, 0, 0, 0);
+		return Vector4D<float>(weights[0] / sum, weights[1] / sum, weights[2] / sum, weights[3] / sum);
+	}
+
+	void MeshWelder::AddTriangle(const Triangle3D<float> & triangle, const Uint32 materialId) {
+		if (triangle.Point1 == triangle.Point2 || triangle.Point2 == triangle.Point3 ||
+				triangle.Point3 == triangle.Point1)
+			return;
+
+		MeshSection & section = Buffer.GetSection(materialId);
+		SectionVertices.resize(Buffer.Sections.size());
+		VertexMap & vertices = SectionVertices[&section - &Buffer.Sections[0]];
+
+		const Vector3D<float> normal = FaceNormal(triangle);
+		section.Indices.push_back(AddVertex(section, vertices, triangle.Point1, normal));
+		section.Indices.push_back(AddVertex(section, vertices, triangle.Point2, normal));
+		section.Indices.push_back(AddVertex(section, vertices, triangle.Point3, normal));
+	}
+
+	void MeshWelder::AddTriangle(
+		const Triangle3D<float> & triangle,
+		const Triangle3D<float> & normals,
+		const MaterialBlend * blends,
+		const Uint32 materialId
+	) {
+		if (triangle.Point1 == triangle.Point2 || triangle.Point2 == triangle.Point3 ||
+				triangle.Point3 == triangle.Point1)
+			return;
+
+		MeshSection & section = Buffer.GetSection(materialId);
+		SectionVertices.resize(Buffer.Sections.size());
+		VertexMap & vertices = SectionVertices[&section - &Buffer.Sections[0]];
+
+		const Vector3D<float> face = SafeNormalize(FaceNormal(triangle));
+		const Vector3D<float> * points[] = { &triangle.Point1, &triangle.Point2, &triangle.Point3 };
+		const Vector3D<float> * pointNormals[] = { &normals.Point1, &normals.Point2, &normals.Point3 };
+		for (Uint8 i = 0; i < 3; i++) {
+			const Vector3D<float> & normal =
+				pointNormals[i]->Length2() > 0 ? SafeNormalize(*pointNormals[i]) : face;
+			section.Indices.push_back(
+				AddVertex(section, vertices, *points[i], normal, blends ? &blends[i] : NULL));
+		}
+	}
+
+	void MeshWelder::Finish() {
+		for (auto & section : Buffer.Sections) {
+			for (auto & normal : section.Normals)
+				normal = SafeNormalize(normal);
+		}
+		SectionVertices.clear();
+	}
+}
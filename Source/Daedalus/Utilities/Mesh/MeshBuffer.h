@@ -0,0 +1,128 @@
+#pragma once
+
+#include <Utilities/Integers.h>
+#include <Utilities/Algebra/Algebra3D.h>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace utils {
+	/**
+	 * Indexed triangles sharing a single material. The indices point into the vertices of
+	 * the section only, so every section maps directly onto its own vertex and index buffer.
+	 *
+	 * A section can also blend up to MAX_LAYERS layers of its material, such as the slices
+	 * of a texture array, with a weight for each layer at every vertex. Blending within the
+	 * material keeps the section in a single draw call. The layers are handed to the
+	 * renderer as bytes, so layers above MAX_LAYER_ID can't be blended.
+	 */
+	struct MeshSection {
+		static const Uint8 MAX_LAYERS = MaterialBlend::MAX_MATERIALS;
+		static const Uint32 MAX_LAYER_ID = 255;
+
+		Uint32 MaterialId;
+		std::vector<Vector3D<float>> Positions;
+		std::vector<Vector3D<float>> Normals;     // One per position
+		std::vector<Uint32> Indices;              // Three per triangle
+		std::vector<Uint32> Layers;               // Material layers blended by the section
+		std::vector<Vector4D<float>> LayerWeights; // One per position, empty if not blended
+
+		inline bool IsBlended() const { return !LayerWeights.empty(); }
+
+		explicit MeshSection(const Uint32 materialId) : MaterialId(materialId) {}
+
+		inline Uint64 GetTriangleCount() const { return Indices.size() / 3; }
+		inline Uint64 GetVertexCount() const { return Positions.size(); }
+	};
+
+	/**
+	 * Self-contained triangle mesh that can be built on any thread and handed over to a mesh
+	 * component in one piece. The mesh is split into one section per material.
+	 */
+	struct MeshBuffer {
+		std::vector<MeshSection> Sections;
+		Vector3D<float> BoundsMin;                // Only meaningful if the mesh isn't empty
+		Vector3D<float> BoundsMax;
+
+		MeshBuffer();
+
+		void Clear();
+
+		bool IsEmpty() const;
+		Uint64 GetTriangleCount() const;
+		Uint64 GetVertexCount() const;
+
+		/**
+		 * @return The section with the given material, which is created if it doesn't exist.
+		 *         The reference is invalidated when another section is created.
+		 */
+		MeshSection & GetSection(const Uint32 materialId);
+		const MeshSection * FindSection(const Uint32 materialId) const;
+
+		/**
+		 * Grows the bounds to fit the point.
+		 */
+		void ExtendBounds(const Vector3D<float> & point);
+
+		/**
+		 * Appends a triangle with 3 vertices of its own, all of them with the face normal.
+		 * Degenerate triangles get a zero normal.
+		 */
+		void AddTriangle(const Triangle3D<float> & triangle, const Uint32 materialId);
+	};
+
+	using MeshBufferPtr = std::shared_ptr<MeshBuffer>;
+	// Once handed over the buffer is shared read-only between the component and its renderer
+	using MeshBufferConstPtr = std::shared_ptr<const MeshBuffer>;
+
+	/**
+	 * Adds triangles to a mesh buffer, sharing a vertex between all the triangles of a section
+	 * that meet at exactly the same position. Triangles that collapse into a line or a point
+	 * are dropped. The normal of a shared vertex is the sum of the normals given for it, or
+	 * of the area weighted face normals if none are given, and is only normalized by Finish.
+	 */
+	class MeshWelder {
+	private:
+		using VertexMap = std::unordered_map<Vector3D<float>, Uint32>;
+
+		MeshBuffer & Buffer;
+		std::vector<VertexMap> SectionVertices;   // Parallel to the sections of the buffer
+
+		Uint32 AddVertex(
+			MeshSection & section,
+			VertexMap & vertices,
+			const Vector3D<float> & position,
+			const Vector3D<float> & normal,
+			const MaterialBlend * blend = NULL);
+
+		/**
+		 * @return The weight of each layer of the section, adding the layers of the blend
+		 *         while there is room.
+		 */
+		static Vector4D<float> ToLayerWeights(MeshSection & section, const MaterialBlend & blend);
+
+	public:
+		explicit MeshWelder(MeshBuffer & buffer);
+
+		void AddTriangle(const Triangle3D<float> & triangle, const Uint32 materialId);
+		/**
+		 * @param normals Normals of the vertices of the triangle. Vertices with a zero normal
+		 *                use the normal of the face instead.
+		 * @param blends If not NULL, the material layers of the three vertices. The layers are
+		 *               added to the section as they are first used. Once the section has
+		 *               MAX_LAYERS layers, the weights of any other layer are dropped, as
+		 *               are the weights of layers above MAX_LAYER_ID.
+		 */
+		void AddTriangle(
+			const Triangle3D<float> & triangle,
+			const Triangle3D<float> & normals,
+			const MaterialBlend * blends,
+			const Uint32 materialId);
+
+		/**
+		 * Normalizes the accumulated vertex normals. No more triangles can be added after this.
+		 */
+		void Finish();
+	};
+}
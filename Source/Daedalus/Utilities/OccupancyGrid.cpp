@@ -0,0 +1,67 @@
+#include <Daedalus.h>
+#include "OccupancyGrid.h"
+
+#include <algorithm>
+
+namespace utils {
+	// Bound by reference in std::min, which needs the member defined
+	const Uint32 OccupancyGrid3D::BRICK_SIZE;
+
+	OccupancyGrid3D::OccupancyGrid3D(const Uint32 size) :
+		Size(0), BrickCount(0), SolidCellCount(0), SolidBrickCount(0)
+	{
+		Reset(size);
+	}
+
+	void OccupancyGrid3D::Reset(const Uint32 size) {
+		Size = size;
+		BrickCount = (size + BRICK_SIZE - 1) / BRICK_SIZE;
+		Bricks.assign(BrickCount * BrickCount * BrickCount, 0);
+		SolidCellCount = 0;
+		SolidBrickCount = 0;
+	}
+
+	void OccupancyGrid3D::Clear() {
+		std::fill(Bricks.begin(), Bricks.end(), 0);
+		SolidCellCount = 0;
+		SolidBrickCount = 0;
+	}
+
+	void OccupancyGrid3D::Set(const Uint32 x, const Uint32 y, const Uint32 z, const bool value) {
+		Uint64 & brick = Bricks[BrickIndex(x / BRICK_SIZE, y / BRICK_SIZE, z / BRICK_SIZE)];
+		const Uint64 mask = CellMask(x, y, z);
+		const bool previous = (brick & mask) != 0;
+
+		if (previous == value)
+			return;
+
+		if (value) {
+			if (brick == 0)
+				SolidBrickCount++;
+			brick |= mask;
+			SolidCellCount++;
+		} else {
+			brick &= ~mask;
+			if (brick == 0)
+				SolidBrickCount--;
+			SolidCellCount--;
+		}
+	}
+
+	Uint32 OccupancyGrid3D::ValidCellCount(
+		const Uint32 bx, const Uint32 by, const Uint32 bz
+	) const {
+		const auto extent = [&] (const Uint32 b) {
+			return std::min(BRICK_SIZE, Size - b * BRICK_SIZE);
+		};
+		return extent(bx) * extent(by) * extent(bz);
+	}
+
+	bool OccupancyGrid3D::IsBrickFull(const Uint32 bx, const Uint32 by, const Uint32 bz) const {
+		Uint64 brick = Bricks[BrickIndex(bx, by, bz)];
+		Uint32 count = 0;
+		for (; brick != 0; count++)
+			brick &= brick - 1;
+		return count == ValidCellCount(bx, by, bz);
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Utilities/Integers.h>
+
+#include <vector>
+
+namespace utils {
+	/**
+	 * Packed occupancy bitset for a cubic grid of cells. The cells are grouped into 4x4x4
+	 * bricks and every brick is stored in a single 64-bit word, which means the brick level
+	 * of the min/max mip comes for free: an empty brick is a zero word, and a full brick has
+	 * all of its valid bits set. The grid level is tracked with running counters so that
+	 * completely empty or completely solid chunks can be rejected without touching the bits.
+	 */
+	class OccupancyGrid3D {
+	public:
+		static const Uint32 BRICK_SIZE = 4;
+
+	private:
+		Uint32 Size;                      // Number of cells along a single edge
+		Uint32 BrickCount;                // Number of bricks along a single edge
+		std::vector<Uint64> Bricks;       // One word per brick, one bit per cell
+		Uint64 SolidCellCount;
+		Uint64 SolidBrickCount;
+
+		inline Uint64 BrickIndex(const Uint32 bx, const Uint32 by, const Uint32 bz) const {
+			return (bx * BrickCount + by) * BrickCount + bz;
+		}
+
+		inline Uint64 CellMask(const Uint32 x, const Uint32 y, const Uint32 z) const {
+			return Uint64(1) << (
+				(x % BRICK_SIZE) +
+				(y % BRICK_SIZE) * BRICK_SIZE +
+				(z % BRICK_SIZE) * BRICK_SIZE * BRICK_SIZE);
+		}
+
+		/**
+		 * Number of cells of the given brick that actually fall within the grid. Only the
+		 * bricks on the upper edges can be partial, when the size isn't a multiple of 4.
+		 */
+		Uint32 ValidCellCount(const Uint32 bx, const Uint32 by, const Uint32 bz) const;
+
+	public:
+		OccupancyGrid3D() : OccupancyGrid3D(0) {}
+		explicit OccupancyGrid3D(const Uint32 size);
+
+		/**
+		 * Resizes the grid and clears all the cells.
+		 */
+		void Reset(const Uint32 size);
+		void Clear();
+
+		inline Uint32 GetSize() const { return Size; }
+		inline Uint32 GetBrickCount() const { return BrickCount; }
+
+		inline bool Get(const Uint32 x, const Uint32 y, const Uint32 z) const {
+			return (Bricks[BrickIndex(x / BRICK_SIZE, y / BRICK_SIZE, z / BRICK_SIZE)] &
+				CellMask(x, y, z)) != 0;
+		}
+
+		void Set(const Uint32 x, const Uint32 y, const Uint32 z, const bool value);
+
+		/**
+		 * Brick level queries, indexed in bricks rather than cells.
+		 */
+		inline bool IsBrickEmpty(const Uint32 bx, const Uint32 by, const Uint32 bz) const {
+			return Bricks[BrickIndex(bx, by, bz)] == 0;
+		}
+		bool IsBrickFull(const Uint32 bx, const Uint32 by, const Uint32 bz) const;
+
+		/**
+		 * Checks if the brick containing the given cell is empty.
+		 */
+		inline bool IsBrickEmptyAt(const Uint32 x, const Uint32 y, const Uint32 z) const {
+			return IsBrickEmpty(x / BRICK_SIZE, y / BRICK_SIZE, z / BRICK_SIZE);
+		}
+
+		/**
+		 * Grid level queries.
+		 */
+		inline bool IsEmpty() const { return SolidCellCount == 0; }
+		inline bool IsFull() const { return SolidCellCount == Uint64(Size) * Size * Size; }
+		inline Uint64 GetSolidCellCount() const { return SolidCellCount; }
+		inline Uint64 GetSolidBrickCount() const { return SolidBrickCount; }
+	};
+}
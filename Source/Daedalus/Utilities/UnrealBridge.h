@@ -12,4 +12,6 @@ namespace utils {
 
 	inline Vector3D<> ToVector3D(const FVector & fv) { return Vector3D<>(fv.X, fv.Y, fv.Z); }
 	inline FVector ToFVector(const Vector3D<> & vec) { return FVector(vec.X, vec.Y, vec.Z); }
+	inline Vector3D<float> ToVector3DF(const FVector & fv) { return Vector3D<float>(fv.X, fv.Y, fv.Z); }
+	inline FVector ToFVector(const Vector3D<float> & vec) { return FVector(vec.X, vec.Y, vec.Z); }
 }
@@ -88,3 +88,26 @@ TEST(Vector2D, Normalizes) {
 	ASSERT_TRUE(DoubleEquals(v3.Normalize().Length(), 1.0));
 	ASSERT_TRUE(DoubleEquals(v4.Normalize().Length(), 1.0));
 }
+
+/*************************************************************
+ * Tensor2D Tests
+ *************************************************************/
+
+TEST(TensorFixed2D, IndexesNonSquare) {
+	TensorFixed2D<Uint32, 3, 5> tensor(0);
+	ASSERT_EQ(3, tensor.GetWidth());
+	ASSERT_EQ(5, tensor.GetDepth());
+	for (Uint32 x = 0; x < 3; x++) {
+		for (Uint32 y = 0; y < 5; y++)
+			tensor.Set(x, y, x * 5 + y);
+	}
+	for (Uint32 x = 0; x < 3; x++) {
+		for (Uint32 y = 0; y < 5; y++)
+			ASSERT_EQ(x * 5 + y, tensor.Get(x, y));
+	}
+#if DAEDALUS_TENSOR_BOUNDS_CHECK
+	ASSERT_THROW(tensor.Get(3, 0), StringException);
+	ASSERT_THROW(tensor.Get(0, 5), StringException);
+#endif
+}
+
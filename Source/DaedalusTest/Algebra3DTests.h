@@ -2,8 +2,13 @@
 
 #include <gtest/gtest.h>
 #include <Utilities/Algebra/Algebra3D.h>
+#include <Utilities/Algebra/BoundingBoxBatch3D.h>
 #include <Utilities/Constants.h>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <random>
+#include <type_traits>
 
 using namespace utils;
 
@@ -81,6 +86,142 @@ TEST(Vector3D, Normalizes) {
 	ASSERT_TRUE(DoubleEquals(v5.Normalize().Length(), 1.0));
 }
 
+TEST(Vector3D, FloatMatchesGeneric) {
+	std::mt19937 gen(7);
+	std::uniform_real_distribution<float> dis(-100, 100);
+	for (Uint32 i = 0; i < 100; i++) {
+		const float ax = dis(gen), ay = dis(gen), az = dis(gen);
+		const float bx = dis(gen), by = dis(gen), bz = dis(gen);
+		const float s = dis(gen);
+		const Vector3D<float> a(ax, ay, az), b(bx, by, bz);
+
+		// The generic version computes in single precision too, so the results are identical
+		ASSERT_EQ(ax * ax + ay * ay + az * az, a.Length2());
+		ASSERT_EQ(ax * bx + ay * by + az * bz, a.Dot(b));
+		ASSERT_TRUE(a + b == Vector3D<float>(ax + bx, ay + by, az + bz));
+		ASSERT_TRUE(a - b == Vector3D<float>(ax - bx, ay - by, az - bz));
+		ASSERT_TRUE(a * b == Vector3D<float>(ax * bx, ay * by, az * bz));
+		ASSERT_TRUE(a / b == Vector3D<float>(ax / bx, ay / by, az / bz));
+		ASSERT_TRUE(a * s == Vector3D<float>(ax * s, ay * s, az * s));
+		ASSERT_TRUE(-a == Vector3D<float>(-ax, -ay, -az));
+		ASSERT_TRUE(a.Cross(b) == (a.Cross<float, float>(b)));
+		ASSERT_TRUE(EEq(a.Normalize().Length(), 1, FLOAT_ERROR));
+
+		Vector3D<float> c(a);
+		c += b;
+		c *= s;
+		ASSERT_TRUE(c == (a + b) * s);
+		ASSERT_FALSE(c == c + Vector3D<float>(0, 0, 1));
+	}
+
+	const Vector3D<float> v(0, 1, 2);
+	ASSERT_TRUE(v.IsBoundedBy(0, 3));
+	ASSERT_FALSE(v.IsBoundedBy(0, 2));
+	ASSERT_TRUE(v.IsBoundedBy(0, 2, true, true));
+	ASSERT_FALSE(v.IsBoundedBy(0, 2, false, true));
+	ASSERT_EQ(2.0f, v[2]);
+}
+
+namespace {
+	// The padding lane of the SIMD vectors is loaded with the rest, but must never count
+	Vector3D<float> WithPadding(const Vector3D<float> & vec, const float pad) {
+		Vector3D<float> padded(vec.X, vec.Y, vec.Z);
+#ifdef DAEDALUS_SIMD_SSE
+		padded.Pad = pad;
+#endif
+		return padded;
+	}
+}
+
+TEST(Vector3D, FloatMatchesDouble) {
+#ifdef DAEDALUS_SIMD_SSE
+	ASSERT_TRUE((std::is_same<float, decltype(Vector3D<float>().Length())>::value));
+#endif
+
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	std::mt19937 gen(11);
+	std::uniform_real_distribution<float> dis(-100, 100);
+	for (Uint32 i = 0; i < 100; i++) {
+		const Vector3D<float> a(dis(gen), dis(gen), dis(gen)), b(dis(gen), dis(gen), dis(gen));
+		const auto da = a.Cast<double>(), db = b.Cast<double>();
+		const auto pa = WithPadding(a, nan), pb = WithPadding(b, 1E30f);
+
+		ASSERT_EQ(a.Dot(b), pa.Dot(pb));
+		ASSERT_NEAR(da.Dot(db), pa.Dot(pb), 1E-2);
+		ASSERT_TRUE(pa.Cross(pb) == (a.Cross<float, float>(b)));
+		const auto cross = pa.Cross(pb).Cast<double>();
+		const auto expected = da.Cross(db);
+		for (Uint8 axis = 0; axis < 3; axis++)
+			ASSERT_NEAR(expected[axis], cross[axis], 1E-2);
+
+		const auto normal = pa.Normalize().Cast<double>();
+		const auto expectedNormal = da.Normalize();
+		for (Uint8 axis = 0; axis < 3; axis++)
+			ASSERT_NEAR(expectedNormal[axis], normal[axis], FLOAT_ERROR);
+		ASSERT_NEAR(da.Length(), pa.Length(), 1E-3);
+	}
+}
+
+TEST(Vector3D, FloatComparesLikeDouble) {
+	// Small integers, so that points often lie exactly on the bounds
+	std::mt19937 gen(13);
+	std::uniform_int_distribution<Int32> dis(-3, 3);
+	const auto random = [&] {
+		return Vector3D<float>((float) dis(gen), (float) dis(gen), (float) dis(gen));
+	};
+	for (Uint32 i = 0; i < 500; i++) {
+		const auto a = random(), min = random(), max = random();
+		const auto pa = WithPadding(a, -1E30f);
+		const auto pmin = WithPadding(min, 1E30f), pmax = WithPadding(max, -1E30f);
+		const auto da = a.Cast<double>(), dmin = min.Cast<double>(), dmax = max.Cast<double>();
+
+		for (Uint8 inclusion = 0; inclusion < 4; inclusion++) {
+			const bool bMin = (inclusion & 1) != 0, bMax = (inclusion & 2) != 0;
+			ASSERT_EQ(
+				da.IsBoundedBy(dmin, dmax, bMin, bMax),
+				pa.IsBoundedBy(pmin, pmax, bMin, bMax));
+			ASSERT_EQ(
+				da.IsBoundedBy(dmin.X, dmax.X, bMin, bMax),
+				pa.IsBoundedBy(min.X, max.X, bMin, bMax));
+		}
+
+		ASSERT_EQ(da == dmin, pa == pmin);
+		ASSERT_TRUE(pa == WithPadding(a, 1));
+	}
+}
+
+TEST(Vector4D, FloatMatchesGeneric) {
+	const Vector4D<float> a(1, 2, 3, 4), b(-2, 0.5f, 6, 0.25f);
+	ASSERT_EQ(1 * -2 + 2 * 0.5 + 3 * 6 + 4 * 0.25, a.Dot(b));
+	ASSERT_EQ(14.0, a.Length2());
+	ASSERT_TRUE(a.Truncate() == Vector3D<float>(1, 2, 3));
+
+	const auto cross = a.Cross(b);
+	ASSERT_TRUE(cross.Truncate() == a.Truncate().Cross(b.Truncate()));
+	ASSERT_EQ(0.0f, cross.W);
+
+#ifdef DAEDALUS_SIMD_SSE
+	ASSERT_TRUE((std::is_same<float, decltype(a.Dot(b))>::value));
+	ASSERT_TRUE((std::is_same<float, decltype(a.Length())>::value));
+#endif
+
+	std::mt19937 gen(17);
+	std::uniform_real_distribution<float> dis(-100, 100);
+	for (Uint32 i = 0; i < 100; i++) {
+		const Vector4D<float> c(dis(gen), dis(gen), dis(gen), dis(gen));
+		const Vector4D<float> d(dis(gen), dis(gen), dis(gen), dis(gen));
+
+		// The generic template, instantiated through the mixed type overloads
+		ASSERT_EQ(c.Dot<float>(d), c.Dot(d));
+		ASSERT_TRUE(c.Cross(d).Truncate() == (c.Cross<float, float>(d).Truncate()));
+		ASSERT_EQ(0.0f, c.Cross(d).W);
+
+		// W takes the padding lane of the truncated vector, and isn't part of its length
+		ASSERT_EQ(c.Truncate().Length2(), c.Length2());
+		ASSERT_EQ(Vector4D<float>(c.Truncate(), 0).Length2(), c.Length2());
+	}
+}
+
 
 
 /*************************************************************
@@ -162,6 +303,138 @@ TEST(Matrix4D, RotationTransformZ) {
 
 
 
+/*************************************************************
+ * Tensor3D Tests
+ *************************************************************/
+
+template <typename L>
+void TestTensorLayout() {
+	Tensor3D<Uint32, L> tensor(5, 3, 7, 0);
+	ASSERT_EQ(Vector3D<Uint32>(5, 3, 7), tensor.Size());
+	for (Uint32 x = 0; x < 5; x++) {
+		for (Uint32 y = 0; y < 3; y++) {
+			for (Uint32 z = 0; z < 7; z++)
+				tensor.Set(x, y, z, (x * 3 + y) * 7 + z);
+		}
+	}
+
+	Uint32 count = 0;
+	tensor.ForEach([&] (const Uint32 x, const Uint32 y, const Uint32 z, const Uint32 value) {
+		ASSERT_EQ((x * 3 + y) * 7 + z, value);
+		count++;
+	});
+	ASSERT_EQ(5 * 3 * 7, count);
+
+	for (Uint32 x = 0; x < 4; x++) {
+		for (Uint32 y = 0; y < 2; y++) {
+			for (Uint32 z = 0; z < 6; z++) {
+				const auto corners = tensor.GetCorners(x, y, z);
+				for (Uint8 i = 0; i < 8; i++)
+					ASSERT_EQ(tensor.Get(x + (i >> 2), y + (i >> 1 & 1), z + (i & 1)), corners[i]);
+			}
+		}
+	}
+
+	count = 0;
+	tensor.ForEachInRange(
+		Vector3D<Uint32>(1, 2, 0), Vector3D<Uint32>(4, 3, 7),
+		[&] (const Uint32 x, const Uint32 y, const Uint32 z, Uint32 & value) {
+			ASSERT_EQ(2, y);
+			value = 0;
+			count++;
+		});
+	ASSERT_EQ(3 * 7, count);
+	ASSERT_EQ(0, tensor.Get(3, 2, 6));
+	ASSERT_EQ(20, tensor.Get(0, 2, 6));
+
+#if DAEDALUS_TENSOR_BOUNDS_CHECK
+	ASSERT_THROW(tensor.Get(5, 0, 0), StringException);
+	ASSERT_THROW(tensor.Get(0, 3, 0), StringException);
+	ASSERT_THROW(tensor.Get(0, 0, 7), StringException);
+#endif
+}
+
+TEST(Tensor3D, LinearLayout) { TestTensorLayout<LinearLayout>(); }
+TEST(Tensor3D, BrickedLayout) { TestTensorLayout<BrickedLayout>(); }
+TEST(Tensor3D, MortonLayout) { TestTensorLayout<MortonLayout>(); }
+
+/*
+ Release builds don't check bounds, so a layout that maps two coordinates to the same index,
+ or past the storage, would silently corrupt the tensor.
+ */
+template <typename L>
+void TestLayoutIsBijective(const Uint32 width, const Uint32 depth, const Uint32 height) {
+	const Uint64 capacity = L::Capacity(width, depth, height);
+	ASSERT_LE((Uint64) width * depth * height, capacity);
+	std::vector<bool> used(capacity, false);
+	for (Uint32 x = 0; x < width; x++) {
+		for (Uint32 y = 0; y < depth; y++) {
+			for (Uint32 z = 0; z < height; z++) {
+				const Uint64 index = L::Index(x, y, z, width, depth, height);
+				ASSERT_LT(index, capacity);
+				ASSERT_FALSE(used[index]);
+				used[index] = true;
+			}
+		}
+	}
+
+	// Resized tensors use the same sizes, and hold every value they are given
+	TensorResizable3D<Uint32, L> tensor;
+	tensor.Reset(width, depth, height, 0);
+	for (Uint32 x = 0; x < width; x++) {
+		for (Uint32 y = 0; y < depth; y++) {
+			for (Uint32 z = 0; z < height; z++)
+				tensor.Set(x, y, z, (x * depth + y) * height + z);
+		}
+	}
+	for (Uint32 x = 0; x < width; x++) {
+		for (Uint32 y = 0; y < depth; y++) {
+			for (Uint32 z = 0; z < height; z++)
+				ASSERT_EQ((x * depth + y) * height + z, tensor.Get(x, y, z));
+		}
+	}
+}
+
+template <typename L>
+void TestLayoutSizes() {
+	TestLayoutIsBijective<L>(5, 3, 7);
+	TestLayoutIsBijective<L>(6, 9, 5);
+	TestLayoutIsBijective<L>(17, 1, 13);
+	TestLayoutIsBijective<L>(1, 1, 1);
+}
+
+TEST(Tensor3D, LinearLayoutIsBijective) { TestLayoutSizes<LinearLayout>(); }
+TEST(Tensor3D, BrickedLayoutIsBijective) { TestLayoutSizes<BrickedLayout>(); }
+TEST(Tensor3D, MortonLayoutIsBijective) { TestLayoutSizes<MortonLayout>(); }
+
+TEST(TensorFixed3D, MatchesTensor3D) {
+	TensorFixed3D<Uint32, 5, 3, 7> fixed;
+	Tensor3D<Uint32> tensor(5, 3, 7);
+	ASSERT_EQ(tensor.Size(), fixed.Size());
+	const Uint32 count = fixed.COUNT;
+	ASSERT_EQ(5 * 3 * 7, count);
+	for (Uint32 x = 0; x < 5; x++) {
+		for (Uint32 y = 0; y < 3; y++) {
+			for (Uint32 z = 0; z < 7; z++) {
+				ASSERT_EQ(0, fixed.Get(x, y, z));
+				fixed.Set(x, y, z, (x * 3 + y) * 7 + z);
+				tensor.Set(x, y, z, (x * 3 + y) * 7 + z);
+			}
+		}
+	}
+	for (Uint32 x = 0; x < 4; x++) {
+		for (Uint32 y = 0; y < 2; y++) {
+			for (Uint32 z = 0; z < 6; z++)
+				ASSERT_EQ(tensor.GetCorners(x, y, z), fixed.GetCorners(x, y, z));
+		}
+	}
+	fixed.Fill(3);
+	ASSERT_EQ(3, fixed.Get(4, 2, 6));
+#if DAEDALUS_TENSOR_BOUNDS_CHECK
+	ASSERT_THROW(fixed.Get(0, 3, 0), StringException);
+#endif
+}
+
 /*************************************************************
  * Bounding Box Tests
  *************************************************************/
@@ -202,3 +475,75 @@ TEST(OrientedBoundingBox3D, GetsEnclosingBoundingBox3) {
 	ASSERT_TRUE(EEq(box.MinPoint, { -0.5, 2, 0.5 }));
 	ASSERT_TRUE(EEq(box.MaxPoint, { 0.5 + sqrt2 / 2, sqrt2 + 2, 0.5 + sqrt2 / 2 + 1 }));
 }
+
+/*************************************************************
+ * Bounding Box Batch Tests
+ *************************************************************/
+
+namespace {
+	OrientedBoundingBox3D CreateRandomBox(std::mt19937 & rng) {
+		std::uniform_real_distribution<> position(-4, 4);
+		std::uniform_real_distribution<> size(0.25, 3);
+		std::uniform_int_distribution<> angle(0, 7);
+		const Vector3D<> min(position(rng), position(rng), position(rng));
+		const Vector3D<> max = min + Vector3D<>(size(rng), size(rng), size(rng));
+		return OrientedBoundingBox3D(
+			min, max,
+			CreateRotation(angle(rng) * 45.0, AXIS_X) *
+			CreateRotation(angle(rng) * 30.0, AXIS_Y) *
+			CreateTranslation({ position(rng), position(rng), position(rng) }));
+	}
+}
+
+TEST(OrientedBoundingBoxBatch3D, MatchesBoundingBoxIntersection) {
+	std::mt19937 rng(1234);
+	std::vector<OrientedBoundingBox3D> boxes;
+	OrientedBoundingBoxBatch3D batch;
+	for (Uint32 i = 0; i < 37; i++) {
+		boxes.push_back(CreateRandomBox(rng));
+		ASSERT_EQ(i, batch.Add(boxes.back()));
+	}
+
+	std::vector<Uint64> hitMask;
+	for (Uint32 q = 0; q < 200; q++) {
+		const OrientedBoundingBox3D query = CreateRandomBox(rng);
+		const AxisAlignedBoundingBox3D aabbQuery = query.GetEnclosingBoundingBox();
+		for (const bool isInclusive : { true, false }) {
+			batch.Intersect(query, hitMask, isInclusive);
+			for (Uint32 i = 0; i < boxes.size(); i++) {
+				const bool hit = (hitMask[i / 64] >> (i % 64) & 1) != 0;
+				ASSERT_EQ(query.BoundingBoxIntersection(boxes[i], isInclusive), hit);
+			}
+
+			batch.Intersect(aabbQuery, hitMask, isInclusive);
+			for (Uint32 i = 0; i < boxes.size(); i++) {
+				const bool hit = (hitMask[i / 64] >> (i % 64) & 1) != 0;
+				ASSERT_EQ(aabbQuery.BoundingBoxIntersection(boxes[i], isInclusive), hit);
+			}
+		}
+	}
+}
+
+TEST(OrientedBoundingBoxBatch3D, TouchingBoxes) {
+	OrientedBoundingBoxBatch3D batch;
+	batch.Add(OrientedBoundingBox3D({ 0, 0, 0 }, { 1, 1, 1 }, CreateTranslation({ 1, 0, 0 })));
+	batch.Add(OrientedBoundingBox3D({ 0, 0, 0 }, { 1, 1, 1 }, CreateTranslation({ 3, 0, 0 })));
+	batch.Add(OrientedBoundingBox3D({ 0, 0, 0 }, { 1, 1, 1 }, CreateRotation(45, AXIS_Z)), { 0.5, 0.5, 0 });
+
+	const AxisAlignedBoundingBox3D query({ 0, 0, 0 }, { 1, 1, 1 });
+	std::vector<Uint64> hitMask;
+	ASSERT_TRUE(batch.Intersect(query, hitMask, true));
+	ASSERT_EQ(5, hitMask[0]);
+	ASSERT_TRUE(batch.Intersect(query, hitMask, false));
+	ASSERT_EQ(4, hitMask[0]);
+
+	const auto found = batch.FindFirstIntersection(query, false);
+	ASSERT_TRUE(found.IsValid());
+	ASSERT_EQ(2, *found);
+
+	batch.RemoveSwap(0);
+	ASSERT_EQ(2, batch.Size());
+	ASSERT_EQ(0, *batch.FindFirstIntersection(query, false));
+	ASSERT_FALSE(batch.FindFirstIntersection(
+		AxisAlignedBoundingBox3D({ 10, 10, 10 }, { 11, 11, 11 })).IsValid());
+}
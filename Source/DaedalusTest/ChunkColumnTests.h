@@ -0,0 +1,38 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Models/Terrain/TerrainEditing.h>
+
+using namespace utils;
+using namespace terrain;
+
+/*************************************************************
+ * ChunkColumn Tests
+ *************************************************************/
+
+TEST(ChunkColumn, SkipsUniformChunksAroundTheSurface) {
+	// Surface heights of 1000 to 2500 over the 3x3 columns, with chunks 1000 high
+	ChunkColumnSummary summary(1800);
+	summary.Include(1000);
+	summary.Include(2500);
+	ASSERT_EQ(E_Buried, summary.Classify(-2, 1000));
+	// Solid itself, but the chunk above it holds part of the surface
+	ASSERT_EQ(E_Surface, summary.Classify(-1, 1000));
+	ASSERT_EQ(E_Surface, summary.Classify(3, 1000));
+	ASSERT_EQ(E_Sky, summary.Classify(4, 1000));
+
+	// Uniform chunks share one field until they are edited
+	auto density = std::make_shared<ChunkData::DensityField>(16, 16, 16, 0.0f);
+	auto materials = std::make_shared<ChunkData::MaterialField>(16, 16, 16, 0);
+	ChunkData a(16, ChunkOffsetVector(0, 0, 5), density, materials);
+	ChunkData b(16, ChunkOffsetVector(1, 0, 5), density, materials);
+	ASSERT_TRUE(a.DensityData.Share() == b.DensityData.Share());
+
+	ChunkCellRange changed;
+	ASSERT_TRUE(ApplyTerrainEdit(TerrainEdit(E_Fill, E_Box,
+		ChunkPositionVector(a.ChunkOffset, Point3D(8, 8, 8)), Vector3D<>(2, 2, 2)), a, changed));
+	ASSERT_FALSE(a.DensityData.Share() == b.DensityData.Share());
+	ASSERT_EQ(1.0f, a.DensityData->Get(8, 8, 8));
+	ASSERT_EQ(0.0f, b.DensityData->Get(8, 8, 8));
+	ASSERT_EQ(0.0f, density->Get(8, 8, 8));
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Models/Terrain/ChunkDelta.h>
+#include <Models/Terrain/TerrainEditing.h>
+
+#include <sstream>
+
+using namespace utils;
+using namespace terrain;
+
+/*************************************************************
+ * ChunkDelta Tests
+ *************************************************************/
+
+namespace {
+	// Stands in for the generator, ground up to a height of 6 samples
+	void GenerateChunkDeltaBase(ChunkData & data) {
+		for (Uint32 x = 0; x < 8; x++) {
+			for (Uint32 y = 0; y < 8; y++) {
+				for (Uint32 z = 0; z < 8; z++)
+					data.DensityData.Mutable().Set(x, y, z, z < 6 ? 1.0f : 0.0f);
+			}
+		}
+	}
+}
+
+TEST(ChunkDelta, RestoresEditsOnRegeneratedBase) {
+	const items::ItemDataFactory factory;
+	const ChunkOffsetVector offset(3, -1, 0);
+	ChunkData base(8, offset), edited(8, offset);
+	GenerateChunkDeltaBase(base);
+	GenerateChunkDeltaBase(edited);
+
+	ChunkCellRange changed;
+	ApplyTerrainEdit(TerrainEdit(E_Dig, E_Box, ChunkPositionVector(offset, Point3D(2, 2, 5)),
+		Vector3D<>(1, 1, 0)), edited, changed);
+	ApplyTerrainEdit(TerrainEdit(E_Fill, E_Box, ChunkPositionVector(offset, Point3D(6, 6, 6)),
+		Vector3D<>(0, 0, 0), 7), edited, changed);
+
+	auto sofa = factory.BuildItemData(items::I_Sofa);
+	sofa->ItemId = 42;
+	sofa->Position = ChunkPositionVector(offset, Point3D(1.5, 4, 6));
+	sofa->SetRotation(items::ItemRotation(3, 0));
+	edited.PlacedItems.push_back(sofa);
+
+	const auto delta = CreateChunkDelta(base, edited);
+	ASSERT_EQ(10, delta.Samples.size());
+	ASSERT_EQ(1, delta.Items.size());
+	ASSERT_TRUE(CreateChunkDelta(base, base).IsEmpty());
+
+	ChunkDeltaMap saved, loaded;
+	saved[offset] = std::make_shared<ChunkDelta>(delta);
+	std::stringstream stream;
+	WriteChunkDeltas(stream, saved);
+	ReadChunkDeltas(stream, loaded);
+	ASSERT_EQ(1, loaded.size());
+
+	ChunkData restored(8, offset);
+	GenerateChunkDeltaBase(restored);
+	ApplyChunkDelta(*loaded[offset], factory, restored);
+	for (Uint32 x = 0; x < 8; x++) {
+		for (Uint32 y = 0; y < 8; y++) {
+			for (Uint32 z = 0; z < 8; z++) {
+				ASSERT_EQ(edited.DensityData->Get(x, y, z), restored.DensityData->Get(x, y, z));
+				ASSERT_EQ(edited.MaterialData->Get(x, y, z), restored.MaterialData->Get(x, y, z));
+			}
+		}
+	}
+
+	ASSERT_EQ(1, restored.PlacedItems.size());
+	const auto & item = restored.PlacedItems[0];
+	ASSERT_EQ(42, item->ItemId);
+	ASSERT_EQ(items::I_Sofa, item->Template.Type);
+	ASSERT_TRUE(item->Position.ChunkOffset == offset);
+	ASSERT_TRUE(item->Position.InnerOffset == Point3D(1.5, 4, 6));
+	ASSERT_TRUE(item->GetRotation() == items::ItemRotation(3, 0));
+	ASSERT_TRUE(item->bIsPlaced);
+}
+
+TEST(ChunkDelta, RejectsTruncatedInput) {
+	ChunkDeltaMap deltas;
+	ChunkDelta delta(ChunkOffsetVector(0, 0, 0));
+	delta.Samples.push_back({ 5, 0.5f, 2 });
+	deltas[delta.ChunkOffset] = std::make_shared<ChunkDelta>(delta);
+
+	std::stringstream stream;
+	WriteChunkDeltas(stream, deltas);
+	const auto bytes = stream.str();
+
+	std::stringstream truncated(bytes.substr(0, bytes.size() - 1));
+	ChunkDeltaMap loaded;
+	ASSERT_THROW(ReadChunkDeltas(truncated, loaded), StringException);
+
+	std::stringstream garbage("not a delta");
+	ASSERT_THROW(ReadChunkDeltas(garbage, loaded), StringException);
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Models/Terrain/ChunkKernels.h>
+
+#include <cmath>
+
+using namespace utils;
+using namespace terrain;
+
+/*************************************************************
+ * ChunkKernels Tests
+ *************************************************************/
+
+namespace {
+	ChunkDataSet CreateWavyChunks(const Uint32 cellCount) {
+		ChunkDataSet chunks;
+		for (Uint32 cx = 0; cx < 3; cx++) {
+			for (Uint32 cy = 0; cy < 3; cy++) {
+				for (Uint32 cz = 0; cz < 3; cz++) {
+					ChunkDataPtr data(new ChunkData(cellCount, ChunkOffsetVector(cx, cy, cz)));
+					for (Uint32 x = 0; x < cellCount; x++) {
+						for (Uint32 y = 0; y < cellCount; y++) {
+							const double height = cellCount * 1.5 +
+								4 * std::sin((cx * cellCount + x) * 0.3) * std::cos((cy * cellCount + y) * 0.2);
+							for (Uint32 z = 0; z < cellCount; z++) {
+								if (cz * cellCount + z < height) {
+									data->DensityData.Mutable().Set(x, y, z, 1);
+									data->MaterialData.Mutable().Set(x, y, z, (x / 3 + y / 5 + z) % 4);
+								}
+							}
+						}
+					}
+					chunks.Set(cx, cy, cz, data);
+				}
+			}
+		}
+		return chunks;
+	}
+
+	/*
+	 The density test of the kernels, read straight from the chunk data. Cells reaching
+	 outside of the set are solid.
+	 */
+	bool IsSolidInChunks(
+		const ChunkDataSet & chunks,
+		const Vector3D<Int64> & cell,
+		const Int64 cellCount
+	) {
+		double sum = 0;
+		for (Uint8 i = 0; i < 8; i++) {
+			const Int64 x = cell.X + (i >> 2) + cellCount;
+			const Int64 y = cell.Y + (i >> 1 & 1) + cellCount;
+			const Int64 z = cell.Z + (i & 1) + cellCount;
+			if (!Vector3D<Int64>(x, y, z).IsBoundedBy(0, 3 * cellCount))
+				return true;
+			const auto & data = *chunks.Get(x / cellCount, y / cellCount, z / cellCount);
+			sum += data.DensityData->Get(x % cellCount, y % cellCount, z % cellCount);
+		}
+		return EGT(sum, 0);
+	}
+
+	void TestKernels(const Uint32 cellCount) {
+		const auto & kernels = GetChunkKernels();
+		const auto chunks = CreateWavyChunks(cellCount);
+		const auto apron = UpdateChunkApron(NULL, chunks, kernels, cellCount);
+		ASSERT_TRUE(apron->IsCurrent(chunks));
+
+		OccupancyGrid3D solid(cellCount);
+		kernels.FillSolid(*apron, solid, cellCount);
+
+		for (Uint32 lod = 0; lod < 2; lod++) {
+			std::vector<Triangle3D<float>> triangles, plainTriangles;
+			ChunkMeshAttributes attributes;
+			kernels.GenerateMesh(*apron, 2.0, lod, 0, cellCount, triangles, &attributes, cellCount);
+			ASSERT_LT(0, triangles.size());
+			ASSERT_EQ(triangles.size(), attributes.Normals.size());
+			ASSERT_EQ(triangles.size() * 3, attributes.Materials.size());
+
+			// Meshing without attributes leaves the triangles unchanged
+			kernels.GenerateMesh(*apron, 2.0, lod, 0, cellCount, plainTriangles, NULL, cellCount);
+			ASSERT_EQ(triangles.size(), plainTriangles.size());
+			for (Uint64 i = 0; i < triangles.size(); i++) {
+				ASSERT_EQ(triangles[i].Point1, plainTriangles[i].Point1);
+				ASSERT_EQ(triangles[i].Point2, plainTriangles[i].Point2);
+				ASSERT_EQ(triangles[i].Point3, plainTriangles[i].Point3);
+			}
+		}
+
+		const Int64 n = cellCount;
+		for (Int64 x = -n - 1; x <= 2 * n; x += 3) {
+			for (Int64 y = -n - 1; y <= 2 * n; y += 5) {
+				for (Int64 z = -n - 1; z <= 2 * n; z++) {
+					const Vector3D<Int64> cell(x, y, z);
+					const bool isSolid = kernels.IsSolidAt(*apron, cell, cellCount);
+					ASSERT_EQ(IsSolidInChunks(chunks, cell, n), isSolid);
+					if (cell.IsBoundedBy(0, n))
+						ASSERT_EQ(solid.Get((Uint32) x, (Uint32) y, (Uint32) z), isSolid);
+				}
+			}
+		}
+	}
+}
+
+TEST(ChunkKernels, Size16MatchesChunkData) {
+	TestKernels(16);
+}
+
+TEST(ChunkKernels, Size32MatchesChunkData) {
+	TestKernels(32);
+}
+
+TEST(ChunkKernels, OddSizeMatchesChunkData) {
+	TestKernels(6);
+}
+
+TEST(ChunkKernels, GradientNormalsFaceOutwards) {
+	const auto & kernels = GetChunkKernels();
+	const auto apron = UpdateChunkApron(NULL, CreateWavyChunks(16), kernels, 16);
+	std::vector<Triangle3D<float>> triangles;
+	ChunkMeshAttributes attributes;
+	kernels.GenerateMesh(*apron, 1.0, 0, 0, 16, triangles, &attributes, 16);
+	const auto & normals = attributes.Normals;
+
+	// The gradient normals follow the faces they belong to, and never point into the ground
+	for (Uint64 i = 0; i < triangles.size(); i++) {
+		const auto & tri = triangles[i];
+		const auto face = (tri.Point3 - tri.Point1).Cross(tri.Point2 - tri.Point1);
+		const Vector3D<float> * vertexNormals[] = {
+			&normals[i].Point1, &normals[i].Point2, &normals[i].Point3 };
+		for (const auto normal : vertexNormals) {
+			ASSERT_LE(0.0f, face.Dot(*normal));
+			ASSERT_LE(0.0f, normal->Z);
+		}
+	}
+}
+
+TEST(ChunkKernels, FillsDensityBelowHeight) {
+	ChunkData data(16, ChunkOffsetVector(0, 0, 0));
+	GetChunkKernels().FillDensity(data, 5.5, 16);
+	for (Uint32 z = 0; z < 16; z++)
+		ASSERT_EQ(z < 6 ? 1.0f : 0.0f, data.DensityData->Get(3, 7, z));
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Controllers/EventBus/EventBus.h>
+#include <Models/Terrain/ChunkLoader.h>
+
+#include <memory>
+
+using namespace utils;
+using namespace terrain;
+using namespace items;
+
+/*************************************************************
+ * ChunkLoader Tests
+ *************************************************************/
+
+namespace {
+	// Outlives the items, which refer to its templates
+	const ItemDataFactory LoaderItemFactory;
+
+	// The game's parameters, the chunks around (0, 0, 5) lie above the surface
+	ChunkLoaderPtr CreateTestChunkLoader() {
+		const TerrainGeneratorParameters params(16, 12345678, 16 * 50);
+		const BiomeGeneratorParameters biomeParams({ 32, 12345678, 4, 1, 1, 64 * 0x1000 });
+		return std::make_shared<ChunkLoader>(params, std::make_shared<BiomeRegionLoader>(
+			biomeParams, std::make_shared<events::EventBus>()));
+	}
+
+	/*
+	 Places a sofa, which is two cells wide, at x = 15 of the chunk so that it reaches into
+	 the next chunk along x. It is registered the same way AChunk does.
+	 */
+	ItemDataPtr PlaceBorderItem(ChunkLoader & loader, const ChunkOffsetVector & offset) {
+		const auto item = LoaderItemFactory.BuildItemData(I_Sofa);
+		item->ItemId = 3;
+		item->Position = ChunkPositionVector(offset, Point3D(15, 8, 8));
+		item->SetRotation(ItemRotation(0, 0));
+		item->bIsPlaced = true;
+		const auto & chunks = loader.GetChunkSetAt(offset);
+		chunks.Get(1, 1, 1)->PlacedItems.push_back(item);
+		for (Uint32 x = 0; x < 3; x++) {
+			for (Uint32 y = 0; y < 3; y++) {
+				for (Uint32 z = 0; z < 3; z++) {
+					const Point3D offsetVector(
+						(1.0 - x) * 16.0, (1.0 - y) * 16.0, (1.0 - z) * 16.0);
+					chunks.Get(x, y, z)->ItemIndex.Insert(item, offsetVector);
+				}
+			}
+		}
+		return item;
+	}
+}
+
+TEST(ChunkLoader, ReloadsPlacedItemsOnce) {
+	auto loader = CreateTestChunkLoader();
+	const ChunkOffsetVector offset(0, 0, 5), next(1, 0, 5);
+	PlaceBorderItem(*loader, offset);
+	const auto nextChunk = loader->FindLoadedChunk(next);
+	ASSERT_EQ(1, nextChunk->ItemIndex.Size());
+
+	loader->UnloadChunk(offset);
+	ASSERT_FALSE(loader->FindLoadedChunk(offset));
+	ASSERT_EQ(0, nextChunk->ItemIndex.Size());
+
+	// The item comes back from the delta, and reaches into the next chunk once again
+	const auto reloaded = loader->GetChunkAt(offset);
+	ASSERT_EQ(1, reloaded->PlacedItems.size());
+	ASSERT_EQ(1, reloaded->ItemIndex.Size());
+	ASSERT_EQ(1, nextChunk->ItemIndex.Size());
+	const AxisAlignedBoundingBox3D inNext(Point3D(0.1, 8.1, 8.1), Point3D(0.9, 8.9, 8.9));
+	const auto found = nextChunk->ItemIndex.FindCollision(inNext);
+	ASSERT_TRUE(found.IsValid());
+	ASSERT_EQ(reloaded->PlacedItems[0], *found);
+}
+
+TEST(ChunkLoader, ReloadedChunksSeeNeighbourItems) {
+	auto loader = CreateTestChunkLoader();
+	const ChunkOffsetVector previous(-1, 0, 5), offset(0, 0, 5);
+	const auto item = PlaceBorderItem(*loader, previous);
+	ASSERT_EQ(1, loader->FindLoadedChunk(offset)->ItemIndex.Size());
+
+	// The chunk has no edits of its own, so it is generated again from scratch
+	loader->UnloadChunk(offset);
+	const auto reloaded = loader->GetChunkAt(offset);
+	ASSERT_TRUE(reloaded->PlacedItems.empty());
+	ASSERT_EQ(1, reloaded->ItemIndex.Size());
+	const AxisAlignedBoundingBox3D inChunk(Point3D(0.1, 8.1, 8.1), Point3D(0.9, 8.9, 8.9));
+	const auto found = reloaded->ItemIndex.FindCollision(inChunk);
+	ASSERT_TRUE(found.IsValid());
+	ASSERT_EQ(item, *found);
+}
+
+TEST(ChunkLoader, EditsUnloadTheChunksTheyLoad) {
+	auto loader = CreateTestChunkLoader();
+	const ChunkOffsetVector offset(0, 0, 5);
+	const TerrainEdit fill(E_Fill, E_Box, ChunkPositionVector(offset, Point3D(8, 8, 8)),
+		Vector3D<>(1, 1, 1), 2);
+
+	DirtyChunkMap dirty;
+	loader->ApplyEdit(fill, dirty);
+	ASSERT_EQ(0, loader->GetLoadedCount());
+	ASSERT_TRUE(dirty.find(offset) != dirty.end());
+
+	// The edit was kept as a delta
+	const auto chunk = loader->GetChunkAt(offset);
+	ASSERT_EQ(1.0f, chunk->DensityData->Get(8, 8, 8));
+	ASSERT_EQ(2, chunk->MaterialData->Get(8, 8, 8));
+	ASSERT_EQ(0.0f, chunk->DensityData->Get(4, 4, 4));
+
+	// Chunks that were already loaded stay loaded
+	loader->ApplyEdit(fill, dirty);
+	ASSERT_EQ(1, loader->GetLoadedCount());
+}
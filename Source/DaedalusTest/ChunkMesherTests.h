@@ -0,0 +1,332 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Models/Terrain/ChunkMesher.h>
+#include <Models/Terrain/TerrainEditing.h>
+#include <Utilities/Mesh/MeshBuffer.h>
+
+#include <cmath>
+#include <thread>
+
+using namespace utils;
+using namespace terrain;
+
+/*************************************************************
+ * MeshBuffer Tests
+ *************************************************************/
+
+TEST(MeshBuffer, AddsTriangles) {
+	MeshBuffer buffer;
+	ASSERT_TRUE(buffer.IsEmpty());
+
+	buffer.AddTriangle(Triangle3D<float>(
+		Vector3D<float>(0, 0, 0), Vector3D<float>(0, 2, 0), Vector3D<float>(2, 0, 0)), 3);
+	buffer.AddTriangle(Triangle3D<float>(
+		Vector3D<float>(1, 1, -1), Vector3D<float>(1, 1, -1), Vector3D<float>(1, 1, 4)), 5);
+
+	ASSERT_EQ(2, buffer.GetTriangleCount());
+	ASSERT_EQ(6, buffer.GetVertexCount());
+	ASSERT_EQ(2, buffer.Sections.size());
+	ASSERT_TRUE(buffer.FindSection(4) == NULL);
+
+	const MeshSection & section = *buffer.FindSection(3);
+	ASSERT_EQ(3u, section.MaterialId);
+	ASSERT_EQ(3, section.Normals.size());
+	for (Uint32 i = 0; i < 3; i++)
+		ASSERT_EQ(i, section.Indices[i]);
+
+	// (p3 - p1) x (p2 - p1), the winding the mesh component expects
+	ASSERT_TRUE(section.Normals[0] == Vector3D<float>(0, 0, 1));
+	ASSERT_TRUE(buffer.FindSection(5)->Normals[0] == Vector3D<float>(0));
+	ASSERT_TRUE(buffer.BoundsMin == Vector3D<float>(0, 0, -1));
+	ASSERT_TRUE(buffer.BoundsMax == Vector3D<float>(2, 2, 4));
+
+	buffer.Clear();
+	ASSERT_TRUE(buffer.IsEmpty());
+	ASSERT_TRUE(buffer.Sections.empty());
+}
+
+TEST(MeshWelder, SharesVerticesAndAveragesNormals) {
+	MeshBuffer buffer;
+	MeshWelder welder(buffer);
+
+	// Two faces of a roof meeting along the ridge from (0, 0, 1) to (0, 1, 1)
+	const Vector3D<float> ridge1(0, 0, 1), ridge2(0, 1, 1);
+	const Vector3D<float> left(-1, 0, 0), right(1, 0, 0);
+	welder.AddTriangle(Triangle3D<float>(left, ridge1, ridge2), 2);
+	welder.AddTriangle(Triangle3D<float>(right, ridge2, ridge1), 2);
+	welder.AddTriangle(Triangle3D<float>(ridge1, ridge1, right), 2);
+	welder.Finish();
+
+	ASSERT_EQ(1, buffer.Sections.size());
+	const MeshSection & section = buffer.Sections[0];
+	ASSERT_EQ(2, section.GetTriangleCount());
+	ASSERT_EQ(4, section.GetVertexCount());
+	ASSERT_EQ(section.Indices[1], section.Indices[5]);
+	ASSERT_TRUE(section.Positions[section.Indices[1]] == ridge1);
+
+	// The ridge is shared by both faces, so its normal points straight up
+	const auto & ridgeNormal = section.Normals[section.Indices[1]];
+	ASSERT_NEAR(0.0f, ridgeNormal.X, 1e-6f);
+	ASSERT_NEAR(0.0f, ridgeNormal.Y, 1e-6f);
+	ASSERT_NEAR(1.0f, std::abs(ridgeNormal.Z), 1e-6f);
+
+	const auto & leftNormal = section.Normals[section.Indices[0]];
+	ASSERT_NEAR(std::sqrt(0.5f), std::abs(leftNormal.X), 1e-6f);
+	ASSERT_NEAR(std::sqrt(0.5f), std::abs(leftNormal.Z), 1e-6f);
+}
+
+TEST(MeshWelder, DropsLayersTooLargeToPack) {
+	MeshBuffer buffer;
+	MeshWelder welder(buffer);
+	MaterialBlend blends[3];
+	for (auto & blend : blends) {
+		blend.Add(3, 1);
+		blend.Add(MeshSection::MAX_LAYER_ID + 1, 1);
+		blend.Normalize();
+	}
+	const Triangle3D<float> triangle(
+		Vector3D<float>(0, 0, 0), Vector3D<float>(1, 0, 0), Vector3D<float>(0, 1, 0));
+	welder.AddTriangle(triangle, Triangle3D<float>(Vector3D<float>(0), Vector3D<float>(0),
+		Vector3D<float>(0)), blends, 1);
+	welder.Finish();
+
+	const MeshSection & section = buffer.Sections[0];
+	ASSERT_EQ(1, section.Layers.size());
+	ASSERT_EQ(3u, section.Layers[0]);
+	for (const auto & weights : section.LayerWeights)
+		ASSERT_FLOAT_EQ(1.0f, weights.X);
+}
+
+TEST(MaterialBlend, KeepsHeaviestMaterials) {
+	MaterialBlend blend;
+	blend.Add(7, 1);
+	blend.Add(8, 0);
+	blend.Add(7, 2);
+	ASSERT_EQ(1, blend.Count);
+
+	blend.Add(1, 4);
+	blend.Add(2, 0.5f);
+	blend.Add(3, 1);
+	blend.Add(4, 2);
+	ASSERT_EQ(4, blend.Count);
+
+	blend.Normalize();
+	const Uint32 ids[] = { 1, 7, 4, 3 };
+	const float weights[] = { 0.4f, 0.3f, 0.2f, 0.1f };
+	for (Uint8 i = 0; i < blend.Count; i++) {
+		ASSERT_EQ(ids[i], blend.Ids[i]);
+		ASSERT_FLOAT_EQ(weights[i], blend.Weights[i]);
+	}
+}
+
+/*************************************************************
+ * ChunkMesher Tests
+ *************************************************************/
+
+namespace {
+	ChunkMeshRequest CreateFloorMeshRequest(const Uint32 cellCount) {
+		// Solid below the chunk, empty above it, and filled up to 8 grid cells in between
+		const double heights[] = { (double) cellCount, 7.5, 0 };
+		ChunkDataSet chunks;
+		for (Uint32 i = 0; i < 27; i++) {
+			ChunkDataPtr data(new ChunkData(cellCount, ChunkOffsetVector(i / 9, i / 3 % 3, i % 3)));
+			GetChunkKernels().FillDensity(*data, heights[i % 3], cellCount);
+			chunks.Set(i / 9, i / 3 % 3, i % 3, data);
+		}
+
+		ChunkMeshRequest request;
+		request.ChunkOffset = ChunkOffsetVector(4, 5, 6);
+		request.Version = 12;
+		request.Kernels = &GetChunkKernels();
+		request.Apron = UpdateChunkApron(NULL, chunks, *request.Kernels, cellCount);
+		request.Scale = 2;
+		request.CellCount = cellCount;
+		request.MaterialId = 1;
+		request.CollisionLod = 0;
+		return request;
+	}
+}
+
+TEST(ChunkMesher, BuildsMeshFromKernels) {
+	const Uint32 cellCount = 16;
+	const auto request = CreateFloorMeshRequest(cellCount);
+	std::vector<Triangle3D<float>> triangles;
+	request.Kernels->GenerateMesh(
+		*request.Apron, request.Scale, 0, 0, cellCount, triangles, NULL, cellCount);
+
+	const auto result = BuildChunkMesh(request);
+	ASSERT_TRUE(result.ChunkOffset == request.ChunkOffset);
+	ASSERT_EQ(12, result.Version);
+	ASSERT_TRUE(result.CollisionMesh == NULL);
+	ASSERT_LT(0, triangles.size());
+	ASSERT_EQ(1, result.Mesh->Sections.size());
+
+	// Every triangle is kept in order, but the vertices are shared between them
+	const MeshSection & section = result.Mesh->Sections[0];
+	ASSERT_EQ(1u, section.MaterialId);
+	ASSERT_EQ(triangles.size(), section.GetTriangleCount());
+	ASSERT_GT(triangles.size(), section.GetVertexCount());
+	for (Uint64 i = 0; i < triangles.size(); i++) {
+		ASSERT_TRUE(triangles[i].Point1 == section.Positions[section.Indices[i * 3]]);
+		ASSERT_TRUE(triangles[i].Point2 == section.Positions[section.Indices[i * 3 + 1]]);
+		ASSERT_TRUE(triangles[i].Point3 == section.Positions[section.Indices[i * 3 + 2]]);
+	}
+	for (const auto & normal : section.Normals)
+		ASSERT_TRUE(normal == Vector3D<float>(0, 0, 1));
+
+	// Without material data every vertex sits on material 0
+	ASSERT_EQ(1, section.Layers.size());
+	ASSERT_EQ(0u, section.Layers[0]);
+	ASSERT_EQ(section.GetVertexCount(), section.LayerWeights.size());
+	for (const auto & weights : section.LayerWeights) {
+		ASSERT_EQ(1.0f, weights.X);
+		ASSERT_EQ(0.0f, weights.Y + weights.Z + weights.W);
+	}
+
+	// A flat floor at 8 grid cells, scaled by 2
+	ASSERT_FLOAT_EQ(16.0f, result.Mesh->BoundsMin.Z);
+	ASSERT_FLOAT_EQ(16.0f, result.Mesh->BoundsMax.Z);
+}
+
+TEST(ChunkMesher, BlendsMaterialLayers) {
+	const Uint32 cellCount = 16;
+	auto request = CreateFloorMeshRequest(cellCount);
+	const auto & chunks = request.Apron->Chunks;
+	for (Uint32 i = 0; i < 27; i++) {
+		auto & data = *chunks.Get(i / 9, i / 3 % 3, i % 3);
+		for (Uint32 x = 0; x < cellCount; x++) {
+			for (Uint32 y = 0; y < cellCount; y++) {
+				for (Uint32 z = 0; z < cellCount; z++)
+					data.MaterialData.Mutable().Set(x, y, z, x < cellCount / 2 ? 3 : 5);
+			}
+		}
+		data.Version++;
+	}
+
+	// The apron only picks up the new materials once it is rebuilt
+	const auto stale = request.Apron;
+	ASSERT_FALSE(stale->IsCurrent(chunks));
+	request.Apron = UpdateChunkApron(stale, chunks, *request.Kernels, cellCount);
+	ASSERT_TRUE(request.Apron != stale);
+	ASSERT_TRUE(request.Apron == UpdateChunkApron(request.Apron, chunks, *request.Kernels, cellCount));
+
+	const auto result = BuildChunkMesh(request);
+	ASSERT_EQ(1, result.Mesh->Sections.size());
+	const MeshSection & section = result.Mesh->Sections[0];
+	ASSERT_TRUE(section.IsBlended());
+	ASSERT_EQ(2, section.Layers.size());
+	const Uint32 layer3 = section.Layers[0] == 3 ? 0 : 1;
+
+	// The floor vertices lie on the empty samples, so take the material of the solid sample
+	// below them. Sample 16 is the first sample of the next chunk.
+	for (Uint64 i = 0; i < section.GetVertexCount(); i++) {
+		const float x = section.Positions[i].X / request.Scale;
+		const auto & weights = section.LayerWeights[i];
+		ASSERT_FLOAT_EQ(1.0f, weights.X + weights.Y + weights.Z + weights.W);
+		const bool isLayer3 = x < 8 || x == 16;
+		ASSERT_FLOAT_EQ(isLayer3 ? 1.0f : 0.0f, layer3 == 0 ? weights.X : weights.Y);
+	}
+}
+
+TEST(ChunkMesher, BuildsCoarseCollisionMesh) {
+	auto request = CreateFloorMeshRequest(16);
+	request.CollisionLod = 1;
+
+	const auto result = BuildChunkMesh(request);
+	ASSERT_TRUE(result.CollisionMesh != NULL);
+	const auto & mesh = *result.Mesh;
+	const auto & collision = *result.CollisionMesh;
+	ASSERT_LT(0, collision.GetTriangleCount());
+	ASSERT_GE(mesh.GetTriangleCount() / 3, collision.GetTriangleCount());
+	ASSERT_TRUE(mesh.BoundsMin == collision.BoundsMin);
+	ASSERT_TRUE(mesh.BoundsMax == collision.BoundsMax);
+
+	// The level of detail is lowered until the chunk size is a multiple of the cube size
+	request.CellCount = 6;
+	request.Apron = CreateFloorMeshRequest(6).Apron;
+	request.CollisionLod = 3;
+	const auto fallback = BuildChunkMesh(request);
+	ASSERT_TRUE(fallback.CollisionMesh != NULL);
+	ASSERT_GT(fallback.Mesh->GetTriangleCount(), fallback.CollisionMesh->GetTriangleCount());
+
+	request.CellCount = 5;
+	request.Apron = CreateFloorMeshRequest(5).Apron;
+	ASSERT_TRUE(BuildChunkMesh(request).CollisionMesh == NULL);
+}
+
+TEST(ChunkMesher, SplicesDirtySlabsIntoPreviousMesh) {
+	const Uint32 cellCount = 16;
+	auto request = CreateFloorMeshRequest(cellCount);
+	const auto previous = BuildChunkMesh(request);
+	ASSERT_EQ(cellCount, previous.SlabTriangles.size());
+
+	// Nothing changed, so the previous mesh is reused as it is
+	request.PreviousMesh = previous.Mesh;
+	request.PreviousSlabTriangles = previous.SlabTriangles;
+	ASSERT_TRUE(BuildChunkMesh(request).Mesh == previous.Mesh);
+
+	// Dig a pit into the floor of the centre chunk
+	const auto chunks = request.Apron->Chunks;
+	const TerrainEdit dig(E_Dig, E_Sphere,
+		ChunkPositionVector(ChunkOffsetVector(1, 1, 1), Point3D(5, 8, 7)), Vector3D<>(3, 3, 3));
+	ChunkCellRange changed;
+	ASSERT_TRUE(ApplyTerrainEdit(dig, *chunks.Get(1, 1, 1), changed));
+	DirtyChunkMap dirty;
+	MarkDirtyCells(ChunkOffsetVector(1, 1, 1), changed, cellCount, dirty);
+	request.Apron = UpdateChunkApron(request.Apron, chunks, *request.Kernels, cellCount);
+	request.Dirty = dirty[ChunkOffsetVector(1, 1, 1)];
+	ASSERT_GT(cellCount - 1, request.Dirty.Max.X);
+
+	// Splicing gives the same mesh as building it from scratch
+	const auto spliced = BuildChunkMesh(request);
+	request.PreviousMesh = NULL;
+	const auto expected = BuildChunkMesh(request);
+	ASSERT_TRUE(expected.SlabTriangles == spliced.SlabTriangles);
+	ASSERT_LT(previous.Mesh->GetTriangleCount(), spliced.Mesh->GetTriangleCount());
+
+	const auto & section = spliced.Mesh->Sections[0];
+	const auto & expectedSection = expected.Mesh->Sections[0];
+	ASSERT_TRUE(expectedSection.Indices == section.Indices);
+	ASSERT_TRUE(expectedSection.Layers == section.Layers);
+	for (Uint64 i = 0; i < section.GetVertexCount(); i++) {
+		ASSERT_TRUE(expectedSection.Positions[i] == section.Positions[i]);
+		ASSERT_NEAR(1.0f, expectedSection.Normals[i].Dot(section.Normals[i]), 1e-5f);
+		ASSERT_FLOAT_EQ(expectedSection.LayerWeights[i].X, section.LayerWeights[i].X);
+	}
+}
+
+TEST(ChunkMesher, QueuesResultsFromWorkers) {
+	ChunkMeshResultQueue queue;
+	std::vector<std::thread> workers;
+	for (Uint64 t = 0; t < 4; t++) {
+		workers.push_back(std::thread([&queue, t] () {
+			for (Uint64 i = 0; i < 100; i++) {
+				ChunkMeshResult result;
+				result.ChunkOffset = ChunkOffsetVector(t, i, 0);
+				result.Version = t * 100 + i;
+				result.Mesh.reset(new MeshBuffer());
+				queue.Push(std::move(result));
+			}
+		}));
+	}
+	for (auto & worker : workers)
+		worker.join();
+
+	std::vector<ChunkMeshResult> results;
+	queue.TakeAll(results);
+	ASSERT_EQ(400, results.size());
+
+	std::vector<bool> seen(400, false);
+	for (const auto & result : results) {
+		ASSERT_TRUE(result.Mesh != NULL);
+		ASSERT_EQ(result.Version, result.ChunkOffset.X * 100 + result.ChunkOffset.Y);
+		seen[result.Version] = true;
+	}
+	for (const auto found : seen)
+		ASSERT_TRUE(found);
+
+	results.clear();
+	queue.TakeAll(results);
+	ASSERT_TRUE(results.empty());
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Models/Terrain/ChunkPrefetcher.h>
+
+using namespace utils;
+using namespace terrain;
+
+/*************************************************************
+ * ChunkPrefetcher Tests
+ *************************************************************/
+
+TEST(ChunkPrefetcher, PredictsAlongTheVelocity) {
+	const TerrainGeneratorParameters params(16, 0, 1600);
+	ChunkPrefetcher prefetcher(&params, 1, 2.0);
+	const auto isLoaded = [](const ChunkOffsetVector &) { return false; };
+	const auto shouldLoad = [](const ChunkOffsetVector &) { return true; };
+
+	// One chunk per second along +X, from the middle of the origin chunk
+	for (Uint32 i = 0; i <= 4; i++)
+		prefetcher.AddPosition(Point3D(800 + 160.0 * i, 800, 800), 0.1 * i);
+	const auto velocity = prefetcher.EstimateVelocity();
+	ASSERT_NEAR(1600, velocity.X, 1e-6);
+	ASSERT_NEAR(0, velocity.Y, 1e-6);
+	ASSERT_NEAR(0, velocity.Z, 1e-6);
+
+	prefetcher.Predict(isLoaded);
+	ChunkOffsetVector offset;
+	ASSERT_TRUE(prefetcher.NextPrefetch(offset, shouldLoad));
+	// The first chunk ahead of the streamed area is loaded first
+	ASSERT_EQ(2, offset.X);
+	ASSERT_TRUE(prefetcher.IsPrefetched(offset));
+
+	prefetcher.AddPosition(Point3D(2400, 800, 800), 1.0);
+	prefetcher.UpdateStreamedArea(ChunkOffsetVector(1, 0, 0));
+	ASSERT_EQ(1, prefetcher.GetCounters().Hits);
+	ASSERT_FALSE(prefetcher.IsPrefetched(offset));
+
+	// Turning back cancels the queue built for the old heading
+	ASSERT_TRUE(prefetcher.NextPrefetch(offset, shouldLoad));
+	for (Uint32 i = 1; i <= 8; i++)
+		prefetcher.AddPosition(Point3D(2400 - 400.0 * i, 800, 800), 1.0 + 0.25 * i);
+	ASSERT_LT(prefetcher.EstimateVelocity().X, 0);
+	prefetcher.Predict(isLoaded);
+	ASSERT_GT(prefetcher.GetCounters().Cancelled, 0);
+
+	prefetcher.UpdateStreamedArea(ChunkOffsetVector(-1, 0, 0));
+	ASSERT_EQ(1, prefetcher.GetCounters().Wasted);
+	ASSERT_EQ(2, prefetcher.GetCounters().Issued);
+	ASSERT_DOUBLE_EQ(0.5, prefetcher.GetCounters().GetHitRate());
+}
+
+TEST(ChunkPrefetcher, RejectedChunksAreNotCounted) {
+	const TerrainGeneratorParameters params(16, 0, 1600);
+	ChunkPrefetcher prefetcher(&params, 1, 2.0);
+	for (Uint32 i = 0; i <= 4; i++)
+		prefetcher.AddPosition(Point3D(800 + 160.0 * i, 800, 800), 0.1 * i);
+	prefetcher.Predict([](const ChunkOffsetVector &) { return false; });
+
+	// The first chunk ahead is skipped, so the next one along is taken instead
+	ChunkOffsetVector offset;
+	ASSERT_TRUE(prefetcher.NextPrefetch(offset, [](const ChunkOffsetVector & next) {
+		return next.X != 2;
+	}));
+	ASSERT_NE(2, offset.X);
+	ASSERT_FALSE(prefetcher.IsPrefetched(ChunkOffsetVector(2, 0, 0)));
+	ASSERT_EQ(1, prefetcher.GetCounters().Issued);
+
+	ASSERT_FALSE(prefetcher.NextPrefetch(offset, [](const ChunkOffsetVector &) {
+		return false;
+	}));
+	ASSERT_EQ(1, prefetcher.GetCounters().Issued);
+}
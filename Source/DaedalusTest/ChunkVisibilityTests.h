@@ -0,0 +1,64 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Models/Terrain/ChunkVisibility.h>
+
+#include <unordered_map>
+
+using namespace utils;
+using namespace terrain;
+
+/*************************************************************
+ * ChunkVisibility Tests
+ *************************************************************/
+
+TEST(ChunkConnectivity, ConnectsFacesThroughAir) {
+	OccupancyGrid3D solid(8);
+	ASSERT_EQ(ChunkConnectivity::All().GetPairs(), ChunkConnectivity::FromOccupancy(solid).GetPairs());
+
+	// A solid wall across x separates the faces on either side of it
+	for (Uint32 y = 0; y < 8; y++) {
+		for (Uint32 z = 0; z < 8; z++)
+			solid.Set(4, y, z, true);
+	}
+	auto connectivity = ChunkConnectivity::FromOccupancy(solid);
+	ASSERT_FALSE(connectivity.IsConnected(FACE_NEG_X, FACE_POS_X));
+	ASSERT_TRUE(connectivity.IsConnected(FACE_NEG_X, FACE_POS_Y));
+	ASSERT_TRUE(connectivity.IsConnected(FACE_POS_X, FACE_NEG_Z));
+	ASSERT_TRUE(connectivity.IsConnected(FACE_NEG_Y, FACE_POS_Y));
+
+	// A hole through the wall joins them again
+	solid.Set(4, 3, 3, false);
+	connectivity = ChunkConnectivity::FromOccupancy(solid);
+	ASSERT_TRUE(connectivity.IsConnected(FACE_NEG_X, FACE_POS_X));
+
+	for (Uint32 x = 0; x < 8; x++) {
+		for (Uint32 y = 0; y < 8; y++) {
+			for (Uint32 z = 0; z < 8; z++)
+				solid.Set(x, y, z, true);
+		}
+	}
+	ASSERT_EQ(0, ChunkConnectivity::FromOccupancy(solid).GetPairs());
+}
+
+TEST(ChunkVisibility, StopsAtSolidChunks) {
+	// A row of open chunks along x, with a solid chunk at x = 3
+	std::unordered_map<ChunkOffsetVector, ChunkConnectivity> chunks;
+	for (Int64 x = -5; x <= 5; x++)
+		chunks[ChunkOffsetVector(x, 0, 0)] = x == 3 ? ChunkConnectivity() : ChunkConnectivity::All();
+
+	const ChunkConnectivityLookup lookup = [&chunks](const ChunkOffsetVector & offset) {
+		const auto found = chunks.find(offset);
+		return found == chunks.end() ? (const ChunkConnectivity *) NULL : &found->second;
+	};
+
+	std::unordered_set<ChunkOffsetVector> visible;
+	FindVisibleChunks(ChunkOffsetVector(0, 0, 0), 4, lookup, visible);
+
+	// The solid chunk is visible, the chunks behind it and beyond the distance are not
+	ASSERT_EQ(8, visible.size());
+	for (Int64 x = -4; x <= 3; x++)
+		ASSERT_EQ(1, visible.count(ChunkOffsetVector(x, 0, 0)));
+	ASSERT_EQ(0, visible.count(ChunkOffsetVector(4, 0, 0)));
+	ASSERT_EQ(0, visible.count(ChunkOffsetVector(-5, 0, 0)));
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Models/Terrain/ChunkWire.h>
+#include <Models/Terrain/TerrainEditing.h>
+
+using namespace utils;
+using namespace terrain;
+
+/*************************************************************
+ * ChunkWire Tests
+ *************************************************************/
+
+TEST(ChunkWire, ReplicatesSnapshotsAndEdits) {
+	const items::ItemDataFactory factory;
+	const ChunkOffsetVector offset(-2, 5, 1);
+	ChunkData data(16, offset);
+	for (Uint32 x = 0; x < 16; x++) {
+		for (Uint32 y = 0; y < 16; y++) {
+			for (Uint32 z = 0; z < 16; z++) {
+				data.DensityData.Mutable().Set(x, y, z, z < 4 + (x + y) % 5 ? 1.0f : 0.0f);
+				data.MaterialData.Mutable().Set(x, y, z, z < 2 ? 3 : 1);
+			}
+		}
+	}
+	auto chest = factory.BuildItemData(items::I_Chest);
+	chest->ItemId = 9;
+	chest->Position = ChunkPositionVector(offset, Point3D(3, 4, 12));
+	data.PlacedItems.push_back(chest);
+
+	auto ends = LoopbackTransport::CreatePair();
+	std::vector<Uint8> message;
+	EncodeChunkSnapshot(data, message);
+	// The layered fields shrink to a small fraction of their raw 48kB
+	ASSERT_LT(message.size(), 1500);
+	ends.first->Send(message);
+
+	ChunkReplica replica(factory);
+	std::vector<ChunkOffsetVector> changed, resync;
+	replica.Receive(*ends.second, changed, resync);
+	ASSERT_EQ(1, changed.size());
+	auto copy = replica.FindChunk(offset);
+	ASSERT_TRUE(copy != NULL);
+	ASSERT_EQ(1, copy->PlacedItems.size());
+	ASSERT_EQ(9, copy->PlacedItems[0]->ItemId);
+
+	// Only the samples within the brush are sent for the edit
+	ChunkCellRange changedSamples;
+	ApplyTerrainEdit(TerrainEdit(E_Dig, E_Sphere, ChunkPositionVector(offset, Point3D(8, 8, 4)),
+		Vector3D<>(2, 2, 2)), data, changedSamples);
+	message.clear();
+	EncodeChunkEdit(CaptureChunkEdit(data, changedSamples), data.Version, message);
+	ends.first->Send(message);
+
+	changed.clear();
+	replica.Receive(*ends.second, changed, resync);
+	ASSERT_EQ(1, changed.size());
+	ASSERT_TRUE(resync.empty());
+	ASSERT_EQ(1, copy->Version);
+	for (Uint32 x = 0; x < 16; x++) {
+		for (Uint32 y = 0; y < 16; y++) {
+			for (Uint32 z = 0; z < 16; z++) {
+				ASSERT_EQ(data.DensityData->Get(x, y, z), copy->DensityData->Get(x, y, z));
+				ASSERT_EQ(data.MaterialData->Get(x, y, z), copy->MaterialData->Get(x, y, z));
+			}
+		}
+	}
+	ASSERT_EQ(1, copy->PlacedItems.size());
+
+	message[0] = 7;
+	ASSERT_THROW(DecodeChunkMessage(message, factory), StringException);
+}
+
+TEST(ChunkWire, RejectsEditsOutOfOrder) {
+	const items::ItemDataFactory factory;
+	const ChunkOffsetVector offset(0, 0, 0);
+	ChunkData data(16, offset);
+	auto ends = LoopbackTransport::CreatePair();
+	std::vector<Uint8> message;
+	EncodeChunkSnapshot(data, message);
+	ends.first->Send(message);
+
+	ChunkReplica replica(factory);
+	std::vector<ChunkOffsetVector> changed, resync;
+	replica.Receive(*ends.second, changed, resync);
+	const auto copy = replica.FindChunk(offset);
+
+	std::vector<Uint8> edits[3];
+	for (Uint32 i = 0; i < 3; i++) {
+		ChunkCellRange changedSamples;
+		ApplyTerrainEdit(TerrainEdit(E_Fill, E_Box, ChunkPositionVector(offset,
+			Point3D(4 + i * 4, 8, 8)), Vector3D<>(1, 1, 1), 2), data, changedSamples);
+		EncodeChunkEdit(CaptureChunkEdit(data, changedSamples), data.Version, edits[i]);
+	}
+
+	// A repeated edit is dropped without touching the copy
+	ends.first->Send(edits[0]);
+	ends.first->Send(edits[0]);
+	changed.clear();
+	replica.Receive(*ends.second, changed, resync);
+	ASSERT_EQ(1, changed.size());
+	ASSERT_TRUE(resync.empty());
+	ASSERT_EQ(1, copy->Version);
+
+	// Skipping an edit leaves the copy behind, so it has to be sent again
+	ends.first->Send(edits[2]);
+	ends.first->Send(edits[1]);
+	changed.clear();
+	replica.Receive(*ends.second, changed, resync);
+	ASSERT_TRUE(changed.empty());
+	ASSERT_EQ(1, resync.size());
+	ASSERT_TRUE(resync[0] == offset);
+	ASSERT_EQ(1, copy->Version);
+	ASSERT_TRUE(replica.FindChunk(offset) == NULL);
+}
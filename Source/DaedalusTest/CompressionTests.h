@@ -0,0 +1,54 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Utilities/Compression.h>
+#include <Utilities/DataStructures.h>
+
+#include <random>
+
+using namespace utils;
+
+/*************************************************************
+ * Compression Tests
+ *************************************************************/
+
+TEST(Compression, RoundTripsAndDetectsCorruption) {
+	std::mt19937 random(7);
+	std::vector<std::vector<Uint8>> inputs(4);
+	// Empty, a long run, repeated phrases and noise
+	inputs[1].assign(100000, 42);
+	for (Uint32 i = 0; i < 20000; i++)
+		inputs[2].push_back((Uint8) "chunk offset "[i % 13]);
+	for (Uint32 i = 0; i < 5000; i++)
+		inputs[3].push_back((Uint8) random());
+
+	for (const auto & input : inputs) {
+		std::vector<Uint8> compressed, decompressed;
+		LzCompress(input.data(), input.size(), compressed);
+		LzDecompress(compressed.data(), compressed.size(), input.size(), decompressed);
+		ASSERT_TRUE(input == decompressed);
+	}
+
+	std::vector<Uint8> compressed, decompressed;
+	LzCompress(inputs[1].data(), inputs[1].size(), compressed);
+	ASSERT_LT(compressed.size(), 500);
+	ASSERT_THROW(
+		LzDecompress(compressed.data(), compressed.size() / 2, inputs[1].size(), decompressed),
+		StringException);
+	decompressed.clear();
+	ASSERT_THROW(
+		LzDecompress(compressed.data(), compressed.size(), inputs[1].size() + 1, decompressed),
+		StringException);
+
+	std::vector<Uint8> bytes;
+	ByteWriter writer(bytes);
+	writer.WriteVarint(300);
+	writer.WriteSignedVarint(-3);
+	writer.WriteDouble(0.25);
+	ASSERT_EQ(11, bytes.size());
+	ByteReader reader(bytes.data(), bytes.size());
+	ASSERT_EQ(300, reader.ReadVarint());
+	ASSERT_EQ(-3, reader.ReadSignedVarint());
+	ASSERT_EQ(0.25, reader.ReadDouble());
+	ASSERT_THROW(reader.ReadByte(), StringException);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Models/Terrain/InterestManager.h>
+
+#include <algorithm>
+
+using namespace utils;
+using namespace terrain;
+
+/*************************************************************
+ * InterestManager Tests
+ *************************************************************/
+
+TEST(InterestManager, SharesResidencyBetweenObservers) {
+	InterestManager interest;
+	InterestChanges changes;
+	interest.AddObserver(1, ChunkOffsetVector(0, 0, 0), 1, 0);
+	interest.AddObserver(2, ChunkOffsetVector(2, 0, 0), 1, 0);
+	// The cubes overlap on the plane of chunks at x = 1
+	ASSERT_EQ(45, interest.GetResidentCount());
+	ASSERT_EQ(2, interest.GetRefCount(ChunkOffsetVector(1, 1, -1)));
+	ASSERT_EQ(1, interest.GetRefCount(ChunkOffsetVector(0, 0, 0)));
+	ASSERT_THROW(interest.AddObserver(1, ChunkOffsetVector(0), 1, 0), StringException);
+
+	std::vector<ChunkOffsetVector> loads;
+	interest.TakeLoads(100, loads);
+	ASSERT_EQ(45, loads.size());
+	ASSERT_EQ(0, interest.GetPendingCount());
+
+	// Only the chunks no other observer needs are unloaded
+	interest.MoveObserver(1, ChunkOffsetVector(-2, 0, 0), changes);
+	ASSERT_EQ(9, changes.Unloaded.size());
+	for (const auto & offset : changes.Unloaded)
+		ASSERT_EQ(0, offset.X);
+	ASSERT_EQ(1, interest.GetRefCount(ChunkOffsetVector(1, 0, 0)));
+	ASSERT_EQ(18, interest.GetPendingCount());
+
+	changes.Unloaded.clear();
+	interest.RemoveObserver(2, changes);
+	ASSERT_EQ(27, changes.Unloaded.size());
+	ASSERT_EQ(27, interest.GetResidentCount());
+	ASSERT_THROW(interest.RemoveObserver(2, changes), StringException);
+}
+
+TEST(InterestManager, LoadsByObserverPriority) {
+	InterestManager interest;
+	interest.AddObserver(1, ChunkOffsetVector(0, 0, 0), 1, 0);
+	interest.AddObserver(2, ChunkOffsetVector(10, 0, 0), 2, 1);
+
+	std::vector<ChunkOffsetVector> loads;
+	interest.TakeLoads(1, loads);
+	ASSERT_EQ(1, loads.size());
+	ASSERT_TRUE(loads[0] == ChunkOffsetVector(10, 0, 0));
+
+	// Every chunk of the higher priority observer comes first, nearest first
+	interest.TakeLoads(124, loads);
+	for (Uint32 i = 0; i < loads.size(); i++)
+		ASSERT_GE(loads[i].X, 8);
+	ASSERT_TRUE(std::abs(loads[1].X - 10) + std::abs(loads[1].Y) + std::abs(loads[1].Z) == 1);
+
+	loads.clear();
+	interest.TakeLoads(1, loads);
+	ASSERT_TRUE(loads[0] == ChunkOffsetVector(0, 0, 0));
+	ASSERT_EQ(26, interest.GetPendingCount());
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Models/Items/ItemData.h>
+
+#include <memory>
+
+using namespace utils;
+using namespace items;
+
+/*************************************************************
+ * ItemData Tests
+ *************************************************************/
+
+namespace {
+	const ItemDataTemplate RotatingItemTemplate(
+		I_Sofa, ItemRotation(4, 2), Vector3D<>(2, 1, 1), Point3D(0.5, 0.5, 0.5), "Test");
+
+	ItemDataPtr CreateRotatingItem(const Uint64 id, const Point3D & position) {
+		return ItemDataPtr(new ItemData(
+			id, terrain::ChunkPositionVector({ 0, 0, 0 }, position),
+			ItemRotation(0, 0), true, RotatingItemTemplate));
+	}
+}
+
+TEST(ItemData, UsesPrecomputedRotations) {
+	const auto & pivot = RotatingItemTemplate.Pivot;
+	for (Uint8 yaw = 0; yaw < 4; yaw++) {
+		for (Uint8 pitch = 0; pitch < 2; pitch++) {
+			const auto expected =
+				CreateTranslation(pivot) *
+				CreateRotation(90.0 * yaw, AXIS_Z) *
+				CreateRotation(180.0 * pitch, AXIS_X) *
+				CreateTranslation(-pivot);
+			const auto & actual = RotatingItemTemplate.GetRotationMatrix(ItemRotation(yaw, pitch));
+			for (Uint8 i = 0; i < 16; i++)
+				ASSERT_DOUBLE_EQ(expected.Get(i % 4, i / 4), actual.Get(i % 4, i / 4));
+		}
+	}
+}
+
+TEST(ItemData, RefreshesCachedBounds) {
+	const auto item = CreateRotatingItem(1, Point3D(3, 3, 3));
+	ASSERT_DOUBLE_EQ(5, item->GetBoundingBox().GetEnclosingBoundingBox().MaxPoint.X);
+
+	item->Position.InnerOffset = Point3D(4, 3, 3);
+	ASSERT_DOUBLE_EQ(6, item->GetBoundingBox().GetEnclosingBoundingBox().MaxPoint.X);
+
+	// A quarter turn about the pivot swaps the X and Y extents
+	item->SetRotation(ItemRotation(1, 0));
+	const auto bounds = item->GetBoundingBox().GetEnclosingBoundingBox();
+	ASSERT_NEAR(5, bounds.MaxPoint.X, 1E-9);
+	ASSERT_NEAR(5, bounds.MaxPoint.Y, 1E-9);
+}
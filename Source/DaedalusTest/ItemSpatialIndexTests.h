@@ -0,0 +1,70 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Models/Items/ItemSpatialIndex.h>
+
+#include <memory>
+
+using namespace utils;
+using namespace items;
+
+/*************************************************************
+ * ItemSpatialIndex Tests
+ *************************************************************/
+
+namespace {
+	const ItemDataTemplate TestItemTemplate(
+		I_Chest, ItemRotation(4, 1), Vector3D<>(2, 1, 1), Point3D(0.5, 0.5, 0.5), "Test");
+
+	ItemDataPtr CreateTestItem(const Uint64 id, const Point3D & position) {
+		return ItemDataPtr(new ItemData(
+			id, terrain::ChunkPositionVector({ 0, 0, 0 }, position),
+			ItemRotation(0, 0), true, TestItemTemplate));
+	}
+
+	AxisAlignedBoundingBox3D CellBounds(const double x, const double y, const double z) {
+		return AxisAlignedBoundingBox3D(
+			Point3D(x + 0.01, y + 0.01, z + 0.01), Point3D(x + 0.99, y + 0.99, z + 0.99));
+	}
+}
+
+TEST(ItemSpatialIndex, FindsInsertedItems) {
+	ItemSpatialIndex index(16);
+	const auto item1 = CreateTestItem(1, Point3D(3, 3, 3));
+	const auto item2 = CreateTestItem(2, Point3D(10, 10, 10));
+	ASSERT_TRUE(index.Insert(item1, Point3D(0)));
+	ASSERT_TRUE(index.Insert(item2, Point3D(0)));
+	ASSERT_EQ(2, index.Size());
+
+	// The first item spans the border between two buckets
+	ASSERT_EQ(1, (*index.FindCollision(CellBounds(3, 3, 3)))->ItemId);
+	ASSERT_EQ(1, (*index.FindCollision(CellBounds(4, 3, 3)))->ItemId);
+	ASSERT_EQ(2, (*index.FindCollision(CellBounds(11, 10, 10)))->ItemId);
+	ASSERT_FALSE(index.FindCollision(CellBounds(6, 6, 6)).IsValid());
+	ASSERT_FALSE(index.IsBucketEmptyAt(4, 3, 3));
+	ASSERT_TRUE(index.IsBucketEmptyAt(0, 12, 0));
+}
+
+TEST(ItemSpatialIndex, RemovesItems) {
+	ItemSpatialIndex index(16);
+	const auto item = CreateTestItem(1, Point3D(3, 3, 3));
+	index.Insert(item, Point3D(0));
+	ASSERT_TRUE(index.Remove(item));
+	ASSERT_FALSE(index.Remove(item));
+	ASSERT_TRUE(index.IsEmpty());
+	ASSERT_FALSE(index.FindCollision(CellBounds(3, 3, 3)).IsValid());
+	ASSERT_TRUE(index.IsBucketEmptyAt(3, 3, 3));
+}
+
+TEST(ItemSpatialIndex, IndexesItemsFromNeighbours) {
+	ItemSpatialIndex index(16);
+
+	// Item placed at the upper X edge of the chunk below, spilling into this chunk
+	const auto spanning = CreateTestItem(1, Point3D(15, 3, 3));
+	ASSERT_TRUE(index.Insert(spanning, Point3D(-16, 0, 0)));
+	ASSERT_FALSE(index.Insert(CreateTestItem(2, Point3D(5, 3, 3)), Point3D(-16, 0, 0)));
+	ASSERT_EQ(1, index.Size());
+
+	ASSERT_TRUE(index.FindCollision(CellBounds(0, 3, 3)).IsValid());
+	ASSERT_FALSE(index.FindCollision(CellBounds(1, 3, 3)).IsValid());
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Utilities/DataStructures.h>
+#include <Utilities/JobSystem.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace utils;
+
+/*************************************************************
+ * JobSystem Tests
+ *************************************************************/
+
+TEST(JobSystem, RunsByPriorityAndDependencies) {
+	// Without workers everything runs on the waiting thread, in a predictable order
+	JobSystem jobs(0);
+	std::vector<Uint32> order;
+	const auto low = jobs.Submit([&] { order.push_back(0); }, J_Low);
+	const auto normal = jobs.Submit([&] { order.push_back(1); });
+	const auto high = jobs.Submit([&] { order.push_back(2); }, J_High);
+	// A high priority continuation still waits for the low priority job it depends on
+	const auto last = jobs.Submit([&] { order.push_back(3); }, { low, high }, J_High);
+
+	jobs.Wait(last);
+	ASSERT_EQ(4, order.size());
+	ASSERT_EQ(2, order[0]);
+	ASSERT_EQ(1, order[1]);
+	ASSERT_EQ(0, order[2]);
+	ASSERT_EQ(3, order[3]);
+	ASSERT_TRUE(normal->IsFinished());
+
+	const auto failed = jobs.Submit([] { throw StringException("Job failed"); });
+	const auto after = jobs.Submit([&] { order.push_back(4); }, { failed });
+	ASSERT_THROW(jobs.Wait(failed), StringException);
+	jobs.Wait(after);
+	ASSERT_EQ(4, order.back());
+}
+
+TEST(JobSystem, ParallelForWithNestedWaits) {
+	JobSystem jobs(4);
+	std::vector<std::atomic<Uint32>> counts(16 * 16 * 16);
+	for (auto & count : counts)
+		count = 0;
+
+	// Every job of the outer loop waits for an inner loop, helping out meanwhile
+	jobs.ParallelFor(16, 1, [&] (const Uint64 x) {
+		jobs.ParallelFor2D(16, 16, [&] (const Uint64 y, const Uint64 z) {
+			counts[(x * 16 + y) * 16 + z]++;
+		});
+	});
+	jobs.ParallelFor3D(16, 16, 16, [&] (const Uint64 x, const Uint64 y, const Uint64 z) {
+		counts[(x * 16 + y) * 16 + z]++;
+	}, J_High);
+	for (const auto & count : counts)
+		ASSERT_EQ(2, count);
+
+	ASSERT_THROW(jobs.ParallelFor(100, 0, [] (const Uint64 i) {
+		if (i == 42)
+			throw StringException("Index failed");
+	}), StringException);
+}
+
+TEST(JobSystem, WaitingOnlyHelpsWithUrgentJobs) {
+	JobSystem jobs(1);
+	const auto waiter = std::this_thread::get_id();
+	std::atomic<bool> bStarted(false), bReleased(false), bWaiting(false), bHelped(false);
+
+	// The only worker runs the awaited job, while lower priority jobs are queued
+	const auto high = jobs.Submit([&] {
+		bStarted = true;
+		while (!bReleased)
+			std::this_thread::yield();
+	}, J_High);
+	while (!bStarted)
+		std::this_thread::yield();
+	const auto background = [&] {
+		if (bWaiting && std::this_thread::get_id() == waiter)
+			bHelped = true;
+	};
+	const auto low = jobs.Submit(background, J_Low);
+	const auto normal = jobs.Submit(background);
+
+	std::thread releaser([&] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		bReleased = true;
+	});
+	bWaiting = true;
+	jobs.Wait(high);
+	bWaiting = false;
+	releaser.join();
+	ASSERT_FALSE(bHelped);
+
+	jobs.Wait(low);
+	jobs.Wait(normal);
+}
+
+TEST(JobSystem, SharedSystemIsStartedAndStoppedExplicitly) {
+	ASSERT_THROW(GetJobSystem(), StringException);
+	StartJobSystem();
+	auto & jobs = GetJobSystem();
+	ASSERT_LE(1, jobs.GetWorkerCount());
+	std::atomic<bool> bRan(false);
+	jobs.Wait(jobs.Submit([&] { bRan = true; }));
+	ASSERT_TRUE(bRan);
+
+	StopJobSystem();
+	ASSERT_THROW(GetJobSystem(), StringException);
+}
@@ -2,7 +2,24 @@
 #include "AlgebraTests.h"
 #include "Algebra2DTests.h"
 #include "Algebra3DTests.h"
+#include "ChunkColumnTests.h"
+#include "ChunkDeltaTests.h"
+#include "ChunkKernelsTests.h"
+#include "ChunkLoaderTests.h"
+#include "ChunkMesherTests.h"
+#include "ChunkPrefetcherTests.h"
+#include "ChunkVisibilityTests.h"
+#include "ChunkWireTests.h"
+#include "CompressionTests.h"
 #include "DelaunayTests.h"
+#include "InterestManagerTests.h"
+#include "ItemDataTests.h"
+#include "ItemSpatialIndexTests.h"
+#include "JobSystemTests.h"
+#include "OccupancyGridTests.h"
+#include "TerrainEditingTests.h"
+#include "TerrainRaytraceTests.h"
+#include "WorldSnapshotTests.h"
 
 int main(int argc, char ** argv) {
 	testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Utilities/OccupancyGrid.h>
+#include <Utilities/FastVoxelTraversal.h>
+
+#include <random>
+
+using namespace utils;
+
+/*************************************************************
+ * OccupancyGrid3D Tests
+ *************************************************************/
+
+TEST(OccupancyGrid3D, SetsAndClearsCells) {
+	OccupancyGrid3D grid(16);
+	ASSERT_TRUE(grid.IsEmpty());
+	ASSERT_EQ(4, grid.GetBrickCount());
+
+	grid.Set(5, 6, 7, true);
+	ASSERT_TRUE(grid.Get(5, 6, 7));
+	ASSERT_FALSE(grid.Get(5, 6, 6));
+	ASSERT_FALSE(grid.IsEmpty());
+	ASSERT_FALSE(grid.IsBrickEmpty(1, 1, 1));
+	ASSERT_TRUE(grid.IsBrickEmpty(1, 1, 0));
+	ASSERT_FALSE(grid.IsBrickEmptyAt(4, 7, 4));
+	ASSERT_EQ(1, grid.GetSolidCellCount());
+	ASSERT_EQ(1, grid.GetSolidBrickCount());
+
+	grid.Set(5, 6, 7, true);
+	ASSERT_EQ(1, grid.GetSolidCellCount());
+
+	grid.Set(5, 6, 7, false);
+	ASSERT_FALSE(grid.Get(5, 6, 7));
+	ASSERT_TRUE(grid.IsEmpty());
+	ASSERT_EQ(0, grid.GetSolidBrickCount());
+}
+
+TEST(OccupancyGrid3D, DetectsFullBricks) {
+	// 6 cells per edge leaves partial bricks on the upper edges
+	OccupancyGrid3D grid(6);
+	for (Uint32 x = 4; x < 6; x++) {
+		for (Uint32 y = 4; y < 6; y++) {
+			for (Uint32 z = 4; z < 6; z++)
+				grid.Set(x, y, z, true);
+		}
+	}
+	ASSERT_TRUE(grid.IsBrickFull(1, 1, 1));
+	ASSERT_FALSE(grid.IsBrickFull(0, 0, 0));
+	ASSERT_FALSE(grid.IsFull());
+
+	grid.Clear();
+	ASSERT_TRUE(grid.IsEmpty());
+	ASSERT_FALSE(grid.Get(5, 5, 5));
+}
+
+/*************************************************************
+ * FastVoxelTraversalIterator Tests
+ *************************************************************/
+
+TEST(FastVoxelTraversalIterator, SkipBlockMatchesNext) {
+	const Uint32 blockSize = 4;
+	std::mt19937 gen(1234);
+	std::uniform_real_distribution<double> origin(0.1, 15.9);
+	std::uniform_real_distribution<double> direction(-1.0, 1.0);
+
+	for (Uint32 i = 0; i < 500; i++) {
+		Vector3D<> dir(direction(gen), direction(gen), direction(gen));
+		if (dir.Length() < 0.01)
+			continue;
+		const Ray3D ray(Point3D(origin(gen), origin(gen), origin(gen)), dir.Normalize());
+
+		FastVoxelTraversalIterator stepped(
+			Vector3D<>(1.0), Vector3D<Int64>(0), Vector3D<Int64>(16), ray, 100);
+		FastVoxelTraversalIterator skipped(
+			Vector3D<>(1.0), Vector3D<Int64>(0), Vector3D<Int64>(16), ray, 100);
+
+		while (skipped.IsValid()) {
+			const auto block = skipped.GetCurrentCell() / Int64(blockSize);
+			while (stepped.IsValid() && stepped.GetCurrentCell() / Int64(blockSize) == block)
+				stepped.Next();
+			skipped.SkipBlock(blockSize);
+
+			ASSERT_EQ(stepped.IsValid(), skipped.IsValid());
+			if (stepped.IsValid()) {
+				ASSERT_EQ(stepped.GetCurrentCell(), skipped.GetCurrentCell());
+				ASSERT_EQ(stepped.GetPreviousCell(), skipped.GetPreviousCell());
+			}
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Models/Terrain/TerrainEditing.h>
+
+using namespace utils;
+using namespace terrain;
+
+/*************************************************************
+ * TerrainEditing Tests
+ *************************************************************/
+
+TEST(TerrainEditing, AppliesBrushesToSamples) {
+	ChunkData data(16, ChunkOffsetVector(2, 0, 0));
+	data.DensityData.Mutable().Fill(1.0);
+
+	// A sphere of radius 2 centred on the first sample of the chunk, given from the chunk
+	// before it
+	const TerrainEdit dig(E_Dig, E_Sphere,
+		ChunkPositionVector(ChunkOffsetVector(1, 0, 0), Point3D(16, 4, 4)), Vector3D<>(2, 2, 2));
+	std::vector<ChunkOffsetVector> offsets;
+	FindEditedChunks(dig, 16, offsets);
+	ASSERT_EQ(2, offsets.size());
+	ASSERT_TRUE(offsets[0] == ChunkOffsetVector(1, 0, 0));
+	ASSERT_TRUE(offsets[1] == ChunkOffsetVector(2, 0, 0));
+
+	ChunkCellRange changed;
+	ASSERT_TRUE(ApplyTerrainEdit(dig, data, changed));
+	ASSERT_EQ(1, data.Version);
+	ASSERT_TRUE(changed.Min == Vector3D<Int64>(0, 2, 2));
+	ASSERT_TRUE(changed.Max == Vector3D<Int64>(2, 6, 6));
+	ASSERT_EQ(0.0f, data.DensityData->Get(0, 4, 4));
+	ASSERT_EQ(0.0f, data.DensityData->Get(1, 5, 5));
+	ASSERT_EQ(1.0f, data.DensityData->Get(2, 5, 5));
+	ASSERT_EQ(1.0f, data.DensityData->Get(3, 4, 4));
+
+	// Digging the same spot again changes nothing
+	changed = ChunkCellRange();
+	ASSERT_FALSE(ApplyTerrainEdit(dig, data, changed));
+	ASSERT_TRUE(changed.IsEmpty());
+	ASSERT_EQ(1, data.Version);
+
+	// Materials only change on solid samples
+	const TerrainEdit paint(E_SetMaterial, E_Box,
+		ChunkPositionVector(ChunkOffsetVector(2, 0, 0), Point3D(0, 4, 4)), Vector3D<>(3, 0, 0), 7);
+	ASSERT_TRUE(ApplyTerrainEdit(paint, data, changed));
+	ASSERT_EQ(0u, data.MaterialData->Get(1, 4, 4));
+	ASSERT_EQ(7u, data.MaterialData->Get(3, 4, 4));
+	ASSERT_EQ(0u, data.MaterialData->Get(4, 4, 4));
+}
+
+TEST(TerrainEditing, MarksNeighbourCellsDirty) {
+	DirtyChunkMap dirty;
+	const ChunkCellRange samples(Vector3D<Int64>(0, 5, 14), Vector3D<Int64>(1, 6, 15));
+	MarkDirtyCells(ChunkOffsetVector(0, 0, 0), samples, 16, dirty);
+
+	// The chunk itself, the chunks before it along x and after it along z, and the corner
+	// between them
+	ASSERT_EQ(4, dirty.size());
+	const auto & self = dirty[ChunkOffsetVector(0, 0, 0)];
+	ASSERT_TRUE(self.Min == Vector3D<Int64>(0, 3, 12));
+	ASSERT_TRUE(self.Max == Vector3D<Int64>(2, 7, 15));
+	const auto & before = dirty[ChunkOffsetVector(-1, 0, 0)];
+	ASSERT_TRUE(before.Min == Vector3D<Int64>(14, 3, 12));
+	ASSERT_TRUE(before.Max == Vector3D<Int64>(15, 7, 15));
+	const auto & above = dirty[ChunkOffsetVector(0, 0, 1)];
+	ASSERT_TRUE(above.Min == Vector3D<Int64>(0, 3, 0));
+	ASSERT_TRUE(above.Max == Vector3D<Int64>(2, 7, 0));
+	ASSERT_EQ(1, dirty.count(ChunkOffsetVector(-1, 0, 1)));
+}
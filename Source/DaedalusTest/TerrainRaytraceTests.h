@@ -0,0 +1,157 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Models/Terrain/TerrainRaytrace.h>
+
+#include <unordered_map>
+
+using namespace utils;
+using namespace terrain;
+using namespace items;
+
+/*************************************************************
+ * TerrainRaytrace Tests
+ *************************************************************/
+
+namespace {
+	const ItemDataTemplate RaytraceItemTemplate(
+		I_Chest, ItemRotation(4, 1), Vector3D<>(2, 1, 1), Point3D(0.5, 0.5, 0.5), "Test");
+
+	/*
+	 Chunks of 16 cells, 100 units to a cell. Only the chunks added to the map are loaded.
+	 */
+	struct RaytraceWorld {
+		const TerrainGeneratorParameters Params;
+		std::unordered_map<ChunkOffsetVector, ChunkDataPtr> Chunks;
+		JobSystem Jobs;
+
+		RaytraceWorld() : Params(16, 0, 1600), Jobs(2) {}
+
+		ChunkData & AddChunk(const ChunkOffsetVector & offset) {
+			auto & chunk = Chunks[offset];
+			chunk.reset(new ChunkData(16, offset));
+			return *chunk;
+		}
+
+		TerrainRaytraceResults Trace(
+			const std::vector<Ray3D> & rays,
+			const std::vector<double> & maxDistances
+		) {
+			const auto & chunks = Chunks;
+			const TerrainRaytracer raytracer(Params, [&chunks] (const ChunkOffsetVector & offset) {
+				const auto found = chunks.find(offset);
+				return found == chunks.end() ? ChunkDataPtr() : found->second;
+			}, Jobs);
+			return raytracer.Raytrace(rays, maxDistances);
+		}
+	};
+
+	// Sets every sample along x from the given one onwards to solid
+	void FillFromX(ChunkData & data, const Uint32 fromX) {
+		auto & density = data.DensityData.Mutable();
+		for (Uint32 x = fromX; x < 16; x++) {
+			for (Uint32 y = 0; y < 16; y++) {
+				for (Uint32 z = 0; z < 16; z++)
+					density.Set(x, y, z, 1);
+			}
+		}
+	}
+
+	void FillBelowZ(ChunkData & data, const Uint32 toZ) {
+		auto & density = data.DensityData.Mutable();
+		for (Uint32 x = 0; x < 16; x++) {
+			for (Uint32 y = 0; y < 16; y++) {
+				for (Uint32 z = 0; z < toZ; z++)
+					density.Set(x, y, z, 1);
+			}
+		}
+	}
+}
+
+TEST(TerrainRaytrace, HitsTerrain) {
+	RaytraceWorld world;
+	FillBelowZ(world.AddChunk(ChunkOffsetVector(0, 0, 0)), 4);
+
+	// Straight down onto the surface, and once more stopping just short of it
+	const std::vector<Ray3D> rays(2, Ray3D(Point3D(850, 850, 1250), Vector3D<>(0, 0, -1)));
+	const auto results = world.Trace(rays, { 2000, 800 });
+	ASSERT_EQ(2, results.size());
+
+	// The cell at z = 3 reaches up to the empty samples at z = 4, and is the first solid one
+	ASSERT_TRUE(results[0].IsValid());
+	ASSERT_EQ(E_Terrain, (*results[0]).Type);
+	ASSERT_TRUE((*results[0]).EntryPosition.ChunkOffset == ChunkOffsetVector(0, 0, 0));
+	ASSERT_TRUE((*results[0]).EntryPosition.InnerOffset == Point3D(8, 8, 4));
+	ASSERT_FALSE(results[1].IsValid());
+}
+
+TEST(TerrainRaytrace, HitsPlacedItems) {
+	RaytraceWorld world;
+	auto & data = world.AddChunk(ChunkOffsetVector(0, 0, 0));
+	const ItemDataPtr item(new ItemData(
+		7, ChunkPositionVector(ChunkOffsetVector(0, 0, 0), Point3D(8, 8, 4)),
+		ItemRotation(0, 0), true, RaytraceItemTemplate));
+	ASSERT_TRUE(data.ItemIndex.Insert(item, Point3D(0)));
+
+	// The item spans two cells along x, the second ray misses it along y
+	const std::vector<Ray3D> rays = {
+		Ray3D(Point3D(950, 850, 1250), Vector3D<>(0, 0, -1)),
+		Ray3D(Point3D(950, 950, 1250), Vector3D<>(0, 0, -1))
+	};
+	const auto results = world.Trace(rays, { 2000, 2000 });
+	ASSERT_TRUE(results[0].IsValid());
+	const auto & hit = *results[0];
+	ASSERT_EQ(E_PlacedItem, hit.Type);
+	ASSERT_EQ(7, (*hit.ItemId).ItemId);
+	ASSERT_TRUE((*hit.ItemId).ChunkOffset == ChunkOffsetVector(0, 0, 0));
+	ASSERT_TRUE(hit.EntryPosition.InnerOffset == Point3D(9, 8, 5));
+	ASSERT_FALSE(results[1].IsValid());
+}
+
+TEST(TerrainRaytrace, CrossesChunks) {
+	RaytraceWorld world;
+	world.AddChunk(ChunkOffsetVector(0, 0, 0));
+	FillFromX(world.AddChunk(ChunkOffsetVector(1, 0, 0)), 4);
+	FillBelowZ(world.AddChunk(ChunkOffsetVector(0, 0, 1)), 16);
+
+	// Along x into the next chunk, and up towards the chunk above
+	const std::vector<Ray3D> rays = {
+		Ray3D(Point3D(800, 850, 850), Vector3D<>(1, 0, 0)),
+		Ray3D(Point3D(850, 850, 850), Vector3D<>(0, 0, 1))
+	};
+	const auto results = world.Trace(rays, { 3000, 3000 });
+
+	ASSERT_TRUE(results[0].IsValid());
+	ASSERT_EQ(E_Terrain, (*results[0]).Type);
+	ASSERT_TRUE((*results[0]).EntryPosition.ChunkOffset == ChunkOffsetVector(1, 0, 0));
+	ASSERT_TRUE((*results[0]).EntryPosition.InnerOffset == Point3D(2, 8, 8));
+
+	// The highest cell of the lower chunk reaches up to the solid samples above it
+	ASSERT_TRUE(results[1].IsValid());
+	ASSERT_EQ(E_Terrain, (*results[1]).Type);
+	ASSERT_TRUE((*results[1]).EntryPosition.ChunkOffset == ChunkOffsetVector(0, 0, 0));
+	ASSERT_TRUE((*results[1]).EntryPosition.InnerOffset == Point3D(8, 8, 14));
+}
+
+TEST(TerrainRaytrace, TreatsUnloadedChunksAsEmpty) {
+	RaytraceWorld world;
+	FillFromX(world.AddChunk(ChunkOffsetVector(2, 0, 0)), 4);
+
+	// Chunks 0 and 1 aren't loaded, so the first ray passes through to chunk 2
+	const std::vector<Ray3D> rays = {
+		Ray3D(Point3D(800, 850, 850), Vector3D<>(1, 0, 0)),
+		Ray3D(Point3D(800, 850, 850), Vector3D<>(-1, 0, 0))
+	};
+	const auto results = world.Trace(rays, { 5000, 5000 });
+	ASSERT_TRUE(results[0].IsValid());
+	ASSERT_TRUE((*results[0]).EntryPosition.ChunkOffset == ChunkOffsetVector(2, 0, 0));
+	ASSERT_TRUE((*results[0]).EntryPosition.InnerOffset == Point3D(2, 8, 8));
+	ASSERT_FALSE(results[1].IsValid());
+	ASSERT_EQ(1, world.Chunks.size());
+}
+
+TEST(TerrainRaytrace, RejectsMismatchedDistances) {
+	RaytraceWorld world;
+	const std::vector<Ray3D> rays(2, Ray3D(Point3D(0, 0, 0), Vector3D<>(1, 0, 0)));
+	ASSERT_THROW(world.Trace(rays, { 100 }), StringException);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <Models/Terrain/WorldSnapshot.h>
+#include <Models/Terrain/TerrainEditing.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace utils;
+using namespace terrain;
+
+/*************************************************************
+ * WorldSnapshot Tests
+ *************************************************************/
+
+TEST(WorldSnapshot, PinsVersionsWithoutCopying) {
+	const ChunkOffsetVector offset(0, 2, -1);
+	ChunkData data(8, offset);
+	data.DensityData.Mutable().Fill(1.0);
+
+	ChunkSnapshot chunk;
+	chunk.ChunkOffset = offset;
+	chunk.BaseDensity = chunk.Density = data.DensityData.Share();
+	chunk.BaseMaterials = chunk.Materials = data.MaterialData.Share();
+	ASSERT_EQ(chunk.Density.get(), &*data.DensityData);
+
+	// Editing copies the fields, leaving the pinned versions untouched
+	ChunkCellRange changed;
+	ApplyTerrainEdit(TerrainEdit(E_Dig, E_Box, ChunkPositionVector(offset, Point3D(4, 4, 4)),
+		Vector3D<>(0, 0, 0)), data, changed);
+	ASSERT_NE(chunk.Density.get(), &*data.DensityData);
+	ASSERT_EQ(1.0f, chunk.Density->Get(4, 4, 4));
+	ASSERT_EQ(0.0f, data.DensityData->Get(4, 4, 4));
+
+	// Unshared fields are written in place
+	const auto * density = &*data.DensityData;
+	data.DensityData.Mutable().Set(1, 1, 1, 0.5f);
+	ASSERT_EQ(density, &*data.DensityData);
+
+	WorldSnapshot world;
+	world.Chunks.push_back(chunk);
+	world.Chunks.back().Density = data.DensityData.Share();
+	world.Chunks.back().Materials = data.MaterialData.Share();
+
+	std::stringstream stream;
+	WriteWorldSnapshot(stream, world);
+	ChunkDeltaMap deltas;
+	ReadChunkDeltas(stream, deltas);
+	ASSERT_EQ(1, deltas.size());
+	ASSERT_EQ(2, deltas[offset]->Samples.size());
+
+	// An unedited chunk leaves nothing to save
+	world.Chunks.back().Density = chunk.BaseDensity;
+	std::stringstream empty;
+	WriteWorldSnapshot(empty, world);
+	deltas.clear();
+	ReadChunkDeltas(empty, deltas);
+	ASSERT_EQ(0, deltas.size());
+}
+
+TEST(WorldSnapshot, WritesInBackground) {
+	const std::string path = "WorldSnapshotTest.ddw";
+	std::shared_ptr<WorldSnapshot> world(new WorldSnapshot());
+	std::shared_ptr<ChunkDelta> delta(new ChunkDelta(ChunkOffsetVector(1, 1, 1)));
+	delta->Samples.push_back({ 3, 1.0f, 4 });
+	world->Deltas[delta->ChunkOffset] = delta;
+
+	{
+		WorldSnapshotWriter writer(path);
+		writer.Submit(world);
+		writer.Flush();
+		ASSERT_EQ(1, writer.GetWrittenCount());
+		ASSERT_EQ(0, writer.GetFailedCount());
+
+		// Saving again replaces the previous save
+		std::shared_ptr<WorldSnapshot> later(new WorldSnapshot(*world));
+		std::shared_ptr<ChunkDelta> laterDelta(new ChunkDelta(*delta));
+		laterDelta->Samples[0].Material = 5;
+		later->Deltas[delta->ChunkOffset] = laterDelta;
+		writer.Submit(later);
+		writer.Flush();
+		ASSERT_EQ(2, writer.GetWrittenCount());
+		ASSERT_EQ(0, writer.GetFailedCount());
+	}
+
+	std::ifstream input(path, std::ios::binary);
+	ChunkDeltaMap deltas;
+	ReadChunkDeltas(input, deltas);
+	input.close();
+	std::remove(path.c_str());
+	ASSERT_EQ(1, deltas.size());
+	ASSERT_EQ(5, deltas[ChunkOffsetVector(1, 1, 1)]->Samples[0].Material);
+	ASSERT_FALSE(std::ifstream(path + ".tmp").is_open());
+}
@@ -0,0 +1,156 @@
+#include <cstdio>
+#include <Models/Terrain/ChunkKernels.h>
+#include <Models/Terrain/ChunkWire.h>
+#include <Models/Terrain/TerrainEditing.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace utils;
+using namespace terrain;
+
+#define ITERATOR_DEBUG_LEVEL 0
+
+using Clock = std::chrono::high_resolution_clock;
+
+ChunkDataSet CreateChunks(const Uint32 cellCount) {
+	ChunkDataSet chunks;
+	for (Uint32 cx = 0; cx < 3; cx++) {
+		for (Uint32 cy = 0; cy < 3; cy++) {
+			for (Uint32 cz = 0; cz < 3; cz++) {
+				ChunkDataPtr data(new ChunkData(cellCount, ChunkOffsetVector(cx, cy, cz)));
+				for (Uint32 x = 0; x < cellCount; x++) {
+					for (Uint32 y = 0; y < cellCount; y++) {
+						const double height = cellCount * 1.5 +
+							cellCount * 0.25 * std::sin((cx * cellCount + x) * 0.3) *
+							std::cos((cy * cellCount + y) * 0.2);
+						for (Uint32 z = 0; z < cellCount; z++) {
+							if (cz * cellCount + z < height)
+								data->DensityData.Mutable().Set(x, y, z, 1);
+						}
+					}
+				}
+				chunks.Set(cx, cy, cz, data);
+			}
+		}
+	}
+	return chunks;
+}
+
+double Milliseconds(const Clock::time_point & start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void Profile(const char * name, const ChunkKernels & kernels, const Uint32 cellCount) {
+	const Uint32 iterations = 20;
+	const auto chunks = CreateChunks(cellCount);
+	ChunkApron apron;
+	std::vector<Triangle3D<float>> triangles;
+	ChunkMeshAttributes attributes;
+	OccupancyGrid3D solid(cellCount);
+	ChunkData fillTarget(cellCount, ChunkOffsetVector(0, 0, 0));
+
+	auto start = Clock::now();
+	for (Uint32 i = 0; i < iterations; i++)
+		kernels.FillDensity(fillTarget, cellCount * 0.5 + i % 3, cellCount);
+	const double fillTime = Milliseconds(start) / iterations;
+
+	start = Clock::now();
+	for (Uint32 i = 0; i < iterations; i++)
+		kernels.FillApron(chunks, apron, cellCount);
+	const double apronTime = Milliseconds(start) / iterations;
+
+	start = Clock::now();
+	for (Uint32 i = 0; i < iterations; i++) {
+		triangles.clear();
+		attributes.Normals.clear();
+		attributes.Materials.clear();
+		kernels.GenerateMesh(apron, 1.0, 0, 0, cellCount, triangles, &attributes, cellCount);
+	}
+	const double meshTime = Milliseconds(start) / iterations;
+
+	start = Clock::now();
+	for (Uint32 i = 0; i < iterations; i++)
+		kernels.FillSolid(apron, solid, cellCount);
+	const double fillSolidTime = Milliseconds(start) / iterations;
+
+	Uint64 solidCount = 0;
+	const Int64 n = cellCount;
+	start = Clock::now();
+	for (Uint32 i = 0; i < iterations; i++) {
+		for (Int64 x = -1; x <= n; x++) {
+			for (Int64 y = -1; y <= n; y++) {
+				for (Int64 z = -1; z <= n; z++)
+					solidCount += kernels.IsSolidAt(apron, Vector3D<Int64>(x, y, z), cellCount);
+			}
+		}
+	}
+	const double solidTime = Milliseconds(start) / iterations;
+
+	printf("%-12s %3u: fill %8.3f ms  apron %8.3f ms  mesh %8.3f ms  fill solid %8.3f ms  "
+		"solid %8.3f ms  (%llu triangles, %llu solid)\n",
+		name, cellCount, fillTime, apronTime, meshTime, fillSolidTime, solidTime,
+		(unsigned long long) triangles.size(), (unsigned long long) solidCount / iterations);
+}
+
+void ProfileWire(const Uint32 cellCount) {
+	const Uint32 iterations = 20;
+	const auto chunks = CreateChunks(cellCount);
+	const items::ItemDataFactory factory;
+	std::vector<std::vector<Uint8>> messages(27);
+	Uint64 totalBytes = 0, minBytes = ~0ull, maxBytes = 0;
+
+	auto start = Clock::now();
+	for (Uint32 i = 0; i < iterations; i++) {
+		for (Uint32 c = 0; c < 27; c++) {
+			messages[c].clear();
+			EncodeChunkSnapshot(*chunks.Get(c / 9, c / 3 % 3, c % 3), messages[c]);
+		}
+	}
+	const double encodeTime = Milliseconds(start) / iterations;
+
+	for (const auto & message : messages) {
+		totalBytes += message.size();
+		minBytes = std::min(minBytes, (Uint64) message.size());
+		maxBytes = std::max(maxBytes, (Uint64) message.size());
+	}
+
+	start = Clock::now();
+	for (Uint32 i = 0; i < iterations; i++) {
+		for (const auto & message : messages)
+			DecodeChunkMessage(message, factory);
+	}
+	const double decodeTime = Milliseconds(start) / iterations;
+
+	// A dig the size of a player's tool
+	auto & edited = *chunks.Get(1, 1, 1);
+	ChunkCellRange changed;
+	ApplyTerrainEdit(TerrainEdit(E_Dig, E_Sphere,
+		ChunkPositionVector(edited.ChunkOffset, Point3D(cellCount / 2, cellCount / 2, 0)),
+		Vector3D<>(2, 2, 2)), edited, changed);
+	std::vector<Uint8> edit;
+	EncodeChunkEdit(CaptureChunkEdit(edited, changed), edited.Version, edit);
+
+	// Density and material fields as held in memory
+	const double rawBytes = 27.0 * cellCount * cellCount * cellCount * (4 + 8);
+	printf("wire         %3u: snapshot %6.0f B/chunk (min %llu, max %llu, raw %.0f)  "
+		"encode %7.1f MB/s  decode %7.1f MB/s  edit %llu B\n",
+		cellCount, totalBytes / 27.0, (unsigned long long) minBytes,
+		(unsigned long long) maxBytes, rawBytes / 27, rawBytes / encodeTime / 1000,
+		rawBytes / decodeTime / 1000, (unsigned long long) edit.size());
+}
+
+void Run() {
+	const Uint32 sizes[] = { 16, 32 };
+	for (const auto size : sizes) {
+		Profile("kernels", GetChunkKernels(), size);
+	}
+	for (const auto size : sizes)
+		ProfileWire(size);
+}
+
+int main(int argv, char ** argc) {
+	Run();
+	return 0;
+}